@@ -0,0 +1,203 @@
+/**
+ * @file    cell_list.cpp
+ * @author  James Sturgis
+ * @date    October 16, 2026
+ * @brief   Implementation of the cell_list class.
+ */
+
+#include "cell_list.h"
+#include "common.h"
+#include <math.h>
+
+/**
+ * @brief Constructor for an empty grid covering a rectangular area.
+ *
+ * @param x_min     Left edge of the area.
+ * @param y_min     Bottom edge of the area.
+ * @param width     Width of the area.
+ * @param height    Height of the area.
+ * @param min_size  The smallest acceptable cell dimension, this should be the
+ *                  largest distance at which objects interact.
+ * @param wrap      Use periodic conditions.
+ */
+cell_list::cell_list(double x_min, double y_min, double width, double height,
+        double min_size, bool wrap ){
+    size     = min_size;
+    periodic = wrap;
+    x0       = x_min;
+    y0       = y_min;
+    nx       = (min_size > 0.0) ? (int)floor( width / min_size ) : 1;
+    ny       = (min_size > 0.0) ? (int)floor( height / min_size ) : 1;
+    nx       = simple_max( nx, 1 );
+    ny       = simple_max( ny, 1 );
+    cell_w   = width / nx;
+    cell_h   = height / ny;
+    if( cell_w <= 0.0 ) cell_w = 1.0;       // Degenerate area, single cell.
+    if( cell_h <= 0.0 ) cell_h = 1.0;
+    head.assign( nx * ny, -1 );
+}
+
+/**
+ * Destructor for the cell list.
+ */
+cell_list::~cell_list() {
+}
+
+/**
+ * @brief Find the cell that contains a point.
+ *
+ * With periodic conditions the point is wrapped back into the grid, otherwise
+ * points outside the grid are attributed to the nearest border cell.
+ *
+ * @param x     The x coordinate of the point.
+ * @param y     The y coordinate of the point.
+ * @return      The index of the cell.
+ */
+int
+cell_list::cell_of(double x, double y){
+    int     ix = (int)floor(( x - x0 ) / cell_w );
+    int     iy = (int)floor(( y - y0 ) / cell_h );
+
+    if( periodic ){
+        ix %= nx; if( ix < 0 ) ix += nx;
+        iy %= ny; if( iy < 0 ) iy += ny;
+    } else {
+        ix = simple_max( ix, 0 ); ix = simple_min( ix, nx-1 );
+        iy = simple_max( iy, 0 ); iy = simple_min( iy, ny-1 );
+    }
+    return ix + nx * iy;
+}
+
+/**
+ * @param index The object number.
+ * @return      The cell that currently holds the object.
+ */
+int
+cell_list::cell(int index){
+    assert( index < (int)where.size() );
+    return where[index];
+}
+
+/**
+ * @brief List the cells that are adjacent to a cell (including itself).
+ *
+ * Small periodic grids wrap onto themselves, so cells are only listed once.
+ *
+ * @param a_cell    The central cell.
+ * @param nbr       An array of at least 9 integers that receives the cells.
+ * @return          The number of cells placed in nbr.
+ */
+int
+cell_list::neighbour_cells(int a_cell, int *nbr){
+    int     ix = a_cell % nx;
+    int     iy = a_cell / nx;
+    int     n  = 0;
+    int     jx, jy, c, k;
+
+    for( int dy = -1; dy <= 1; dy++ ){
+        jy = iy + dy;
+        if( periodic ){
+            if( jy < 0 )   jy += ny;
+            if( jy >= ny ) jy -= ny;
+        } else if(( jy < 0 ) || ( jy >= ny )) continue;
+        for( int dx = -1; dx <= 1; dx++ ){
+            jx = ix + dx;
+            if( periodic ){
+                if( jx < 0 )   jx += nx;
+                if( jx >= nx ) jx -= nx;
+            } else if(( jx < 0 ) || ( jx >= nx )) continue;
+            c = jx + nx * jy;
+            for( k = 0; k < n; k++ )        // Small grids wrap onto themselves
+                if( nbr[k] == c ) break;
+            if( k == n ) nbr[n++] = c;
+        }
+    }
+    return n;
+}
+
+/**
+ * @param a_cell    The cell to look in.
+ * @return          The first object in the cell or -1 if it is empty.
+ */
+int
+cell_list::first(int a_cell){
+    return head[a_cell];
+}
+
+/**
+ * @param index     An object in the grid.
+ * @return          The next object in the same cell or -1 if there are no more.
+ */
+int
+cell_list::next(int index){
+    return next_obj[index];
+}
+
+/**
+ * @brief Add an object to the grid.
+ *
+ * Objects should be inserted with consecutive indices starting from 0.
+ *
+ * @param index     The object number.
+ * @param x         The x coordinate of the object center.
+ * @param y         The y coordinate of the object center.
+ */
+void
+cell_list::insert(int index, double x, double y){
+    if( index >= (int)where.size() ){
+        where.resize( index + 1, -1 );
+        next_obj.resize( index + 1, -1 );
+        prev_obj.resize( index + 1, -1 );
+    }
+    link( index, cell_of( x, y ));
+}
+
+/**
+ * @brief Move an object to the cell corresponding to its new position.
+ *
+ * @param index     The object number.
+ * @param x         The new x coordinate of the object center.
+ * @param y         The new y coordinate of the object center.
+ */
+void
+cell_list::update(int index, double x, double y){
+    int     new_cell = cell_of( x, y );
+
+    if( new_cell != where[index] ){
+        unlink( index );
+        link( index, new_cell );
+    }
+}
+
+/**
+ * Empty the grid, keeping its geometry.
+ */
+void
+cell_list::clear(){
+    head.assign( nx * ny, -1 );
+    where.clear();
+    next_obj.clear();
+    prev_obj.clear();
+}
+
+void
+cell_list::unlink(int index){
+    int     p = prev_obj[index];
+    int     n = next_obj[index];
+
+    if( p >= 0 ) next_obj[p] = n;
+    else         head[where[index]] = n;
+    if( n >= 0 ) prev_obj[n] = p;
+    where[index] = -1;
+}
+
+void
+cell_list::link(int index, int a_cell){
+    int     n = head[a_cell];
+
+    prev_obj[index] = -1;
+    next_obj[index] = n;
+    if( n >= 0 ) prev_obj[n] = index;
+    head[a_cell]  = index;
+    where[index]  = a_cell;
+}
@@ -0,0 +1,67 @@
+/**
+ * @file    cell_list.h
+ * @author  James Sturgis
+ * @date    October 16, 2026
+ * \brief   Header file for the cell_list class.
+ *
+ * @class   cell_list cell_list.h
+ * @brief   A uniform grid of cells used to find the neighbours of an object.
+ *
+ * The area occupied by a configuration is divided into a grid of nx by ny
+ * rectangular cells, each at least min_size wide and high. Every object is
+ * placed in the cell that contains its center, so all the objects that are
+ * closer than min_size to a given object are in the same cell or one of the
+ * 8 surrounding cells. With periodic conditions the grid wraps around, without
+ * periodic conditions objects that are outside the grid are kept in the
+ * nearest border cell.
+ *
+ * The members of each cell are kept in a doubly linked list stored in arrays
+ * indexed by object number so that moving an object from one cell to another
+ * costs O(1) and never allocates memory. The cells of an object are then
+ * visited using:
+ *
+ *      n = cells->neighbour_cells( cells->cell(i), nbr );
+ *      for( k = 0; k < n; k++ )
+ *          for( j = cells->first( nbr[k] ); j >= 0; j = cells->next( j ))
+ *              ...
+ */
+
+#ifndef CELL_LIST_H
+#define CELL_LIST_H
+
+#include <vector>
+
+class cell_list {
+public:
+    cell_list(double x_min, double y_min,
+              double width, double height,
+              double min_size, bool periodic ); ///< Constructor for an empty grid.
+    virtual ~cell_list();                   ///< Destructor
+
+    void    insert(int index, double x, double y ); ///< Add object index at x, y
+    void    update(int index, double x, double y ); ///< Object index has moved to x, y
+    void    clear();                        ///< Remove all objects from the grid.
+
+    int     cell_of(double x, double y);    ///< The cell containing the point x, y
+    int     cell(int index);                ///< The cell containing object index
+    int     neighbour_cells(int a_cell,
+                int *nbr );                 ///< Fill nbr with the (up to 9) distinct cells around a_cell
+    int     first(int a_cell);              ///< First object in a cell (-1 if empty)
+    int     next(int index);                ///< Next object in the same cell (-1 at the end)
+
+    double  size;                           ///< The minimum cell size requested.
+    int     nx, ny;                         ///< Number of cells in each direction
+private:
+    void    unlink(int index);              ///< Take an object out of its cell list.
+    void    link(int index, int a_cell);    ///< Put an object at the head of a cell list.
+
+    double  x0, y0;                         ///< Origin of the grid
+    double  cell_w, cell_h;                 ///< Actual dimensions of a cell
+    bool    periodic;                       ///< Does the grid wrap around
+    std::vector<int>    head;               ///< First object in each cell
+    std::vector<int>    next_obj;           ///< Next object in the same cell
+    std::vector<int>    prev_obj;           ///< Previous object in the same cell
+    std::vector<int>    where;              ///< Cell containing each object
+};
+
+#endif /* CELL_LIST_H */
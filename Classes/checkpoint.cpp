@@ -0,0 +1,305 @@
+/**
+ * @file    checkpoint.cpp
+ * @author  James Sturgis
+ * @date    October 16, 2026
+ * @brief   Implementation of the checkpoint class.
+ */
+
+#include "checkpoint.h"
+#include "random_stream.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <unistd.h>
+
+#define CHECK_MAGIC     "HDCKPT01"
+#define CHECK_VERSION   2
+#define FLAG_PERIODIC   1
+#define FLAG_RECTANGLE  2
+
+/**
+ * Constructor for an empty checkpoint, to be filled by save().
+ */
+checkpoint::checkpoint(){
+    step         = 0;
+    n_frames     = 0;
+    is_periodic  = false;
+    is_rectangle = true;
+    x_size       = 1.0;
+    y_size       = 1.0;
+    n_good       = 0;
+    n_bad        = 0;
+    i_adjust     = 0;
+    n_step       = 0;
+    n_events     = 0;
+    n_good_total = 0;
+    n_bad_total  = 0;
+    dl_max       = 1.0;
+    seed         = 0;
+    stream       = 0;
+    position     = 0;
+}
+
+/**
+ * @brief Read a checkpoint file.
+ *
+ * @param name  the file name.
+ * @throws      runtime_error if the file can not be read or is not a
+ *              checkpoint.
+ */
+checkpoint::checkpoint(std::string name) : checkpoint(){
+    FILE        *source;
+    char        magic[8];
+    uint32_t    word, flags, n_objects, n_vertex;
+    int32_t     o_type;
+    std::string *text;
+
+    if(( source = fopen( name.c_str(), "rb" )) == NULL )
+        throw std::runtime_error("Could not open checkpoint file " + name + "\n");
+    auto get = [&]( void *to, size_t size ){
+        if( fread( to, 1, size, source ) != size ){
+            fclose( source );
+            throw std::runtime_error("Checkpoint file " + name + " is truncated\n");
+        }
+    };
+
+    get( magic, 8 );
+    get( &word, sizeof(word) );
+    if(( memcmp( magic, CHECK_MAGIC, 8 ) != 0 ) || ( word != CHECK_VERSION )){
+        fclose( source );
+        throw std::runtime_error( name + " is not a checkpoint file\n");
+    }
+    get( &flags, sizeof(flags) );
+    is_periodic  = flags & FLAG_PERIODIC;
+    is_rectangle = flags & FLAG_RECTANGLE;
+    get( &n_objects, sizeof(n_objects) );
+    get( &n_vertex, sizeof(n_vertex) );
+    get( &step, sizeof(step) );
+    get( &n_frames, sizeof(n_frames) );
+
+    get( &x_size, sizeof(x_size) );
+    get( &y_size, sizeof(y_size) );
+    vertices.resize( 2 * n_vertex );
+    for( size_t i = 0; i < vertices.size(); i++ )
+        get( &vertices[i], sizeof(double) );
+    types.resize( n_objects );
+    positions.resize( 3 * n_objects );
+    for( uint32_t i = 0; i < n_objects; i++ ){
+        get( &o_type, sizeof(o_type) );
+        types[i] = o_type;
+        get( &positions[3*i], 3 * sizeof(double) );
+    }
+
+    get( &n_good, sizeof(n_good) );
+    get( &n_bad, sizeof(n_bad) );
+    get( &i_adjust, sizeof(i_adjust) );
+    get( &n_step, sizeof(n_step) );
+    get( &n_events, sizeof(n_events) );
+    get( &n_good_total, sizeof(n_good_total) );
+    get( &n_bad_total, sizeof(n_bad_total) );
+    get( &dl_max, sizeof(dl_max) );
+
+    get( &seed, sizeof(seed) );
+    get( &stream, sizeof(stream) );
+    get( &position, sizeof(position) );
+
+    for( int k = 0; k < 2; k++ ){
+        text = ( k == 0 ) ? &force_text : &topology_text;
+        get( &word, sizeof(word) );
+        text->resize( word );
+        if( word > 0 ) get( &(*text)[0], word );
+    }
+    fclose( source );
+}
+
+/**
+ * Destructor.
+ */
+checkpoint::~checkpoint(){
+}
+
+/**
+ * @brief Record the boundary and objects of a configuration, the state of an
+ * integrator and the position of the random numbers of the calling thread.
+ *
+ * step, n_frames and the texts of the force field and topology are set
+ * separately.
+ *
+ * @param a_config      the configuration.
+ * @param an_integrator the integrator.
+ */
+void
+checkpoint::save(config *a_config, integrator *an_integrator){
+    object          *my_obj;
+    Point           vertex;
+    random_stream   *numbers = rnd_current();
+
+    is_periodic  = a_config->is_periodic;
+    is_rectangle = a_config->is_rectangle;
+    x_size       = a_config->x_size;
+    y_size       = a_config->y_size;
+    vertices.clear();
+    if( !is_rectangle )
+        for( int i = 0; i < a_config->poly->n_vertex; i++ ){
+            vertex = a_config->poly->get_vertex( i );
+            vertices.push_back( vertex.x );
+            vertices.push_back( vertex.y );
+        }
+    types.resize( a_config->n_objects() );
+    positions.resize( 3 * a_config->n_objects() );
+    for( int i = 0; i < a_config->n_objects(); i++ ){
+        my_obj = a_config->get_object( i );
+        types[i]         = my_obj->o_type;
+        positions[3*i]   = my_obj->pos_x;
+        positions[3*i+1] = my_obj->pos_y;
+        positions[3*i+2] = my_obj->orientation;
+    }
+
+    n_good   = an_integrator->n_good;
+    n_bad    = an_integrator->n_bad;
+    i_adjust = an_integrator->i_adjust;
+    n_step   = an_integrator->steps();
+    n_events = an_integrator->n_events;
+    n_good_total = an_integrator->n_good_total;
+    n_bad_total  = an_integrator->n_bad_total;
+    dl_max   = an_integrator->dl_max;
+
+    seed     = numbers->seed;
+    stream   = numbers->stream;
+    position = numbers->position();
+}
+
+/**
+ * Give an integrator the saved state and put the random numbers of the
+ * calling thread where they were when the state was saved.
+ *
+ * @param an_integrator the integrator, with the force field of the run.
+ */
+void
+checkpoint::restore(integrator *an_integrator){
+    random_stream   *numbers = rnd_current();
+
+    an_integrator->n_good   = n_good;
+    an_integrator->n_bad    = n_bad;
+    an_integrator->i_adjust = i_adjust;
+    an_integrator->n_events = n_events;
+    an_integrator->n_good_total = n_good_total;
+    an_integrator->n_bad_total  = n_bad_total;
+    an_integrator->dl_max   = dl_max;
+    an_integrator->set_steps( n_step );
+    numbers->set( seed, stream );
+    numbers->seek( position );
+}
+
+/**
+ * @brief Write the checkpoint.
+ *
+ * The file is written as name.tmp and then renamed, so if the programme
+ * stops while writing the previous checkpoint is still there.
+ *
+ * @param name  the file name.
+ * @throws      runtime_error if the file could not be written.
+ */
+void
+checkpoint::write(std::string name){
+    std::string tmp_name = name + ".tmp";
+    FILE        *dest;
+    uint32_t    word;
+    int32_t     o_type;
+    bool        failed;
+
+    if(( dest = fopen( tmp_name.c_str(), "wb" )) == NULL )
+        throw std::runtime_error("Could not create checkpoint file " + tmp_name + "\n");
+    fwrite( CHECK_MAGIC, 1, 8, dest );
+    word = CHECK_VERSION;
+    fwrite( &word, sizeof(word), 1, dest );
+    word = ( is_periodic ? FLAG_PERIODIC : 0 ) | ( is_rectangle ? FLAG_RECTANGLE : 0 );
+    fwrite( &word, sizeof(word), 1, dest );
+    word = types.size();
+    fwrite( &word, sizeof(word), 1, dest );
+    word = vertices.size() / 2;
+    fwrite( &word, sizeof(word), 1, dest );
+    fwrite( &step, sizeof(step), 1, dest );
+    fwrite( &n_frames, sizeof(n_frames), 1, dest );
+
+    fwrite( &x_size, sizeof(x_size), 1, dest );
+    fwrite( &y_size, sizeof(y_size), 1, dest );
+    fwrite( vertices.data(), sizeof(double), vertices.size(), dest );
+    for( size_t i = 0; i < types.size(); i++ ){
+        o_type = types[i];
+        fwrite( &o_type, sizeof(o_type), 1, dest );
+        fwrite( &positions[3*i], sizeof(double), 3, dest );
+    }
+
+    fwrite( &n_good, sizeof(n_good), 1, dest );
+    fwrite( &n_bad, sizeof(n_bad), 1, dest );
+    fwrite( &i_adjust, sizeof(i_adjust), 1, dest );
+    fwrite( &n_step, sizeof(n_step), 1, dest );
+    fwrite( &n_events, sizeof(n_events), 1, dest );
+    fwrite( &n_good_total, sizeof(n_good_total), 1, dest );
+    fwrite( &n_bad_total, sizeof(n_bad_total), 1, dest );
+    fwrite( &dl_max, sizeof(dl_max), 1, dest );
+
+    fwrite( &seed, sizeof(seed), 1, dest );
+    fwrite( &stream, sizeof(stream), 1, dest );
+    fwrite( &position, sizeof(position), 1, dest );
+
+    word = force_text.length();
+    fwrite( &word, sizeof(word), 1, dest );
+    fwrite( force_text.data(), 1, word, dest );
+    word = topology_text.length();
+    fwrite( &word, sizeof(word), 1, dest );
+    fwrite( topology_text.data(), 1, word, dest );
+
+    failed = ( fflush( dest ) != 0 ) || ferror( dest ) || ( fsync( fileno( dest )) != 0 );
+    if(( fclose( dest ) != 0 ) || failed ||
+       ( rename( tmp_name.c_str(), name.c_str() ) != 0 )){
+        remove( tmp_name.c_str() );
+        throw std::runtime_error("Could not write checkpoint file " + name + "\n");
+    }
+}
+
+/**
+ * @return  a new force field read from the saved text.
+ * @throws  runtime_error if there is no force field.
+ */
+force_field *
+checkpoint::make_forces(){
+    FILE        *source;
+    force_field *forces;
+
+    if( force_text.empty() ||
+        (( source = fmemopen( &force_text[0], force_text.length(), "r" )) == NULL ))
+        throw std::runtime_error("The checkpoint has no force field\n");
+    forces = new force_field( source );
+    fclose( source );
+    return forces;
+}
+
+/**
+ * @return  a new topology read from the saved text.
+ */
+topology *
+checkpoint::make_topology(){
+    std::istringstream  source( topology_text );
+
+    return new topology( source );
+}
+
+/**
+ * @param name  a file name.
+ * @return      the contents of the file.
+ * @throws      runtime_error if the file can not be read.
+ */
+std::string
+checkpoint::file_text(std::string name){
+    std::ifstream       source( name.c_str(), std::ios::binary );
+    std::ostringstream  text;
+
+    if( source.fail() )
+        throw std::runtime_error("Could not open file " + name + "\n");
+    text << source.rdbuf();
+    return text.str();
+}
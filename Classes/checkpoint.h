@@ -0,0 +1,91 @@
+/**
+ * @file    checkpoint.h
+ * @author  James Sturgis
+ * @date    October 16, 2026
+ * \brief   Header file for the checkpoint class.
+ *
+ * @class   checkpoint checkpoint.h
+ * @brief   The complete state of a simulation run, saved so that it can be
+ *          continued exactly.
+ *
+ * A checkpoint holds everything a run needs to continue as if it had not
+ * stopped: the boundary and the objects of the configuration with the exact
+ * (double) positions, the text of the topology and force field files, the
+ * state of the integrator (tallies, dl_max and the step count that sets when
+ * dl_max is adjusted), the position of the random number stream, the number
+ * of steps made and the number of frames written to the trajectory.
+ *
+ * save() records the state of a configuration, an integrator and the random
+ * numbers of the calling thread, write() then writes the file. The file is
+ * first written under a temporary name and renamed, so an existing
+ * checkpoint is only replaced by a complete one. A checkpoint read from a
+ * file gives back the configuration with config::read(), the integrator and
+ * random numbers with restore() and the force field and topology with
+ * make_forces() and make_topology().
+ *
+ * The file layout, in the byte order of the machine, is:
+ *
+ * * "HDCKPT01", version, flags (1 periodic, 2 rectangle), n_objects,
+ *   n_vertex (uint32), step, n_frames (int64).
+ * * the boundary: x_size, y_size and the n_vertex vertices as x, y (double).
+ * * the objects: type (int32) then x, y, orientation (double) of each.
+ * * the integrator: n_good, n_bad, i_adjust, n_step, n_events, n_good_total,
+ *   n_bad_total (int64) and dl_max (double).
+ * * the random numbers: seed, stream and position (uint64).
+ * * the force field and topology files: length (uint32) and text of each.
+ */
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "integrator.h"
+
+class checkpoint {
+public:
+    checkpoint();                   ///< An empty checkpoint.
+    checkpoint(std::string name);   ///< Read a checkpoint file.
+    virtual ~checkpoint();
+
+    void        save(config *a_config, integrator *an_integrator
+                     );             ///< Record the state of a run.
+    void        restore(integrator *an_integrator
+                     );             ///< Give the saved state to an integrator and the random numbers.
+    void        write(std::string name
+                     );             ///< Write the checkpoint, replacing the file only when complete.
+    force_field *make_forces();     ///< The force field of the run.
+    topology    *make_topology();   ///< The topology of the run.
+
+    static std::string file_text(std::string name
+                     );             ///< The contents of a file.
+
+    int64_t     step;               ///< Steps made by the run.
+    int64_t     n_frames;           ///< Frames written to the trajectory.
+    std::string force_text;         ///< The force field file.
+    std::string topology_text;      ///< The topology file.
+
+    bool        is_periodic;        ///< The configuration has periodic boundaries.
+    bool        is_rectangle;       ///< The boundary is x_size by y_size.
+    double      x_size;             ///< Width of a rectangular boundary.
+    double      y_size;             ///< Height of a rectangular boundary.
+    std::vector<double> vertices;   ///< x, y of the polygon vertices.
+    std::vector<int> types;         ///< Type of each object.
+    std::vector<double> positions;  ///< x, y, orientation of each object.
+
+    int64_t     n_good;             ///< Integrator tally of accepted moves.
+    int64_t     n_bad;              ///< Integrator tally of rejected moves.
+    int64_t     i_adjust;           ///< Integrator adjustment frequency.
+    int64_t     n_step;             ///< Integrator steps made.
+    int64_t     n_events;           ///< Integrator event chain collisions.
+    int64_t     n_good_total;       ///< Integrator accepted moves before the last adjustment.
+    int64_t     n_bad_total;        ///< Integrator rejected moves before the last adjustment.
+    double      dl_max;             ///< Integrator maximum move distance.
+
+    uint64_t    seed;               ///< Seed of the random numbers.
+    uint64_t    stream;             ///< Stream of the random numbers.
+    uint64_t    position;           ///< Words of the stream used.
+};
+
+#endif /* CHECKPOINT_H */
@@ -11,12 +11,13 @@
 #include <assert.h>
 #include <cstdlib>
 #include <cmath>
+#include "random_stream.h"
 
 #define simple_min(a,b)        (a<b)?(a):(b)
 #define simple_max(a,b)        (a>b)?(a):(b)
 
 #define M_2PI           (M_PI+M_PI)
-#define rnd_lin(range)  ((range*(double)rand())/(double)RAND_MAX)
+#define rnd_lin(range)  ((range)*rnd_uniform())
 
 #define EXIT_SUCCESS    0
 #define EXIT_FAILURE    1
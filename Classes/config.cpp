@@ -15,11 +15,85 @@
 #include <float.h>
 #include <math.h>
 #include <iostream>
+#include <cstring>
+#include <charconv>
+#include "random_stream.h"
 #include "config.h"
+#include "pair_kernel.h"
+#include "checkpoint.h"
+#include "profile.h"
 #include <boost/format.hpp>
 
 using boost::format;
 
+/**
+ * @class   config_lines
+ * @brief   The significant lines of a configuration file.
+ *
+ * Gives each line in turn without its comment (from # to the end of the line)
+ * and surrounding white space, skipping blank lines. The lines come either
+ * from a stream, one at a time so that nothing after the configuration is
+ * read (as in a trajectory), or from a buffer holding a whole file.
+ */
+class config_lines {
+public:
+    config_lines(std::istream& a_source) : source(&a_source), at(NULL), end(NULL) {}
+    config_lines(const char *begin, const char *a_end) : source(NULL), at(begin), end(a_end) {}
+    bool        next(const char **first, const char **last);
+private:
+    std::istream    *source;
+    std::string     line;                   ///< Reused for each line of a stream.
+    const char      *at, *end;              ///< What is left of the buffer.
+};
+
+/**
+ * @param first receives the start of the next line.
+ * @param last  receives the end of the line.
+ * @return      false if there are no more lines.
+ */
+bool
+config_lines::next(const char **first, const char **last){
+    const char  *b, *e, *hash;
+
+    for(;;){
+        if( source ){
+            if( !getline( *source, line )) return false;
+            b = line.data();
+            e = b + line.size();
+        } else {
+            if( at >= end ) return false;
+            b = at;
+            if(( e = (const char *)memchr( at, '\n', end - at )) == NULL ) e = end;
+            at = ( e < end ) ? e + 1 : end;
+        }
+        if(( hash = (const char *)memchr( b, '#', e - b )) != NULL ) e = hash;
+        while(( b < e ) && isspace( (unsigned char)*b )) b++;
+        while(( e > b ) && isspace( (unsigned char)e[-1] )) e--;
+        if( b < e ){
+            *first = b;
+            *last  = e;
+            return true;
+        }
+    }
+}
+
+/*
+ * Read a number after any white space, as operator>> would, and move at past
+ * it. Returns false if there is no number.
+ */
+template <typename T>
+static bool
+scan_number(const char **at, const char *end, T *value){
+    const char  *p = *at;
+
+    while(( p < end ) && isspace( (unsigned char)*p )) p++;
+    if(( p < end ) && ( *p == '+' )) p++;    // Not accepted by from_chars
+    std::from_chars_result result = std::from_chars( p, end, *value );
+    if( result.ec != std::errc() ) return false;
+    *at = result.ptr;
+    return true;
+}
+
 /**
  * Constructor that produces an empty basic configuration. This is not
  * currently much use as there are not all the necessary functions for
@@ -36,6 +110,12 @@ config::config() {
     is_rectangle = true;
     n_vertex     = 0;
     poly         = (polygon *)NULL;
+    cells        = (cell_list *)NULL;
+    verlet       = (verlet_list *)NULL;
+    verlet_skin  = 0.0;
+    n_threads    = 1;
+    pool         = (thread_pool *)NULL;
+    trial_index  = -1;
 }
 
 /**
@@ -61,60 +141,194 @@ config::config() {
  *              and a couple of lines of code.
  */
 config::config(std::istream& source ){
-    config_read(source);
+    if( source.fail() )
+        throw runtime_error("Could not open configuration file\n");
+    config_lines lines( source );
+    config_read( lines );
 }
 
+/**
+ * Constructor that reads a configuration file, the whole file is read at
+ * once and then parsed in memory.
+ *
+ * @param in_file   the file name.
+ */
 config::config(string in_file) {
-    // Open a stream of the file
-    ifstream ff(in_file.c_str());
-    config_read( ff );
+    ifstream        ff( in_file.c_str(), ios::binary );
+    std::string     buffer;
+    std::streamoff  size;
+
+    if( ff.fail() )
+        throw runtime_error("Could not open configuration file\n");
+    ff.seekg( 0, ios::end );
+    size = ff.tellg();
+    if( size < 0 ){                         // Not a regular file, line by line
+        ff.clear();
+        ff.seekg( 0, ios::beg );
+        config_lines lines( ff );
+        config_read( lines );
+        return;
+    }
+    buffer.resize( size );
+    ff.seekg( 0, ios::beg );
+    ff.read( &buffer[0], size );
     ff.close();
+    config_lines lines( buffer.data(), buffer.data() + buffer.size() );
+    config_read( lines );
+}
+
+/**
+ * @brief Constructor that makes the configuration of a frame of a binary
+ * trajectory.
+ *
+ * The positions are those stored in the file, as floats.
+ *
+ * @param a_traj    a trajectory open for reading.
+ * @param frame     the frame number, from 0.
+ */
+config::config(trajectory *a_traj, long frame) : config() {
+    read( a_traj, frame );
+}
+
+/**
+ * Replace the boundary and the objects by the next configuration in a stream,
+ * keeping the storage of obj_list. The topology is kept, everything else is
+ * as the stream constructor leaves it.
+ *
+ * @param source    the stream, as for config(std::istream&).
+ * @throws          runtime_error or range_error if the configuration can not
+ *                  be read, the objects are then undefined.
+ */
+void
+config::read(std::istream& source){
+    topology    *keep = the_topology;
+
+    if( source.fail() )
+        throw runtime_error("Could not open configuration file\n");
+    if( poly ) delete poly;
+    if( cells ) delete cells;
+    if( verlet ) delete verlet;
+    if( pool ) delete pool;
+    obj_list.clear();
+    config_lines lines( source );
+    config_read( lines );
+    the_topology = keep;
 }
 
 /**
- * This is messy as defined in topology.cpp
+ * Replace the boundary and the objects by a frame of a binary trajectory,
+ * keeping the storage of obj_list. The objects are overwritten in place, so
+ * their atom caches keep their room from one frame to the next.
+ *
+ * @param a_traj    the trajectory.
+ * @param frame     the frame number, from 0.
  */
-bool my_getline(std::istream& ff, string *line);
+void
+config::read(trajectory *a_traj, long frame){
+    const float *data = a_traj->frame_data( frame );
+
+    drop_cells();
+    if( poly ) delete poly;
+    poly         = (polygon *)NULL;
+    n_vertex     = 0;
+    x_size       = a_traj->x_size;
+    y_size       = a_traj->y_size;
+    is_periodic  = a_traj->is_periodic;
+    is_rectangle = a_traj->is_rectangle;
+    if( !is_rectangle ){
+        n_vertex = a_traj->vertices.size() / 2;
+        poly     = new polygon( n_vertex );
+        for( int i = 0; i < n_vertex; i++ )
+            poly->add_vertex( a_traj->vertices[2*i], a_traj->vertices[2*i+1] );
+    }
+    obj_list.resize( a_traj->n_objects );
+    for( int i = 0; i < a_traj->n_objects; i++ ){
+        object  &obj = obj_list[i];
+
+        obj.o_type      = a_traj->types[i];
+        obj.pos_x       = data[3*i];
+        obj.pos_y       = data[3*i+1];
+        obj.orientation = data[3*i+2];
+        obj.recalculate = true;
+        obj.forget_atoms();
+    }
+    unchanged    = false;
+    saved_energy = 0.0;
+    trial_index  = -1;
+}
+
+/**
+ * Replace the boundary and the objects by those saved in a checkpoint, with
+ * their exact positions, keeping the storage of obj_list and the topology.
+ *
+ * @param a_check   the checkpoint.
+ */
+void
+config::read(checkpoint *a_check){
+    int     n = a_check->types.size();
+
+    drop_cells();
+    if( poly ) delete poly;
+    poly         = (polygon *)NULL;
+    n_vertex     = 0;
+    x_size       = a_check->x_size;
+    y_size       = a_check->y_size;
+    is_periodic  = a_check->is_periodic;
+    is_rectangle = a_check->is_rectangle;
+    if( !is_rectangle ){
+        n_vertex = a_check->vertices.size() / 2;
+        poly     = new polygon( n_vertex );
+        for( int i = 0; i < n_vertex; i++ )
+            poly->add_vertex( a_check->vertices[2*i], a_check->vertices[2*i+1] );
+    }
+    obj_list.clear();
+    obj_list.reserve( n );
+    for( int i = 0; i < n; i++ )
+        obj_list.push_back( object( a_check->types[i], a_check->positions[3*i],
+                                    a_check->positions[3*i+1], a_check->positions[3*i+2] ));
+    unchanged    = false;
+    saved_energy = 0.0;
+    trial_index  = -1;
+}
 
 /*
- * Read a configuration file as a stream. 
+ * Read a configuration file line by line. 
  * Want to enhance this to:
  * 1. Deal sensibly with errors in the input file
  *    In case of errors it throws runtime_error() with a useful message!
  * 2. Ignore empty lines, and comments "# to end of line"
- *    These are removed by my_getline(ff, line)
+ *    These are removed by config_lines::next()
+ * The numbers are read with std::from_chars and the objects are made in
+ * place in obj_list, which is reserved for the declared number.
  */
 void
-config::config_read(std::istream& ff){
+config::config_read(config_lines& lines){
     int         n_obj;
     int         o_type;
     double      x_pos, y_pos, angle;
-    object      *my_obj;
-    // Plus a string for each line
-    string      line;
+    const char  *at, *end;              // The line being read
     
     is_periodic  = true;                             // Set up defaults.
     is_rectangle = true;
     n_vertex     = 0;
     poly         = (polygon *)NULL;
-
-    // Check if the file exists
-    if(ff.fail()) {
-        throw runtime_error("Could not open configuration file\n");
-    }
-    
-    // We get each line with my_getline(in_file, line)
-    // This fills string with the content of the next line that is not all
+    cells        = (cell_list *)NULL;
+    verlet       = (verlet_list *)NULL;
+    verlet_skin  = 0.0;
+    n_threads    = 1;
+    pool         = (thread_pool *)NULL;
+    trial_index  = -1;
+
+    // We get each line with lines.next(&at, &end)
+    // This gives the content of the next line that is not all
     // whitespace or comment and returns true if it succeeded and false on failure.
 
-    if(!my_getline(ff, &line)){			// Found end of file before content.
+    if(!lines.next(&at, &end)){			// Found end of file before content.
         throw runtime_error("Found no content in the configuration file\n");
     }
-    istringstream iss(line);
-    if (!(iss >> x_size >> y_size)) {
+    if (!scan_number(&at, end, &x_size) || !scan_number(&at, end, &y_size)) {
         throw runtime_error("First line of the configuration file should be x_size y_size, exiting ...\n");
     }
-    iss.clear();
 
     // Here we handle the case of a non-rectangular configuration signalled
     // by 2 zeros in the first line (after any comments etc)... 
@@ -122,48 +336,40 @@ config::config_read(std::istream& ff){
         is_rectangle = false;
         is_periodic = false;
 
-        if(! my_getline(ff, &line))
+        if(! lines.next(&at, &end))
             throw runtime_error("Failed to read number of vertices..\n");
-        iss.str(line);
-        if( !(iss >> n_vertex )){
+        if( !scan_number(&at, end, &n_vertex )){
             throw runtime_error("Failed to read number of vertices...\n");
         }
-        iss.clear();
         poly = new polygon( n_vertex );
 
         double x_coord, y_coord;
         for( int i = 0; i < n_vertex; i++){
-            if(!my_getline(ff, &line))
+            if(!lines.next(&at, &end))
         	throw runtime_error("Error reading bounding polygon coordinates..\n");
-            iss.str(line);
-            if( !(iss >> x_coord >> y_coord )){
+            if( !scan_number(&at, end, &x_coord) || !scan_number(&at, end, &y_coord )){
         	throw runtime_error("Error reading bounding polygon coordinates...\n");
             }
             poly->add_vertex( x_coord, y_coord );
-            iss.clear();
         }
     }
  
     // Next line the number of objects in the configuration
-    if( !my_getline(ff, &line))
+    if( !lines.next(&at, &end))
         throw range_error("Failed to read number of objects..\n");
-    iss.str(line);
-    if (!(iss >> n_obj))
+    if (!scan_number(&at, end, &n_obj))
         throw range_error("Failed to read number of objects...\n");
-    iss.clear();
     
     // Now loop through the objects and remaining lines
+    if( n_obj > 0 ) obj_list.reserve( n_obj );
     for( int i = 0; i < n_obj; i++){
-        if( !my_getline(ff, &line))
+        if( !lines.next(&at, &end))
             throw runtime_error("Problem in the coordinates..\n");
-        iss.str(line);
-        if (!(iss >> o_type >> x_pos >> y_pos >> angle))
+        if (!scan_number(&at, end, &o_type) || !scan_number(&at, end, &x_pos) ||
+            !scan_number(&at, end, &y_pos) || !scan_number(&at, end, &angle))
             throw runtime_error("Problem in the coordinates...\n");
         
-        my_obj = new object(o_type, x_pos, y_pos, angle );
-        obj_list.push_back(*my_obj);
-        delete my_obj;
-        iss.clear();
+        obj_list.emplace_back(o_type, x_pos, y_pos, angle );
     }
     unchanged = false;                          // Set up so will calculate energy.
     saved_energy = 0.0;
@@ -179,7 +385,7 @@ config::config(config& orig) {
     x_size         = orig.x_size;
     y_size         = orig.y_size;
     saved_energy   = orig.saved_energy;
-    unchanged      = orig.unchanged;
+    unchanged      = false;                 // The cells are not copied
     if( orig.the_topology ) 
         the_topology   = new topology(orig.the_topology);
     else
@@ -196,6 +402,12 @@ config::config(config& orig) {
         poly       = new polygon( orig.poly );
     else
         poly       = NULL;
+    cells          = NULL;                  // Rebuilt when needed
+    verlet         = NULL;
+    verlet_skin    = orig.verlet_skin;
+    n_threads      = orig.n_threads;
+    pool           = NULL;
+    trial_index    = -1;
 }
 
 /**
@@ -206,7 +418,7 @@ config::config(config* orig) {
     x_size         = orig->x_size;
     y_size         = orig->y_size;
     saved_energy   = orig->saved_energy;
-    unchanged      = orig->unchanged;
+    unchanged      = false;                 // The cells are not copied
     if( orig->the_topology ) 
         the_topology   = new topology(orig->the_topology);
     else
@@ -223,6 +435,12 @@ config::config(config* orig) {
         poly       = new polygon( orig->poly );
     else
         poly       = NULL;
+    cells          = NULL;                  // Rebuilt when needed
+    verlet         = NULL;
+    verlet_skin    = orig->verlet_skin;
+    n_threads      = orig->n_threads;
+    pool           = NULL;
+    trial_index    = -1;
 }
 
 /**
@@ -232,6 +450,9 @@ config::config(config* orig) {
 config::~config() {
     if(the_topology) delete(the_topology);
     if(poly) delete(poly);
+    if(cells) delete(cells);
+    if(verlet) delete(verlet);
+    if(pool) delete(pool);
 }
 
 /**
@@ -248,76 +469,940 @@ double config::area() {
 /**
  * This function calculates the energy of a configuration by comparing using
  * the force field interaction function to measure the energy between pairs of
- * objects. As both indexes run from 0 to the end all interactions are counted
- * twice. This is done so that neighbour lists, if implemented, will work more
- * easilly. To increase the energy the object recalculate flag, and the
+ * objects. As both indexes run over all the neighbours all interactions are
+ * counted twice, so that the energy of each object is complete. Only objects in
+ * the cells neighbouring an object, or in its Verlet list, are considered, as
+ * these include everything within the interaction range. To
+ * increase the energy the object recalculate flag, and the
  * configuration unchanged flag are checked to reduce unnecessary evaluations
- * as long as these flags are correctly and efficiently updated.
+ * as long as these flags are correctly and efficiently updated. When many
+ * objects must be recalculated the work is shared between the threads, the
+ * total is always summed in object order.
  *
  * @param  the_force the force field to use for the energy calculation.
  * @return the total interaction energy between all object pairs.
- * @todo   Handle periodic conditions.
  */
 double config::energy(force_field *&the_force) {
-    int     i1, i2;                         // Two counters
-    double  value = 0.0;                    // An accumulator that starts at 0.0
-    object  *my_obj1, *my_obj2;                       // Two object pointers
+    int     i1;                             // A counter
+    double  range;
+    thread_pool *the_pool;
 
     if (! unchanged) {                      // Only if necessary
-        saved_energy = 0.0;                 // Loop over the objects
-                                            // This code needs optimizing.
-        for(i1 = 0; i1 < (int)obj_list.size(); i1++ ){
-            my_obj1 = &obj_list[i1];
-            if( my_obj1->recalculate ){
-                value = 0.0;
-                for(i2 = 0; i2<(int)obj_list.size(); i2++ ){
-                    if(i1 != i2){            // If periodic then
-                        double r, r2;
-                        double dx = 0.0;
-                        double dy = 0.0;
-
-                        my_obj2 = &obj_list[i2];
-                        if(is_periodic){     // Move my_obj2 to closest image
-                                             // Check this code...
-                            r  = my_obj2->pos_x - my_obj1->pos_x;
-                            dx = (r<0)?x_size:-x_size;
-                            r2 = r + dx;
-                            dx = (abs(r2)<abs(r))?dx:0.0;
-                            my_obj2->pos_x += dx;
-
-                            r  = my_obj2->pos_y - my_obj1->pos_y;
-                            dy = (r<0)?y_size:-y_size;
-                            r2 = r + dy;
-                            dy = (abs(r2)<abs(r))?dy:0.0;
-                            my_obj2->pos_y += dy;
-                        }
-                        value += my_obj1->interaction( the_force,
-                                the_topology, my_obj2 );
-                        if(is_periodic){    // And move back again.
-                            my_obj2->pos_x -= dx;
-                            my_obj2->pos_y -= dy;
-                        }
-                    }
-                }                           // Calculate interaction with wall
-                if(! is_periodic ){         // if not periodic conditions.
-                    if( is_rectangle )
-                        value += my_obj1->box_energy( the_force, the_topology,
-                            x_size, y_size );
-                    else
-                        value += my_obj1->box_energy( the_force, the_topology,
-                            poly );
-                }
-                my_obj1->set_energy(value); // Set the energy of the object
-            }                               // End of the recalculation.
-            value = my_obj1->get_energy();  // Get object energy
-            saved_energy += value;          // Add into the sum
-        }                                   // End of loop over objects
+        range = interaction_range( the_force );
+        if( !verlet_ready( range ))
+            update_cells( range );
+        cell_order( work_order, true );     // The objects to recalculate
+        the_pool = get_pool();
+        if( the_pool && ( work_order.size() >= PARALLEL_OBJECTS )){
+            for(i1 = 0; i1 < (int)obj_list.size(); i1++ )
+                obj_list[i1].update_atoms( the_topology ); // Caches are shared
+            the_pool->run(( work_order.size() + PARALLEL_BLOCK - 1 ) / PARALLEL_BLOCK,
+                [&]( int task, int thread ){
+                    int end = simple_min((int)work_order.size(), ( task + 1 ) * PARALLEL_BLOCK );
+                    for(int k = task * PARALLEL_BLOCK; k < end; k++ )
+                        obj_list[work_order[k]].set_energy( object_energy( work_order[k],
+                                    range, the_force, thread_scratch[thread] ));
+                });
+        } else {
+            for(int k = 0; k < (int)work_order.size(); k++ )
+                obj_list[work_order[k]].set_energy( object_energy( work_order[k],
+                            range, the_force, nbr_scratch ));
+        }
+        saved_energy = 0.0;                 // Sum in a fixed order
+        for(i1 = 0; i1 < (int)obj_list.size(); i1++ )
+            saved_energy += obj_list[i1].get_energy();
         unchanged = true;                   // Value is correct mark as unchanged.
     }
 
     return saved_energy/2.0;                // All interactions are counted twice.
 }
 
+/**
+ * The energy of one object, its interactions with all its neighbours plus
+ * its interaction with the walls.
+ *
+ * @param  index     the object number.
+ * @param  range     the interaction range.
+ * @param  the_force the force field to use for the energy calculation.
+ * @param  scratch   space for find_neighbours().
+ * @return the energy of the object.
+ */
+double
+config::object_energy(int index, double range, force_field *the_force,
+        std::vector<int> &scratch){
+    object  *my_obj1 = &obj_list[index];
+    double  value = 0.0;
+    int     *nbr;
+    int     n_nbr;
+
+    n_nbr = find_neighbours( index, range, &nbr, scratch );
+    for(int k = 0; k < n_nbr; k++ )
+        value += pair_energy( my_obj1, &obj_list[nbr[k]], the_force );
+    return value + wall_energy( my_obj1, the_force );
+}
+
+/**
+ * List the objects cell by cell, so that consecutive objects in the list are
+ * close together. The cells must exist.
+ *
+ * @param order     receives the object numbers.
+ * @param flagged   only list the objects that need their energy recalculated.
+ */
+void
+config::cell_order(std::vector<int> &order, bool flagged){
+    order.clear();
+    for(int c = 0; c < cells->nx * cells->ny; c++ )
+        for(int j = cells->first( c ); j >= 0; j = cells->next( j ))
+            if( !flagged || obj_list[j].recalculate )
+                order.push_back( j );
+}
+
+/**
+ * @brief Set the number of threads used for full calculations.
+ *
+ * @param n the number of threads, 0 or less for one per core.
+ */
+void
+config::set_threads(int n){
+    if( n <= 0 ) n = thread_pool::hardware_threads();
+    if( pool && ( pool->n_threads != n )){
+        delete pool;
+        pool = (thread_pool *)NULL;
+    }
+    n_threads = n;
+}
+
+/**
+ * @return The thread pool, started when first needed, or NULL if only one
+ *         thread is to be used.
+ */
+thread_pool *
+config::get_pool(){
+    if( n_threads <= 1 )
+        return (thread_pool *)NULL;
+    if( !pool ){
+        pool = new thread_pool( n_threads );
+        thread_scratch.resize( n_threads );
+    }
+    return pool;
+}
+
+/**
+ * @brief Try to move every object once, sharing the work between the threads.
+ *
+ * The box is cut into a checkerboard of domains, an even number across and up
+ * the box and each at least as wide as the interaction range, with a random
+ * offset so that the domain edges change from sweep to sweep. The domains are
+ * given four colours so that domains of the same colour never touch, the
+ * objects in them cannot interact and they are moved at the same time while
+ * the other domains stay still. The colours are taken in turn starting from a
+ * random one. Each domain makes as many Metropolis moves as it holds objects,
+ * moves that would leave the domain are rejected, which keeps detailed
+ * balance. For each colour a key is drawn from the stream of the calling
+ * thread, and every domain uses its own stream with that key, so the result
+ * does not depend on the number of threads. The saved energies are
+ * recalculated by the next call to energy().
+ *
+ * @param dl_max    the scaling parameter for the moves, as for move().
+ * @param beta      the reciprocal temperature.
+ * @param the_force the force field to use for the energy calculation.
+ * @param n_tried   receives the number of moves tried.
+ * @return          the number of moves accepted, or -1 if nothing was done
+ *                  because the boundary is a polygon or the box is too small
+ *                  to divide.
+ */
+int
+config::checkerboard_sweep(double dl_max, double beta, force_field *the_force,
+        int *n_tried){
+    double  range = interaction_range( the_force );
+    int     n_good = 0;
+    int     first, colour, n_tasks, i;
+    thread_pool *the_pool;
+    uint64_t key;
+    std::vector<int> domains, accepted;
+
+    *n_tried = 0;
+    if( !is_rectangle || ( trial_index >= 0 ))
+        return -1;
+    dom_nx = ((int)( x_size / range )) & ~1;    // Even so colours alternate
+    dom_ny = ((int)( y_size / range )) & ~1;    // across the periodic edges
+    if(( dom_nx < 2 ) || ( dom_ny < 2 ))
+        return -1;
+    dom_w  = x_size / dom_nx;
+    dom_h  = y_size / dom_ny;
+    dom_x0 = rnd_lin( dom_w );
+    dom_y0 = rnd_lin( dom_h );
+
+    domain_list.resize( dom_nx * dom_ny );
+    for( i = 0; i < dom_nx * dom_ny; i++ )
+        domain_list[i].clear();
+    for( i = 0; i < (int)obj_list.size(); i++ )
+        domain_list[ domain_of( obj_list[i].pos_x, obj_list[i].pos_y )].push_back( i );
+
+    the_pool = get_pool();
+    n_tasks  = ( dom_nx / 2 ) * ( dom_ny / 2 );
+    domains.resize( n_tasks );
+    accepted.resize( n_tasks );
+    first = rnd_current()->below( 4 );
+    for( int c = 0; c < 4; c++ ){
+        colour = ( first + c ) % 4;
+        key    = rnd_current()->next64();
+        for( int t = 0; t < n_tasks; t++ ){
+            domains[t] = 2 * ( t % ( dom_nx / 2 )) + colour % 2
+                       + ( 2 * ( t / ( dom_nx / 2 )) + colour / 2 ) * dom_nx;
+            *n_tried  += domain_list[ domains[t] ].size();
+        }
+        for( i = 0; i < (int)obj_list.size(); i++ )
+            obj_list[i].update_atoms( the_topology ); // Caches are shared
+        if( the_pool ){
+            the_pool->run( n_tasks, [&]( int task, int thread ){
+                accepted[task] = domain_moves( domains[task], key,
+                                        dl_max, beta, the_force );
+            });
+        } else {
+            for( int t = 0; t < n_tasks; t++ )
+                accepted[t] = domain_moves( domains[t], key, dl_max, beta, the_force );
+        }
+        for( int t = 0; t < n_tasks; t++ )
+            n_good += accepted[t];
+    }
+
+    for( i = 0; i < (int)obj_list.size(); i++ ){
+        obj_list[i].recalculate = true;
+        if( cells ) cells->update( i, obj_list[i].pos_x, obj_list[i].pos_y );
+    }
+    if( verlet && !verlet->stale )
+        for( i = 0; i < (int)obj_list.size(); i++ )
+            if( verlet->moved_too_far( i, obj_list[i].pos_x, obj_list[i].pos_y ))
+                verlet->refresh( i, obj_list, cells );
+    unchanged = false;
+    return n_good;
+}
+
+/**
+ * @param x the x coordinate of a point in the box.
+ * @param y the y coordinate.
+ * @return  the number of the checkerboard domain containing the point.
+ */
+int
+config::domain_of(double x, double y){
+    int     ix = (int)floor(( x - dom_x0 ) / dom_w ) % dom_nx;
+    int     iy = (int)floor(( y - dom_y0 ) / dom_h ) % dom_ny;
+
+    if( ix < 0 ) ix += dom_nx;              // The first domain wraps around
+    if( iy < 0 ) iy += dom_ny;
+    return ix + iy * dom_nx;
+}
+
+/**
+ * @brief Metropolis moves of the objects in one checkerboard domain.
+ *
+ * Only the objects of the domain are moved and only those of the domain and
+ * the domains around it are used, so domains that do not touch can be done at
+ * the same time by different threads. The moves are made as by move(), but
+ * with random numbers from the stream of the domain, made five per move in a
+ * single batch, and are rejected if the object would leave the domain or the
+ * box.
+ *
+ * @param domain    the domain number, also the stream number.
+ * @param key       seed of the random number streams of the sweep.
+ * @param dl_max    the scaling parameter for the moves.
+ * @param beta      the reciprocal temperature.
+ * @param the_force the force field to use for the energy calculation.
+ * @return          the number of moves accepted.
+ */
+int
+config::domain_moves(int domain, uint64_t key, double dl_max, double beta,
+        force_field *the_force){
+    std::vector<int> &members = domain_list[domain];
+    random_stream   generator( key, domain );
+    std::vector<double> uniform( 5 * members.size() );
+    double  *u = uniform.data();
+    int     ix = domain % dom_nx;
+    int     iy = domain / dom_nx;
+    int     around[9];
+    int     n_around = 0;
+    int     n_good = 0;
+    int     index, d, k;
+    double  old_x, old_y, old_angle;
+    double  dist, angle, dU;
+    object  *my_obj;
+
+    for( int sy = -1; sy <= 1; sy++ )       // The distinct domains around
+        for( int sx = -1; sx <= 1; sx++ ){
+            d = ( ix + sx + dom_nx ) % dom_nx + (( iy + sy + dom_ny ) % dom_ny ) * dom_nx;
+            for( k = 0; ( k < n_around ) && ( around[k] != d ); k++ );
+            if( k == n_around ) around[ n_around++ ] = d;
+        }
+
+    generator.uniforms( uniform.size(), u );
+    PROFILE_COUNT( COUNT_STEPS, members.size() );
+    for( int m = 0; m < (int)members.size(); m++, u += 5 ){
+        k = u[0] * members.size();
+        if( k >= (int)members.size()) k--;
+        index     = members[k];
+        my_obj    = &obj_list[index];
+        old_x     = my_obj->pos_x;
+        old_y     = my_obj->pos_y;
+        old_angle = my_obj->orientation;
+        dU        = - domain_energy( index, around, n_around, the_force );
+
+        dist = u[1];                        // As in move()
+        if (dist == 0.0) dist=DBL_MIN;
+        dist = -2.0*log(dist)*dl_max;
+        angle = u[2];
+        my_obj->move( dist * sin(M_2PI*angle), dist * cos(M_2PI*angle));
+        my_obj->rotate( u[3] * 2*M_2PI - M_2PI );
+        if( is_periodic ){
+            while( my_obj->pos_x < 0 )      my_obj->pos_x += x_size;
+            while( my_obj->pos_x > x_size ) my_obj->pos_x -= x_size;
+            while( my_obj->pos_y < 0 )      my_obj->pos_y += y_size;
+            while( my_obj->pos_y > y_size ) my_obj->pos_y -= y_size;
+        }
+        if(( my_obj->pos_x >= 0 ) && ( my_obj->pos_x <= x_size ) &&
+           ( my_obj->pos_y >= 0 ) && ( my_obj->pos_y <= y_size ) &&
+           ( domain_of( my_obj->pos_x, my_obj->pos_y ) == domain )){
+            dU += domain_energy( index, around, n_around, the_force );
+            if( u[4] <= exp( - beta * dU )){
+                n_good++;
+                continue;
+            }
+        }
+        my_obj->pos_x       = old_x;        // Rejected
+        my_obj->pos_y       = old_y;
+        my_obj->orientation = old_angle;
+    }
+    return n_good;
+}
+
+/**
+ * The energy change of the configuration due to one object, its interactions
+ * with the objects in a list of domains plus half its interaction with the
+ * walls, as returned by trial_move().
+ *
+ * @param index     the object number.
+ * @param domains   the domains to look in.
+ * @param n_domains the number of domains.
+ * @param the_force the force field to use for the energy calculation.
+ * @return          the energy.
+ */
+double
+config::domain_energy(int index, int *domains, int n_domains,
+        force_field *the_force){
+    object  *my_obj = &obj_list[index];
+    double  value = 0.0;
+    int     j;
+
+    for( int k = 0; k < n_domains; k++ )
+        for( size_t m = 0; m < domain_list[ domains[k] ].size(); m++ )
+            if(( j = domain_list[ domains[k] ][m] ) != index )
+                value += pair_energy( my_obj, &obj_list[j], the_force );
+    return value + wall_energy( my_obj, the_force )/2.0;
+}
+
+/**
+ * Find the shift to apply to obj2, with periodic conditions, to get its
+ * closest image to obj1 and check if the centers are within range.
+ *
+ * @param  obj1      the first object.
+ * @param  obj2      the second object.
+ * @param  range     the center to center distance beyond which the objects
+ *                   can be ignored.
+ * @param  dx        receives the x shift.
+ * @param  dy        receives the y shift.
+ * @return false if the objects are further apart than range.
+ */
+bool
+config::closest_image(object *obj1, object *obj2, double range,
+        double *dx, double *dy){
+    double  r, r2;
+
+    *dx = *dy = 0.0;
+    if(is_periodic){                        // Use the closest image of obj2
+        r   = obj2->pos_x - obj1->pos_x;
+        *dx = (r<0)?x_size:-x_size;
+        r2  = r + *dx;
+        *dx = (abs(r2)<abs(r))?*dx:0.0;
+
+        r   = obj2->pos_y - obj1->pos_y;
+        *dy = (r<0)?y_size:-y_size;
+        r2  = r + *dy;
+        *dy = (abs(r2)<abs(r))?*dy:0.0;
+    }
+    r  = obj2->pos_x - obj1->pos_x + *dx;
+    r2 = obj2->pos_y - obj1->pos_y + *dy;
+    return ( r*r + r2*r2 <= range*range*BOUND_MARGIN );
+}
+
+/**
+ * The interaction energy between two objects, if there are periodic conditions
+ * the closest image of obj2 is used. Objects whose centers are further apart
+ * than the range given by the topology for their types do not interact and
+ * their atoms are not examined.
+ *
+ * @param  obj1      the first object.
+ * @param  obj2      the second object.
+ * @param  the_force the force field to use for the energy calculation.
+ * @return the interaction energy.
+ */
+double
+config::pair_energy(object *obj1, object *obj2, force_field *the_force){
+    double  dx, dy;
+
+    if( !closest_image( obj1, obj2,
+            the_topology->pair_range( obj1->o_type, obj2->o_type, the_force->cut_off ),
+            &dx, &dy )){
+        PROFILE_COUNT( COUNT_FAR_PAIRS, 1 );
+        return 0.0;                         // Too far apart for any atoms
+    }
+    return obj1->interaction( the_force, the_topology, obj2, dx, dy );
+}
+
+/**
+ * The interaction energy of an object with the boundary, this is zero with
+ * periodic conditions.
+ *
+ * @param  obj1      the object.
+ * @param  the_force the force field to use for the energy calculation.
+ * @return the interaction energy.
+ */
+double
+config::wall_energy(object *obj1, force_field *the_force){
+    if( is_periodic )
+        return 0.0;
+    if( is_rectangle )
+        return obj1->box_energy( the_force, the_topology, x_size, y_size );
+    return obj1->box_energy( the_force, the_topology, poly );
+}
+
+/**
+ * @brief Move an object in place and calculate the resulting energy change.
+ *
+ * The object is moved exactly as by move(), then its interactions with the
+ * neighbouring objects, before and after the move, are used to
+ * find the change in the total energy. The move must then be completed by a
+ * call to commit_move() or to reject_move(). No memory is allocated once the
+ * internal lists have reached their working size.
+ *
+ * @param obj_number the index of the object to move.
+ * @param dl_max     the scaling parameter for the move.
+ * @param the_force  the force field to use for the energy calculation.
+ * @return           the change in energy produced by the move.
+ */
+double
+config::trial_move(int obj_number, double dl_max, force_field *the_force){
+    object  *my_obj = &obj_list[obj_number];
+    double  value;
+    double  d_pair = 0.0;
+    double  range  = interaction_range( the_force );
+    int     *nbr;
+    int     n_nbr, k, j;
+
+    assert( trial_index < 0 );
+    {
+        PROFILE_PHASE( PHASE_NEIGHBOURS );
+        if( !verlet_ready( range ))         // Rebuild the lists if needed
+            update_cells( range );
+    }
+    {
+        PROFILE_PHASE( PHASE_ENERGY );
+        energy( the_force );                // Saved energies must be valid.
+    }
+    if( (int)trial_slot.size() != n_objects() )
+        trial_slot.assign( n_objects(), -1 );
+    trial_nbr.clear();
+    trial_delta.clear();
+
+    trial_index      = obj_number;
+    trial_x          = my_obj->pos_x;
+    trial_y          = my_obj->pos_y;
+    trial_angle      = my_obj->orientation;
+    trial_old_energy = my_obj->get_energy();
+    trial_d_wall     = - wall_energy( my_obj, the_force );
+
+                                            // Interactions before the move
+    {
+        PROFILE_PHASE( PHASE_NEIGHBOURS );
+        n_nbr = find_neighbours( obj_number, range, &nbr, nbr_scratch );
+    }
+    {
+        PROFILE_PHASE( PHASE_ENERGY );
+        for( k = 0; k < n_nbr; k++ ){
+            j = nbr[k];
+            trial_slot[j] = trial_nbr.size();
+            trial_nbr.push_back( j );
+            trial_delta.push_back( - pair_energy( my_obj, &obj_list[j], the_force ));
+        }
+    }
+    {
+        PROFILE_PHASE( PHASE_PROPOSAL );
+        move( obj_number, dl_max );         // Move it (also updates the cells)
+    }
+
+    trial_new_energy = 0.0;                 // Interactions after the move
+    {
+        PROFILE_PHASE( PHASE_NEIGHBOURS );
+        n_nbr = find_neighbours( obj_number, range, &nbr, nbr_scratch );
+    }
+    PROFILE_PHASE( PHASE_ENERGY );
+    for( k = 0; k < n_nbr; k++ ){
+        j = nbr[k];
+        value = pair_energy( my_obj, &obj_list[j], the_force );
+        trial_new_energy += value;
+        if( trial_slot[j] < 0 ){
+            trial_slot[j] = trial_nbr.size();
+            trial_nbr.push_back( j );
+            trial_delta.push_back( value );
+        } else {
+            trial_delta[ trial_slot[j] ] += value;
+        }
+    }
+    value = wall_energy( my_obj, the_force );
+    trial_new_energy += value;
+    trial_d_wall     += value;
+
+    for( k = 0; k < (int)trial_nbr.size(); k++ ){
+        d_pair += trial_delta[k];
+        trial_slot[ trial_nbr[k] ] = -1;    // Leave the slots clean
+    }
+    return d_pair + trial_d_wall/2.0;       // Wall energy is only counted once.
+}
+
+/**
+ * @brief Move an object in place if it does not then overlap anything.
+ *
+ * This is the whole Metropolis step for a force field with only hard cores,
+ * see force_field::is_hard(), and a configuration without overlaps. The
+ * energy is then zero and stays zero, any move without an overlap is
+ * accepted and any other rejected. The object is moved exactly as by move()
+ * and the neighbours are checked until the first overlap, no energies are
+ * calculated and the saved energies remain valid. If a vector version of
+ * the pair kernels is in use the hard core blocks of the topology are made
+ * for the force field when needed, so that molecules with enough atoms use
+ * block_overlap(), the scalar version is slower than the unrolled kernels.
+ *
+ * @param obj_number the index of the object to move.
+ * @param dl_max     the scaling parameter for the move.
+ * @param the_force  the force field giving the hard cores.
+ * @return           true if the move was kept.
+ */
+bool
+config::hard_move(int obj_number, double dl_max, force_field *the_force){
+    object  *my_obj = &obj_list[obj_number];
+    double  range   = interaction_range( the_force );
+    double  dx, dy;
+    bool    overlap = false;
+    int     *nbr;
+    int     n_nbr;
+
+    assert( trial_index < 0 );
+    {
+        PROFILE_PHASE( PHASE_NEIGHBOURS );
+        if( !verlet_ready( range ))
+            update_cells( range );
+    }
+    if( pair_kernel() != KERNEL_SCALAR )
+        the_topology->compile_hard( the_force );
+    trial_index = obj_number;               // Verlet list waits for the result
+    trial_x     = my_obj->pos_x;
+    trial_y     = my_obj->pos_y;
+    trial_angle = my_obj->orientation;
+
+    {
+        PROFILE_PHASE( PHASE_PROPOSAL );
+        move( obj_number, dl_max );
+    }
+    {
+        PROFILE_PHASE( PHASE_NEIGHBOURS );
+        n_nbr = find_neighbours( obj_number, range, &nbr, nbr_scratch );
+    }
+    {
+        PROFILE_PHASE( PHASE_ENERGY );
+        int k = 0;
+        if( wall_energy( my_obj, the_force ) > 0.0 )
+            overlap = true;
+        for( ; ( k < n_nbr ) && !overlap; k++ )
+            if( closest_image( my_obj, &obj_list[nbr[k]],
+                    the_topology->pair_range( my_obj->o_type, obj_list[nbr[k]].o_type,
+                                              the_force->cut_off ), &dx, &dy ))
+                overlap = my_obj->overlaps( the_force, the_topology, &obj_list[nbr[k]], dx, dy );
+            else
+                PROFILE_COUNT( COUNT_FAR_PAIRS, 1 );
+        if( overlap && ( k < n_nbr ))       // Neighbours left unchecked
+            PROFILE_COUNT( COUNT_OVERLAP_EXITS, 1 );
+    }
+
+    PROFILE_PHASE( PHASE_BOOKKEEPING );
+    if( overlap ){
+        my_obj->pos_x       = trial_x;
+        my_obj->pos_y       = trial_y;
+        my_obj->orientation = trial_angle;
+        if( cells ) cells->update( obj_number, trial_x, trial_y );
+    } else if( verlet && !verlet->stale &&
+            verlet->moved_too_far( obj_number, my_obj->pos_x, my_obj->pos_y )){
+        verlet->refresh( obj_number, obj_list, cells );
+    }
+    trial_index = -1;
+    return !overlap;
+}
+
+/**
+ * @brief Make an event chain, the object moves straight along an axis until
+ * it hits another, which then carries on, until the chain length is used up.
+ *
+ * This is the move of event-chain Monte Carlo for hard discs. It is rejection
+ * free and leaves the Boltzmann distribution unchanged when the chains are
+ * made along +x and +y. Each object stops CHAIN_GAP times its contact
+ * distance short of the object it hits, so that rounding never makes an
+ * overlap. The next object hit is found with the cells, which are made at
+ * least twice the largest contact distance wide even when Verlet lists are
+ * used, a flight is cut into steps short enough that it can not hit anything
+ * outside the cells around the object. The energy stays zero and the saved
+ * energies remain valid.
+ *
+ * Event chains need periodic rectangular conditions, a force field with only
+ * hard cores, molecules of a single atom at the center, a box more than twice
+ * the largest contact distance wide and a configuration without overlaps,
+ * see can_chain().
+ *
+ * @param obj_number the index of the first object to move.
+ * @param axis       0 to move along +x, 1 to move along +y.
+ * @param length     the total distance moved by the objects of the chain.
+ * @param the_force  the force field giving the hard cores.
+ * @return           the number of collisions.
+ */
+int
+config::event_chain(int obj_number, int axis, double length,
+        force_field *the_force){
+    double  range = interaction_range( the_force );
+    double  period = ( axis == 0 ) ? x_size : y_size;
+    double  sigma_max = chain_contact( the_force );
+    double  free, sigma, da, db, contact, flight;
+    double  *pa;
+    int     n_collision = 0;
+    int     type, next, n_cells, j;
+    int     nbr[9];
+
+    assert(( trial_index < 0 ) && can_chain( the_force ));
+    verlet_ready( range );                  // Up to date if they are used
+    update_cells( simple_max( range, 2.0 * sigma_max ));
+    free = simple_min( cells->size, period/2.0 );
+    free -= sigma_max;                      // Can not reach unseen objects
+    assert( free > 0.0 );                   // The box is too small
+
+    while( length > 0.0 ){
+        object  *my_obj = &obj_list[obj_number];
+
+        type    = the_topology->molecules( my_obj->o_type ).the_atoms(0).type;
+        flight  = simple_min( length, free );
+        next    = -1;
+        n_cells = cells->neighbour_cells( cells->cell( obj_number ), nbr );
+        for( int k = 0; k < n_cells; k++ )
+            for( j = cells->first( nbr[k] ); j >= 0; j = cells->next( j )){
+                if( j == obj_number ) continue;
+                if( axis == 0 ){            // Distances along and across
+                    da = obj_list[j].pos_x - my_obj->pos_x;
+                    db = obj_list[j].pos_y - my_obj->pos_y;
+                    db -= y_size * floor( db / y_size + 0.5 );
+                } else {
+                    da = obj_list[j].pos_y - my_obj->pos_y;
+                    db = obj_list[j].pos_x - my_obj->pos_x;
+                    db -= x_size * floor( db / x_size + 0.5 );
+                }
+                da -= period * floor( da / period + 0.5 );
+                sigma = the_force->hard_distance( type,
+                            the_topology->molecules( obj_list[j].o_type ).the_atoms(0).type );
+                if(( da <= 0.0 ) || ( fabs( db ) >= sigma ))
+                    continue;               // Behind or not in the way
+                contact = da - sqrt( sigma*sigma - db*db ) - CHAIN_GAP * sigma;
+                contact = simple_max( contact, 0.0 );
+                if( contact < flight ){
+                    flight = contact;
+                    next   = j;
+                }
+            }
+
+        pa  = ( axis == 0 ) ? &my_obj->pos_x : &my_obj->pos_y;
+        *pa += flight;
+        if( *pa >= period ) *pa -= period;
+        cells->update( obj_number, my_obj->pos_x, my_obj->pos_y );
+        if( verlet && !verlet->stale &&
+                verlet->moved_too_far( obj_number, my_obj->pos_x, my_obj->pos_y ))
+            verlet->refresh( obj_number, obj_list, cells );
+        length -= flight;
+        if( next >= 0 ){                    // Collision, the other one goes on
+            obj_number = next;
+            n_collision++;
+        }
+    }
+    return n_collision;
+}
+
+/**
+ * @param  the_force the force field to use.
+ * @return true if event_chain() can be used: periodic rectangular conditions,
+ *         only hard cores, molecules of one atom at their center, a box
+ *         more than twice the largest contact distance wide, so that an
+ *         object can not meet the same one in both directions, and no
+ *         overlaps.
+ */
+bool
+config::can_chain(force_field *the_force){
+    double  width = simple_min( x_size, y_size );
+
+    if( !is_periodic || !is_rectangle || !the_topology || !the_force->is_hard())
+        return false;
+    for( size_t i = 0; i < the_topology->n_molecules; i++ )
+        if(( the_topology->molecules(i).n_atoms != 1 ) || ( the_topology->extent(i) != 0.0 ))
+            return false;
+    if( 2.0 * chain_contact( the_force ) >= width )
+        return false;                       // The box is too small
+    return ( energy( the_force ) == 0.0 );
+}
+
+/**
+ * @param  the_force the force field to use.
+ * @return the largest contact distance between the single atom molecules of
+ *         an event chain.
+ */
+double
+config::chain_contact(force_field *the_force){
+    double  sigma_max = 0.0;
+
+    for( size_t i = 0; i < the_topology->n_molecules; i++ )
+        for( size_t k = 0; k < the_topology->n_molecules; k++ )
+            sigma_max = simple_max( sigma_max, the_force->hard_distance(
+                            the_topology->molecules(i).the_atoms(0).type,
+                            the_topology->molecules(k).the_atoms(0).type ));
+    return sigma_max;
+}
+
+/**
+ * @brief Keep the last trial move.
+ *
+ * The energy of the moved object and those of its neighbours are updated so
+ * that the saved energy remains valid without a new calculation. If the
+ * object has moved too far its Verlet list is remade.
+ */
+void
+config::commit_move(){
+    double  d_pair = 0.0;
+    object  *my_obj;
+
+    assert( trial_index >= 0 );
+    for( int k = 0; k < (int)trial_nbr.size(); k++ ){
+        my_obj = &obj_list[ trial_nbr[k] ];
+        my_obj->set_energy( my_obj->get_energy() + trial_delta[k] );
+        d_pair += trial_delta[k];
+    }
+    my_obj = &obj_list[trial_index];
+    my_obj->set_energy( trial_new_energy );
+    saved_energy += 2.0 * d_pair + trial_d_wall;
+    if( verlet && !verlet->stale &&
+            verlet->moved_too_far( trial_index, my_obj->pos_x, my_obj->pos_y ))
+        verlet->refresh( trial_index, obj_list, cells );
+    trial_index = -1;
+}
+
+/**
+ * @brief Undo the last trial move.
+ *
+ * The object is put back in its original position and orientation.
+ */
+void
+config::reject_move(){
+    object  *my_obj;
+
+    assert( trial_index >= 0 );
+    my_obj = &obj_list[trial_index];
+    my_obj->pos_x       = trial_x;
+    my_obj->pos_y       = trial_y;
+    my_obj->orientation = trial_angle;
+    my_obj->set_energy( trial_old_energy );
+    if( cells ) cells->update( trial_index, trial_x, trial_y );
+    trial_index = -1;
+}
+
+/**
+ * The largest distance between object centers at which two objects can still
+ * interact. This is the force field cut off plus the distance from the center
+ * to the furthest atom for each of the two objects.
+ *
+ * @param  the_force the force field that will be used for the energy.
+ * @return the interaction range.
+ */
+double
+config::interaction_range(force_field *the_force){
+    double  extent = 0.0;
+
+    if( the_topology )
+        for( size_t i = 0; i < the_topology->n_molecules; i++ )
+            extent = simple_max( extent, the_topology->extent( i ));
+    return the_force->cut_off + 2.0 * extent;
+}
+
+/**
+ * Make sure that the cell list exists and that its cells are large enough
+ * for the requested range, if not (re)build it from the object positions.
+ *
+ * @param range the largest distance at which objects need to be found.
+ */
+void
+config::update_cells(double range){
+    if( cells && ( cells->size >= range ))
+        return;
+    drop_cells();
+    if( is_rectangle )
+        cells = new cell_list( 0.0, 0.0, x_size, y_size, range, is_periodic );
+    else
+        cells = new cell_list( poly->x_min(), poly->y_min(),
+                    poly->x_max() - poly->x_min(), poly->y_max() - poly->y_min(),
+                    range, false );
+    for(int i = 0; i < (int)obj_list.size(); i++ )
+        cells->insert( i, obj_list[i].pos_x, obj_list[i].pos_y );
+}
+
+/**
+ * The largest distance between object centers at which two objects can
+ * clash. This is twice the largest distance from an object center to the far
+ * side of one of its atoms.
+ *
+ * @return the clash range.
+ */
+double
+config::clash_range(){
+    double  extent = 0.0;
+
+    if( the_topology )
+        for( size_t i = 0; i < the_topology->n_molecules; i++ )
+            extent = simple_max( extent, the_topology->bound_radius( i ));
+    return 2.0 * extent;
+}
+
+/**
+ * Discard the cell list, this is necessary when the boundary changes or
+ * objects are moved other than through the config methods. A new one will
+ * be built when it is next needed, and the Verlet lists are rebuilt too. The
+ * total energy is summed again when it is next asked for, as the objects may
+ * have moved.
+ */
+void
+config::drop_cells(){
+    if( cells ) delete cells;
+    cells = (cell_list *)NULL;
+    if( verlet ) verlet->stale = true;
+    unchanged = false;
+}
+
+/**
+ * @brief Use Verlet lists to find the neighbours of the objects.
+ *
+ * A larger skin means fewer rebuilds but longer lists, verlet_builds() helps
+ * to find a good compromise.
+ *
+ * @param skin  the distance added to the interaction range in the lists, if
+ *              zero or negative the lists are not used.
+ */
+void
+config::use_verlet(double skin){
+    if( verlet ) delete verlet;
+    verlet      = (verlet_list *)NULL;
+    verlet_skin = simple_max( skin, 0.0 );
+}
+
+/**
+ * @return The number of times the Verlet lists have been built.
+ */
+int
+config::verlet_builds(){
+    return verlet ? verlet->n_builds : 0;
+}
+
+/**
+ * @return The number of times the Verlet list of a single object was remade
+ *         because it had moved too far.
+ */
+int
+config::verlet_updates(){
+    return verlet ? verlet->n_refresh : 0;
+}
+
+/**
+ * If Verlet lists are in use make sure that they cover the range and are
+ * up to date, rebuilding them (and if necessary the cells) when they are
+ * stale.
+ *
+ * @param range the largest distance at which objects need to be found.
+ * @return true if the Verlet lists are in use.
+ */
+bool
+config::verlet_ready(double range){
+    int     n_builds  = 0;
+    int     n_refresh = 0;
+
+    if( verlet_skin <= 0.0 )
+        return false;
+    if( verlet && ( verlet->range < range )){   // Interactions got longer
+        n_builds  = verlet->n_builds;
+        n_refresh = verlet->n_refresh;
+        delete verlet;
+        verlet = (verlet_list *)NULL;
+    }
+    if( !verlet ){
+        verlet = new verlet_list( range, verlet_skin );
+        verlet->n_builds  = n_builds;
+        verlet->n_refresh = n_refresh;
+    }
+    if( verlet->stale ){
+        update_cells( verlet->cell_size() );
+        verlet->build( obj_list, cells, x_size, y_size, is_periodic );
+    }
+    return true;
+}
+
+/**
+ * @brief Find the objects that may be within range of an object.
+ *
+ * The Verlet list of the object is used if it is valid and long enough,
+ * otherwise the objects in the neighbouring cells are collected, the cells
+ * being built first if they are missing or too small. The list found may
+ * include objects that are further away but never the object itself. With
+ * several threads the callers must make the cells beforehand.
+ *
+ * @param index the object number.
+ * @param range the distance within which all objects must be found.
+ * @param list  set to point to the neighbours found, this is only valid
+ *              until scratch is next used.
+ * @param scratch space for the neighbours found through the cells, each
+ *              thread needs its own.
+ * @return      the number of neighbours.
+ */
+int
+config::find_neighbours(int index, double range, int **list,
+        std::vector<int> &scratch){
+    object  *my_obj = &obj_list[index];
+    int     nbr[9];
+    int     n_cells;
+
+    if( verlet && !verlet->stale && ( verlet->range >= range ) &&
+            !verlet->moved_too_far( index, my_obj->pos_x, my_obj->pos_y )){
+        *list = verlet->neighbours( index );
+        PROFILE_COUNT( COUNT_VERLET_LOOKUPS, 1 );
+        PROFILE_COUNT( COUNT_NEIGHBOURS, verlet->n_neighbours( index ));
+        return verlet->n_neighbours( index );
+    }
+    update_cells( range );                  // Only if missing or too small
+    PROFILE_COUNT( COUNT_CELL_LOOKUPS, 1 );
+    scratch.clear();
+    n_cells = cells->neighbour_cells( cells->cell( index ), nbr );
+    for( int k = 0; k < n_cells; k++ )
+        for( int j = cells->first( nbr[k] ); j >= 0; j = cells->next( j ))
+            if( j != index ) scratch.push_back( j );
+    PROFILE_COUNT( COUNT_NEIGHBOURS, scratch.size() );
+    *list = scratch.data();
+    return scratch.size();
+}
+
 /**
  * Write the current configuration to a file in a format that can be used to
  * reinitialize a configuration with the file based constructor. See the class
@@ -382,7 +1467,9 @@ int config::n_objects(){
 }
 
 /**
- * This function tests if there is a clash between the 2 objects obj1 and obj2
+ * This function tests if there is a clash between the 2 objects obj1 and obj2.
+ * The atoms are only compared if the bounding circles of the objects, from
+ * the topology, overlap.
  *
  * @param obj1 a pointer to the first object.
  * @param obj2 a pointer to the second object.
@@ -390,79 +1477,89 @@ int config::n_objects(){
  */
 bool
 config::test_clash( object *obj1, object *obj2 ){
-
-    double  theta1 = obj1->orientation;
-    double  theta2 = obj2->orientation;
-    int     o_type1 = obj1->o_type;
-    int     o_type2 = obj2->o_type;
-
-    double  t1, t2, dx1, dx2, dy1, dy2, r1, r2, x1, x2, y1, y2;
-    double  dx, dy, r;
+    double  dx, dy, range;
 
     if( ! the_topology ){		// No topology (so no size) just points.
         return(( obj1->pos_x == obj2->pos_x ) && ( obj1->pos_y == obj2->pos_y ));
     }
 
-    for(int j = 0; j < the_topology->molecules(o_type2).n_atoms; j++ ){
-                                        // Get atom information
-        t2  =  the_topology->molecules(o_type2).the_atoms(j).type;
-        dx2 =  the_topology->molecules(o_type2).the_atoms(j).x_pos;
-        dy2 =  the_topology->molecules(o_type2).the_atoms(j).y_pos;
-        r2  =  the_topology->atom_sizes(t2);      // Get radius
-                                        // Calculate atom position
-        x2  =  obj2->pos_x + dx2 * cos(theta2) - dy2 * sin(theta2);
-        y2  =  obj2->pos_y + dx2 * sin(theta2) + dy2 * cos(theta2);
-
-        for( int k = 0; k < the_topology->molecules(o_type1).n_atoms; k++ ){
-                                        // Get atom information
-            t1  =  the_topology->molecules(o_type1).the_atoms(k).type;
-            dx1 =  the_topology->molecules(o_type1).the_atoms(k).x_pos;
-            dy1 =  the_topology->molecules(o_type1).the_atoms(k).y_pos;
-            r1  =  the_topology->atom_sizes(t1);  // Get radius
-                                        // Calculate atom position
-            x1  =  obj1->pos_x + dx1 * cos(theta1) - dy1 * sin(theta1);
-            y1  =  obj1->pos_y + dx1 * sin(theta1) + dy1 * cos(theta1);
-
-            dx = (x2-x1);
-            dy = (y2-y1);
-                                        // Handle periodic conditions
-            if( is_periodic ){          // Find closest image
-                if( dx > (x_size - r1 - r2 )) dx -= x_size;
-                if( dx < (r1 + r2 - x_size )) dx += x_size;
-                if( dy > (y_size - r1 - r2 )) dy -= y_size;
-                if( dy < (r1 + r2 - y_size )) dy += y_size;
-            }
-            r = dx*dx+dy*dy;
-            if( r < ((r1+r2)*(r1+r2))) return true;
-        }
+    dx    = obj2->pos_x - obj1->pos_x;
+    dy    = obj2->pos_y - obj1->pos_y;
+    if( is_periodic ){                      // Closest image
+        if( dx >  x_size/2.0 ) dx -= x_size;
+        if( dx < -x_size/2.0 ) dx += x_size;
+        if( dy >  y_size/2.0 ) dy -= y_size;
+        if( dy < -y_size/2.0 ) dy += y_size;
     }
+    range = the_topology->clash_range( obj1->o_type, obj2->o_type );
+    if( dx*dx + dy*dy > range*range*BOUND_MARGIN )
+        return false;                       // Bounding circles apart
+
+    obj1->update_atoms( the_topology );     // Atom positions from the caches
+    obj2->update_atoms( the_topology );
+    for( int k = 0; k < obj1->n_atoms; k++ ) // Each atom against all of obj2
+        if( pair_overlap( obj1->atom_x[k], obj1->atom_y[k], obj1->atom_r[k],
+                    obj2->n_atoms, obj2->atom_x, obj2->atom_y, obj2->atom_r,
+                    is_periodic ? x_size : 0.0, is_periodic ? y_size : 0.0 ))
+            return true;
     return false;
 }
 
 /**
  * This function tests if there are any clashes the configuration using the
- * topology file but not the forcefield
+ * topology file but not the forcefield. Only neighbouring objects are
+ * compared, using the Verlet lists or the cells (which are built if they do
+ * not cover the clash range). Large configurations are shared between the
+ * threads in blocks of neighbouring objects.
  *
  * @return true if there is a clash otherwise false.
  */
 bool
 config::test_clash(){
-    object *obj1;
-    object *obj2;
-
-    for(int i=0;i<(int)obj_list.size();i++){
-        obj1 = &obj_list[i];
-        for(int j=0; j<i; j++){
-            obj2 = &obj_list[j];
-            if( test_clash( obj1, obj2 )) return true;
+    double range = clash_range();
+    int    *nbr;
+    int    n_nbr;
+    thread_pool *the_pool = get_pool();
+    std::atomic<bool> found( false );
+
+    if(!( verlet && !verlet->stale && ( verlet->range >= range )))
+        update_cells( range );
+    if( !the_pool || ( n_objects() < PARALLEL_OBJECTS )){
+        for(int i=0;i<(int)obj_list.size();i++){
+            n_nbr = find_neighbours( i, range, &nbr, nbr_scratch );
+            for(int k=0; k<n_nbr; k++)
+                if(( nbr[k] < i ) && test_clash( &obj_list[i], &obj_list[nbr[k]] ))
+                    return true;
         }
+        return false;
     }
-    return false;
+
+    if( the_topology )                      // Caches are shared between threads
+        for(int i=0;i<(int)obj_list.size();i++)
+            obj_list[i].update_atoms( the_topology );
+    cell_order( work_order, false );
+    the_pool->run(( work_order.size() + PARALLEL_BLOCK - 1 ) / PARALLEL_BLOCK,
+        [&]( int task, int thread ){
+            int end = simple_min((int)work_order.size(), ( task + 1 ) * PARALLEL_BLOCK );
+            int *list;
+            int n, i;
+            for(int k = task * PARALLEL_BLOCK; ( k < end ) && !found; k++ ){
+                i = work_order[k];
+                n = find_neighbours( i, range, &list, thread_scratch[thread] );
+                for(int j = 0; j < n; j++ )
+                    if(( list[j] < i ) && test_clash( &obj_list[i], &obj_list[list[j]] )){
+                        found = true;
+                        return;
+                    }
+            }
+        });
+    return found;
 }
 
 /**
  * This function tests if the new_object can be inserted into the configuration
- * without generating a clash (as determined by the topology file).
+ * without generating a clash (as determined by the topology file). With
+ * several threads large configurations are divided between them.
  *
  * @param new_object a pointer to a valid object to test for insertion.
  * @return true if there is a clash otherwise false.
@@ -492,6 +1589,17 @@ config::test_clash( object *new_object ){
                 if( ! poly->is_inside( x1, y1, r1 )) return true;
             }
         }
+    }
+    if(( n_objects() >= PARALLEL_OBJECTS ) && get_pool()){
+        std::atomic<bool> found( false );   // Each object is in one task only
+        if( the_topology ) new_object->update_atoms( the_topology );
+        pool->run(( n_objects() + PARALLEL_BLOCK - 1 ) / PARALLEL_BLOCK,
+            [&]( int task, int thread ){
+                int end = simple_min( n_objects(), ( task + 1 ) * PARALLEL_BLOCK );
+                for(int i = task * PARALLEL_BLOCK; ( i < end ) && !found; i++ )
+                    if( test_clash( &obj_list[i], new_object )) found = true;
+            });
+        return found;
     }
                                             // Loop over the objects.
     for(int i = 0; i < n_objects(); i++){
@@ -575,6 +1683,7 @@ bool config::expand(double dl){
         poly->expand( dl );
     }
     unchanged = false;                      	// The energies will be different
+    drop_cells();                               // The grid no longer fits
     for(i=0;i<(int)obj_list.size();i++){
         obj_list[i].recalculate = true;		// Also for the objects
         obj_list[i].expand(dl);        		// Move objects in rescaled box
@@ -603,6 +1712,7 @@ bool config::expand(double dl, int max_try ){
         poly->expand( dl );
     }
     unchanged = false;                      // The energies will be different
+    drop_cells();                           // The grid no longer fits
     for(i=0;i<(int)obj_list.size();i++){
         obj_list[i].recalculate = true;// Also for the objects
         obj_list[i].expand(dl);        // Move objects in rescaled box
@@ -659,6 +1769,7 @@ config::translate( double dx, double dy ){
     	obj_list[i].pos_x += dx;
     	obj_list[i].pos_y += dy;
     }
+    drop_cells();
 }
 
 /**
@@ -676,6 +1787,7 @@ config::rect_2_poly(){
         poly->add_vertex( x_size, y_size );
         poly->add_vertex(   0.00, y_size );
         is_rectangle = false;
+        drop_cells();
         return true;
     }
     return false;
@@ -701,6 +1813,7 @@ config::poly_2_rect(){
     x_size = poly->get_vertex(1).x;
     y_size = poly->get_vertex(3).y;
     delete( poly );
+    drop_cells();
     return true;
 }
 
@@ -846,6 +1959,7 @@ config::set_poly(polygon *a_poly){
 	poly = a_poly;
 	unchanged = false;
 	is_periodic  = false;
+	drop_cells();
 }
 
 /**
@@ -880,6 +1994,10 @@ void config::fix_inbox( int obj_number ){
 
     obj_list[obj_number].pos_x = pos_x;
     obj_list[obj_number].pos_y = pos_y;
+    if( cells ) cells->update( obj_number, pos_x, pos_y );
+    if(( obj_number != trial_index ) && verlet && !verlet->stale &&
+            verlet->moved_too_far( obj_number, pos_x, pos_y ))
+        verlet->refresh( obj_number, obj_list, cells );    // Trial moves wait for commit
 }
 
 /**
@@ -903,6 +2021,7 @@ void
 config::rotate( double angle ){
     if( is_rectangle ) rect_2_poly();
     poly->rotate( angle );
+    drop_cells();
     for(int i=0; i< n_objects(); i++){
     	  /// TODO fix positions
         /// calculate new xy coordinates TODO
@@ -912,7 +2031,8 @@ config::rotate( double angle ){
 
 /**
  * Mark as needing recalculation of energies all objects within a certain
- * distance of a reference object.
+ * distance of a reference object. Only the neighbouring objects, from the
+ * Verlet list or the cell list, are examined.
  *
  * @param distance the cut-off distance to use.
  * @param index the number of the reference object.
@@ -920,13 +2040,15 @@ config::rotate( double angle ){
 void    config::invalidate_within(double distance, int index){
     object  *obj1;
     object  *obj2;
+    int     *nbr;
+    int     n_nbr;
 
     obj1 = &obj_list[index];
-    for(int i=0; i< n_objects(); i++)       // For each object in the cnfiguration
-      if (i!= index){                       // That is difference
-        obj2 = &obj_list[i];             // Check distance
+    n_nbr = find_neighbours( index, distance, &nbr, nbr_scratch );
+    for(int k = 0; k < n_nbr; k++ ){
+        obj2 = &obj_list[nbr[k]];
         if( obj1->distance(obj2, x_size, y_size, is_periodic) < distance ) // TODO: Need to check works for non-rectangles
-            obj2->recalculate = true;       // and set flag if necessary
+            obj2->recalculate = true;
     }
 }
 
@@ -940,6 +2062,11 @@ void    config::add_topology(topology* a_topology){
     if( the_topology )                      // If there is already one
         delete( the_topology );             // Get rid of it
     the_topology = a_topology;              // Make the new association
+    unchanged = false;                      // Energies and atom caches are
+    for(int i = 0; i < (int)obj_list.size(); i++ ){ // no longer valid
+        obj_list[i].recalculate = true;
+        obj_list[i].forget_atoms();
+    }
 }
 
 /**
@@ -972,6 +2099,8 @@ config::height(){
  */
 void    config::add_object(object* orig ){
     obj_list.push_back(*orig);
+    if( cells ) cells->insert( obj_list.size() - 1, orig->pos_x, orig->pos_y );
+    if( verlet ) verlet->stale = true;
 }
 
 /** \brief Fetch object from list by index
@@ -1063,11 +2192,11 @@ config::ps_atoms( std::ostream& dest ){
 
 bool
 config::has_clash( int i ){
-    for(int j=0; j< (int) obj_list.size(); j++ ){
-        if (i!=j) {
-            if( test_clash( &obj_list[i], &obj_list[j] )) return true;
-        }
-    }
+    int     *nbr;
+    int     n_nbr = find_neighbours( i, clash_range(), &nbr, nbr_scratch );
+
+    for(int k=0; k<n_nbr; k++ )
+        if( test_clash( &obj_list[i], &obj_list[nbr[k]] )) return true;
     return false;
 }
 
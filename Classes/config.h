@@ -28,6 +28,12 @@
  * There are methods for associating objects with the configuration.
  * * add_topology(tp) Associates the topology tp with the configuration.
  *
+ * read(source) and read(traj, frame) replace the boundary and objects of an
+ * existing configuration, reusing its storage, as the constructors would make
+ * them. They are used to read long trajectories without a new configuration
+ * for each frame. read(check) does the same with the exact positions saved in
+ * a checkpoint.
+ *
  * There are three output methods:
  * * write(fp) that writes the configuration to the file pointer fp, that should be
  *              open for writing, in a format that can be used to recreate
@@ -55,6 +61,43 @@
  *              less than the distance 'r' from object number 'no' as needing
  *              recalculation.
  *
+ * Trial moves, used by the integrators, modify the configuration in place:
+ * * trial_move( no, dl, ff ) moves object number 'no' as move() does and
+ *              returns the resulting energy change, only the neighbours of the
+ *              object are examined.
+ * * commit_move() keeps the last trial move and updates the saved energies.
+ * * reject_move() puts the object back where it was.
+ * * hard_move( no, dl, ff ) moves object number 'no' as move() does and
+ *              keeps the move if there is then no overlap. This is all that is
+ *              needed with a force field that only has hard cores.
+ * * event_chain( no, axis, l, ff ) moves hard discs in an event chain of
+ *              length l along x or y starting with object number 'no'.
+ *
+ * To avoid comparing every pair of objects the configuration keeps a cell_list,
+ * a grid of cells at least as large as the interaction range, that is built
+ * when the energy is first needed, rebuilt when the boundary changes and
+ * updated as objects move. Code that changes object positions directly, rather
+ * than through the methods above, must call drop_cells() afterwards.
+ *
+ * For dense systems use_verlet( skin ) asks the configuration to also keep a
+ * verlet_list, the neighbours of each object within the interaction range plus
+ * skin. The list of an object is remade, using the cells, once it has moved
+ * more than skin/2 and the whole list when the configuration changes. These
+ * are counted by verlet_updates() and verlet_builds() so that the skin can be
+ * tuned. Energies, trial moves, invalidate_within() and the clash tests then
+ * use these lists.
+ *
+ * With set_threads( n ) the full energy calculations and the clash tests
+ * of large configurations are shared between n threads. The objects are
+ * handed out in blocks in cell order, so that each thread works on a compact
+ * region, and the energy is summed in object order afterwards so the result
+ * does not depend on the number of threads.
+ *
+ * checkerboard_sweep( dl, beta, ff ) tries to move every object once, the
+ * box is cut into a checkerboard of domains wider than the interaction range
+ * and the threads move objects in domains that do not touch at the same time.
+ * This is only possible with rectangular boundaries.
+ *
  * Methods that operate on a pair of configurations
  * * rms( ref ) compare the configuration with that a reference configuration 'ref'
  *              and return the rms distance between atoms in the two configurations.
@@ -76,9 +119,21 @@
 
 #include "object.h"
 #include "polygon.h"
+#include "cell_list.h"
+#include "verlet_list.h"
+#include "thread_pool.h"
+#include "trajectory.h"
+
+#define PARALLEL_OBJECTS    1024    ///< Fewest objects worth sharing between threads
+#define PARALLEL_BLOCK      128     ///< Objects in each task given to a thread
+#define CHAIN_GAP           1e-10   ///< Relative gap left between discs by event chains
+#define BOUND_MARGIN        (1.0+1e-12) ///< Allowance for rounding when skipping distant pairs
 
 using namespace std;
 
+class config_lines;
+class checkpoint;
+
 class config {
 public:
     config();                       ///< Create a new empty conformation.
@@ -86,6 +141,8 @@ public:
     config(config *orig);           ///< Copy an existing conformation bis.
     config(std::string in_file);    ///< Create by reading a named file.
     config(std::istream& source);   ///< Create from an input source.
+    config(trajectory *a_traj, long frame
+           );                       ///< Create from a frame of a binary trajectory.
 
     virtual 			~config();              ///< Destroy a conformation
 
@@ -96,6 +153,12 @@ public:
     int         		write(FILE *dest);  ///< Write the conformation to a 'c' file.
     void        		ps_atoms(std::ostream& dest
                                );   ///< Write the postscript part for the atoms.
+    void				read(std::istream& source
+                               );   ///< Replace the boundary and objects by the next ones in a stream.
+    void				read(trajectory *a_traj, long frame
+                               );   ///< Replace the boundary and objects by a frame of a binary trajectory.
+    void				read(checkpoint *a_check
+                               );   ///< Replace the boundary and objects by those of a checkpoint.
 
 /* Setting up a configuration */
     void      			add_topology(topology *a_topology
@@ -139,6 +202,30 @@ public:
     void    			fix_inbox( int obj_number ); ///< Force object inside perimeter.
     void    			invalidate_within(double distance, int index 
                                  ); ///< Mark energies for recalculation.
+    void				drop_cells();       ///< Forget the cell list after changing positions.
+    void				use_verlet(double skin
+                                 ); ///< Keep Verlet lists with this skin (0 for none).
+    int					verlet_builds();    ///< Number of times the Verlet lists were built.
+    int					verlet_updates();   ///< Number of single object Verlet list updates.
+    void				set_threads(int n); ///< Use n threads (0 for one per core) for full calculations.
+    int					checkerboard_sweep(double dl_max, double beta,
+                                force_field *the_force, int *n_tried
+                                 ); ///< Try to move each object once, domains in parallel.
+
+/* Trial moves */
+    double				trial_move(int obj_number, double dl_max,
+                                force_field *the_force
+                                 ); ///< Move an object and return the energy change.
+    bool				hard_move(int obj_number, double dl_max,
+                                force_field *the_force
+                                 ); ///< Move an object if it does not then overlap anything.
+    int					event_chain(int obj_number, int axis,
+                                double length, force_field *the_force
+                                 ); ///< Move a chain of hard discs along an axis, return the collisions.
+    bool				can_chain(force_field *the_force
+                                 ); ///< Can event_chain() be used.
+    void				commit_move();      ///< Accept the last trial move.
+    void				reject_move();      ///< Undo the last trial move.
     object				*get_object(int index); ///< find an object in the configuration (JS 8/1/20)
     bool					rect_2_poly();	    ///< Convert rectangle container to a polygon.
     bool					poly_2_rect();	    ///< Convert rectangular polygon container to a rectangle.
@@ -152,8 +239,8 @@ private:
     bool        		has_clash( int i ); ///< check if the object with index i has a clash. 
     void        		jiggle();           ///< Shake objects a bit to try and remove bad contacts.
 
-    void					config_read(std::istream& src
-                                 ); ///< Helper function reading from a stream.
+    void					config_read(config_lines& lines
+                                 ); ///< Helper function reading the lines of a file.
 
     double      		saved_energy;       ///< The last result of energy evaluation.
     std::vector<object>	obj_list;           ///< The objects in the configuration
@@ -161,6 +248,66 @@ private:
     bool        		check();            ///< Is the current configuration valid?
     bool 				objects_inside(polygon *a_poly
     							 );			///< Verify all objects are inside perimeter.
+    double				interaction_range(force_field *the_force
+    							 );			///< Largest center to center distance with a non zero interaction.
+    void				update_cells(double range
+    							 );			///< Make sure the cell list exists with cells at least range wide.
+    cell_list			*cells;             ///< Spatial index of the objects (NULL until needed).
+    double				clash_range();      ///< Largest center to center distance for a clash.
+    double				chain_contact(force_field *the_force
+    							 );			///< Largest contact distance of the discs of event chains.
+    bool				verlet_ready(double range
+    							 );			///< Make sure the Verlet lists are valid for range, if in use.
+    int					find_neighbours(int index, double range,
+                                int **list, std::vector<int> &scratch
+                                 ); ///< Objects that may be within range of object index.
+    double				object_energy(int index, double range,
+                                force_field *the_force,
+                                std::vector<int> &scratch
+                                 ); ///< Energy of an object with its neighbours and the walls.
+    void				cell_order(std::vector<int> &order,
+                                bool flagged
+                                 ); ///< List the objects (or just those to recalculate) cell by cell.
+    thread_pool			*get_pool();        ///< The thread pool (NULL if using one thread).
+    verlet_list			*verlet;            ///< Neighbour lists (NULL if unused or not yet built).
+    double				verlet_skin;        ///< Skin for the Verlet lists, 0 if not used.
+    std::vector<int>	nbr_scratch;        ///< Neighbours found through the cells.
+    int					n_threads;          ///< Threads for full calculations.
+    thread_pool			*pool;              ///< Worker threads (NULL until needed).
+    std::vector< std::vector<int> > thread_scratch; ///< Neighbour scratch space for each thread.
+    std::vector<int>	work_order;         ///< Objects in the order they are handed out.
+    int					domain_of(double x, double y
+                                 ); ///< The checkerboard domain containing the point x, y.
+    int					domain_moves(int domain, uint64_t key,
+                                double dl_max, double beta,
+                                force_field *the_force
+                                 ); ///< Metropolis moves of the objects in one domain.
+    double				domain_energy(int index, int *domains,
+                                int n_domains, force_field *the_force
+                                 ); ///< Energy of an object with the objects of some domains.
+    int					dom_nx, dom_ny;     ///< Number of domains across and up the box.
+    double				dom_w, dom_h;       ///< Size of the domains.
+    double				dom_x0, dom_y0;     ///< Offset of the domain grid.
+    std::vector< std::vector<int> > domain_list; ///< Objects in each domain.
+    bool				closest_image(object *obj1, object *obj2,
+                                double range, double *dx, double *dy
+                                 ); ///< Shift to the closest image of obj2, false if beyond range.
+    double				pair_energy(object *obj1, object *obj2,
+                                force_field *the_force
+                                 ); ///< Interaction of obj1 with the closest image of obj2.
+    double				wall_energy(object *obj1,
+                                force_field *the_force
+                                 ); ///< Interaction of obj1 with the boundary.
+
+    int					trial_index;        ///< Object moved by the last trial move (-1 if none).
+    double				trial_x, trial_y;   ///< Position before the trial move.
+    double				trial_angle;        ///< Orientation before the trial move.
+    double				trial_old_energy;   ///< Object energy before the trial move.
+    double				trial_new_energy;   ///< Object energy after the trial move.
+    double				trial_d_wall;       ///< Change in wall energy of the trial move.
+    std::vector<int>	trial_nbr;          ///< Neighbours involved in the trial move.
+    std::vector<double>	trial_delta;        ///< Change in interaction with each neighbour.
+    std::vector<int>	trial_slot;         ///< Position of each object in trial_nbr (-1 if absent).
 };
 
 #endif /* CONFIG_H */
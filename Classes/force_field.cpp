@@ -6,6 +6,7 @@
 
 #include "common.h"
 #include "force_field.h"
+#include <atomic>
 #include <cstring>
 #include <ctype.h>
 #include <string>
@@ -15,6 +16,8 @@
 
 #define  BIGVALUE   10E6
 
+static std::atomic<uint64_t> n_compiled( 0 );  ///< Compilations by all the force fields
+
 #include <boost/format.hpp>
 using boost::format;
 
@@ -25,6 +28,7 @@ force_field::force_field() {
     length     = 1.0;
     type_max   = 0;
     big_energy = BIGVALUE;
+    stamp      = 0;
 }
 
 force_field::force_field(const force_field& orig) {
@@ -34,11 +38,15 @@ force_field::force_field(const force_field& orig) {
     length     = orig.length;
     type_max   = orig.type_max;
     big_energy = orig.big_energy;
+    radius.resize( type_max );
+    color.resize( type_max );
+    energy.resize( type_max, type_max );
     for( i=0; i< type_max; i++ ){
         radius(i) = orig.radius(i);
         color[i]  = orig.color[i];
         for( j = 0; j < type_max; j++ ) energy(i,j) = orig.energy(i, j);
     }
+    compile();
 }
 
 force_field::force_field( const char *file_name ){
@@ -47,6 +55,7 @@ force_field::force_field( const char *file_name ){
     length     = 1.0;
     type_max   = 0;
     big_energy = BIGVALUE;
+    stamp      = 0;
 
     if(( source = fopen( file_name, "r" )) != NULL ){
         read_force_field( source );
@@ -61,6 +70,7 @@ force_field::force_field( FILE *source ){
     length     = 1.0;
     type_max   = 0;
     big_energy = BIGVALUE;
+    stamp      = 0;
 
     read_force_field( source );
 }
@@ -71,6 +81,7 @@ force_field::force_field( float r ){
     length     = 1.0;
     type_max   = 1;
     big_energy = BIGVALUE;
+    stamp      = 0;
     
     radius.resize(1);
     color.resize(1);
@@ -79,6 +90,7 @@ force_field::force_field( float r ){
     radius[0] = r;
     color(0) = "red" ;		// Should not be here but fix later
     energy(0,0) = 0.0;
+    compile();
 }
 
 #define	COMMENTCHAR	'#'
@@ -160,6 +172,7 @@ force_field::read_force_field( FILE *source ){
         iss.clear();
     }
     free( line );					// Free line that is implicitly allocated.
+    compile();
 }
 
 force_field::~force_field() {                           // Probably need to get rid of arrays.
@@ -274,7 +287,7 @@ void force_field::update(std::string ff_filename) {
     
     // Close the stream
     ff.close();
-
+    compile();
 }
 
 double
@@ -300,6 +313,110 @@ force_field::interaction(int t1, int t2, double r) {
     return value;
 }
 
+/**
+ * @brief Sum the interaction energies of one atom with a series of atoms.
+ *
+ * @param t1    Type of the first atom.
+ * @param n     Number of other atoms.
+ * @param t2    Types of the other atoms.
+ * @param r2    Squared distances to the other atoms.
+ * @return      The total energy.
+ */
+double
+force_field::interactions(int t1, int n, const int *t2, const double *r2){
+    double  value = 0.0;
+
+    for( int j = 0; j < n; j++ )
+        value += interaction2( t1, t2[j], r2[j] );
+    return value;
+}
+
+/**
+ * @brief Test if an atom is within the hard core of any of a series of atoms.
+ *
+ * This is true exactly when interactions() would include a hard core energy.
+ *
+ * @param t1    Type of the first atom.
+ * @param n     Number of other atoms.
+ * @param t2    Types of the other atoms.
+ * @param r2    Squared distances to the other atoms.
+ * @return      true at the first overlap found.
+ */
+bool
+force_field::overlaps(int t1, int n, const int *t2, const double *r2){
+    for( int j = 0; j < n; j++ )
+        if( overlap2( t1, t2[j], r2[j] ))
+            return true;
+    return false;
+}
+
+/**
+ * @return true if no pair of atom types has a well, so that energies are
+ *         either zero or due to overlapping hard cores.
+ */
+bool
+force_field::is_hard(){
+    for( size_t k = 0; k < pairs.size(); k++ )
+        if( pairs[k].offset >= 0 )
+            return false;
+    return true;
+}
+
+/**
+ * @param t1    Type of the first atom.
+ * @param t2    Type of the second atom.
+ * @return      the distance below which the two atoms overlap, the hard
+ *              core distance or the cut off if that is smaller.
+ */
+double
+force_field::hard_distance(int t1, int t2){
+    return sqrt( pairs[ t1 * type_max + t2 ].hard2 );
+}
+
+/**
+ * @brief Compile the potential into tables indexed by the squared distance.
+ *
+ * For each pair of atom types the limits of the hard core and of the region
+ * where the energy is not zero are stored as squared distances. If the well
+ * is not empty it is tabulated between these limits, each bin holding the
+ * exact value at its start and the change in value to the end of the bin.
+ * The force field gets a new stamp.
+ */
+void
+force_field::compile(){
+    pair_potential  *p;
+    double          hard, end, dr2, v0, v1;
+    int             n_wells = 0;
+
+    pairs.resize( type_max * type_max );
+    table.clear();
+    for( int i = 0; i < type_max; i++ )
+        for( int j = 0; j < type_max; j++ ){
+            p    = &pairs[ i * type_max + j ];
+            hard = radius(i) + radius(j);
+            end  = simple_min( cut_off, hard + length );
+            p->hard2    = simple_min( hard * hard, cut_off * cut_off );
+            p->zero2    = end * end;
+            p->r2_min   = hard * hard;
+            p->inv_dr2  = 0.0;
+            p->offset   = -1;
+            if(( energy(i, j) == 0.0 ) || ( end <= hard ))
+                continue;                   // No well, nothing to tabulate
+            dr2 = ( p->zero2 - p->r2_min ) / TABLE_BINS;
+            p->inv_dr2 = 1.0 / dr2;
+            p->offset  = n_wells * TABLE_BINS;
+            table.resize( 2 * ( n_wells + 1 ) * TABLE_BINS );
+            for( int k = 0; k < TABLE_BINS; k++ ){ // Triangular well
+                v0 = energy(i, j) * ( 1.0 - ( sqrt( p->r2_min + k * dr2 ) - hard ) / length );
+                v1 = energy(i, j) * ( 1.0 - ( sqrt( p->r2_min + (k+1) * dr2 ) - hard ) / length );
+                table[ 2 * ( p->offset + k ) ]     = v0;
+                table[ 2 * ( p->offset + k ) + 1 ] = v1 - v0;
+            }
+            n_wells++;
+        }
+    stamp = ++n_compiled;
+}
+
 double  force_field::size(int t1){
     return radius[t1];
 }
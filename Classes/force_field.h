@@ -30,6 +30,23 @@
  * Constructor methods are defined for a a default force_field and a
  * copy constructor, and a destructor method.
  *
+ * For the inner loops of the energy calculation the potential is compiled,
+ * after the force field is read, into a table for each pair of atom types
+ * indexed by the squared distance. interaction2(t1, t2, r2) then avoids the
+ * square root and most of the branches: the cut off, the hard core and the
+ * end of the well are tested exactly on r2, and only the well itself, when
+ * it is not empty, is interpolated linearly from TABLE_BINS bins. The batch
+ * version interactions(t1, n, t2, r2) sums the energies of one atom with n
+ * others.
+ *
+ * A force field without any wells, is_hard(), only gives zero or big
+ * energies, so for it the only question is whether atoms overlap, which
+ * overlap2(t1, t2, r2) and overlaps(t1, n, t2, r2) answer from the same
+ * squared distances. Each compilation gives the force field a new stamp, so
+ * that tables made from it elsewhere, such as the hard core blocks of
+ * topology::compile_hard(), can tell if they are still those of this force
+ * field.
+ *
  * There are methods for:
  * * writing the forcefield to a file descriptor.
  * * obtaining the hard core size of an atom.
@@ -43,13 +60,29 @@
 #define FORCE_FIELD_H
 
 #include <stdio.h>
+#include <cstdint>
 #include <string>
+#include <vector>
+#include "common.h"
 #include <boost/numeric/ublas/vector.hpp>
 #include <boost/numeric/ublas/matrix.hpp>
 #include <boost/numeric/ublas/io.hpp>
 
 using namespace boost::numeric::ublas;      // For vector and matrix
 
+#define TABLE_BINS  512                     // Bins for the tabulated well
+
+/**
+ * \brief The compiled potential for one pair of atom types.
+ */
+typedef struct pair_potential {
+    double  hard2;                          ///< Square of the hard core distance
+    double  zero2;                          ///< Square of the distance beyond which the energy is zero
+    double  r2_min;                         ///< Start of the table (squared distance)
+    double  inv_dr2;                        ///< Reciprocal of the table bin width
+    int     offset;                         ///< First bin in the table (-1 if no well)
+} pair_potential;
+
 // The forcefield is currently read from a file.
 
 class force_field {
@@ -63,12 +96,26 @@ public:
 
     void        update(std::string ff_filename);
     double      interaction(int t1, int t2, double r); ///< Calculate interaction energy
+    inline double interaction2(int t1, int t2,
+                    double r2);             ///< Interaction energy from the squared distance
+    inline bool overlap2(int t1, int t2,
+                    double r2);             ///< Is the squared distance inside the hard core
+    double      interactions(int t1, int n,
+                    const int *t2,
+                    const double *r2);      ///< Sum of the energies of atom t1 with n atoms
+    bool        overlaps(int t1, int n,
+                    const int *t2,
+                    const double *r2);      ///< Is atom t1 inside the hard core of one of n atoms
+    inline double hard2(int t1, int t2);    ///< Square of the hard core distance used by overlaps()
+    bool        is_hard();                  ///< Are there only hard cores and no wells
+    double      hard_distance(int t1, int t2); ///< Distance below which atoms t1 and t2 overlap
     double      size(int t1);               ///< The hard core size of an atom type t1.
     void        write(FILE *dest);          ///< Write the forcefield to file
     void        write(std::ostream& dest);  ///< Write the forcefield to a stream.
     const char  *get_color(int t);          ///< Color for plot output should get rid of this (color in atoms)
     double      cut_off;                    ///< Distance cutoff between objects (part of integrator not force field)
     double      big_energy;                 ///< Large value less than infinity.
+    uint64_t    stamp;                      ///< Different after each compilation, 0 before the first.
 
     vector<double>      radius;             ///< Atom radii (should not be here atom properties)
 private:
@@ -80,7 +127,59 @@ private:
     int         cutoff;                     ///< The cutoff
     vector< std::string>  color;            ///< Atom colors for postscript (should not be here)
     matrix<double>      energy;             ///< Pairwise interaction well depths.
+
+    void        compile();                  ///< Build the tabulated potential.
+    std::vector<pair_potential> pairs;      ///< Compiled potential for each pair of types
+    std::vector<double> table;              ///< Value and slope for each bin of the wells
 };
 
+/**
+ * @brief The interaction energy of two atoms from their squared distance.
+ *
+ * @param t1    Type of the first atom.
+ * @param t2    Type of the second atom.
+ * @param r2    Square of the distance between the atoms.
+ * @return      The energy, using the compiled table.
+ */
+inline double
+force_field::interaction2(int t1, int t2, double r2){
+    const pair_potential  *p = &pairs[ t1 * type_max + t2 ];
+    const double          *bin;
+    double                u;
+    int                   k;
+
+    if( r2 >= p->zero2 ) return 0.0;        // Beyond the cut off or the well
+    if( r2 < p->hard2 )                     // Hard core (rare)
+        return interaction( t1, t2, sqrt( r2 ));
+    if( p->offset < 0 ) return 0.0;         // No well
+    u   = ( r2 - p->r2_min ) * p->inv_dr2;  // Position in the table
+    k   = (int)u;
+    k   = simple_min( k, TABLE_BINS - 1 );
+    bin = &table[ 2 * ( p->offset + k ) ];
+    return bin[0] + bin[1] * ( u - k );
+}
+
+/**
+ * @param t1    Type of the first atom.
+ * @param t2    Type of the second atom.
+ * @param r2    Square of the distance between the atoms.
+ * @return      true if interaction2() would give a hard core energy.
+ */
+inline bool
+force_field::overlap2(int t1, int t2, double r2){
+    return r2 < pairs[ t1 * type_max + t2 ].hard2;
+}
+
+/**
+ * @param t1    Type of the first atom.
+ * @param t2    Type of the second atom.
+ * @return      the squared distance below which overlap2() and overlaps()
+ *              find an overlap.
+ */
+inline double
+force_field::hard2(int t1, int t2){
+    return pairs[ t1 * type_max + t2 ].hard2;
+}
+
 #endif /* FORCE_FIELD_H */
 
@@ -0,0 +1,236 @@
+/**
+ * @file    frame_reader.cpp
+ * @author  James Sturgis
+ * @date    October 16, 2026
+ * @brief   Implementation of the frame_reader class.
+ */
+
+#include "frame_reader.h"
+#include "config.h"
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+/**
+ * @brief Constructor, starts the reader thread.
+ *
+ * @param a_names       the files to read in order, if empty std::cin is read.
+ * @param a_n_buffers   the number of configurations to use, at least 1. The
+ *                      reader can be this many frames ahead of the analysis.
+ * @param a_open        opens the text files, or NULL to open them as plain
+ *                      files.
+ */
+frame_reader::frame_reader(const std::vector<std::string>& a_names,
+        int a_n_buffers, opener a_open){
+    names     = a_names;
+    if( names.empty() ) names.push_back("");    // For std::cin
+    open      = a_open;
+    n_buffers = ( a_n_buffers > 0 ) ? a_n_buffers : 1;
+    n_frames  = 0;
+    finished  = false;
+    stopping  = false;
+    thread    = std::thread( &frame_reader::reader, this );
+}
+
+/**
+ * Destructor, stops the reader thread even if frames are left.
+ */
+frame_reader::~frame_reader(){
+    {
+        std::unique_lock<std::mutex> guard( lock );
+        stopping = true;
+    }
+    changed.notify_all();
+    thread.join();
+    for( size_t k = 0; k < buffers.size(); k++ )
+        delete buffers[k];
+}
+
+/**
+ * @brief The next frame, waiting until it has been read.
+ *
+ * @param number    if not NULL receives the number of the frame, from 0.
+ * @param step      if not NULL receives the step of the frame, for a single
+ *                  configuration its position in the file.
+ * @return          the configuration, to give back with release(), or NULL
+ *                  when all the frames have been given.
+ */
+config *
+frame_reader::next(long *number, long *step){
+    std::unique_lock<std::mutex> guard( lock );
+    frame   a_frame;
+
+    changed.wait( guard, [this]{ return finished || !frames.empty(); });
+    if( frames.empty() ) return (config *)NULL;
+    a_frame = frames.front();
+    frames.pop_front();
+    if( number ) *number = a_frame.number;
+    if( step ) *step = a_frame.step;
+    return a_frame.data;
+}
+
+/**
+ * @param a_config  a configuration given by next(), that must not be used
+ *                  afterwards.
+ */
+void
+frame_reader::release(config *a_config){
+    give_back( a_config );
+}
+
+long
+frame_reader::n_read(){
+    std::unique_lock<std::mutex> guard( lock );
+    return n_frames;
+}
+
+/**
+ * @return  the file that could not be read and the reason, or an empty string
+ *          if all the files were read (or reading has not finished).
+ */
+std::string
+frame_reader::error(){
+    std::unique_lock<std::mutex> guard( lock );
+    return error_text;
+}
+
+void
+frame_reader::reader(){
+    for( size_t k = 0; k < names.size(); k++ ){
+        bool    go_on;
+
+        try {
+            if( !names[k].empty() && trajectory::is_trajectory( names[k] ))
+                go_on = read_binary( names[k] );
+            else
+                go_on = read_text( names[k] );
+        }
+        catch( std::exception &e ){
+            std::unique_lock<std::mutex> guard( lock );
+            error_text = ( names[k].empty() ? std::string("stdin") : names[k] )
+                       + ": " + e.what();
+            go_on = false;
+        }
+        if( !go_on ) break;
+    }
+    {
+        std::unique_lock<std::mutex> guard( lock );
+        finished = true;
+    }
+    changed.notify_all();
+}
+
+/*
+ * Returns false if stopping.
+ */
+bool
+frame_reader::read_binary(const std::string& name){
+    trajectory  a_traj( name );
+    config      *a_config;
+
+    for( long k = 0; k < a_traj.n_frames(); k++ ){
+        if(( a_config = free_buffer() ) == NULL ) return false;
+        try {
+            a_config->read( &a_traj, k );
+        }
+        catch(...){
+            give_back( a_config );
+            throw;
+        }
+        queue( a_config, a_traj.step( k ));
+    }
+    return true;
+}
+
+/*
+ * Each configuration may follow a "====step====" separator. Returns false if
+ * stopping.
+ */
+bool
+frame_reader::read_text(const std::string& name){
+    std::istream    *source;
+    std::string     line;
+    config          *a_config;
+    long            step, count = 0;
+    bool            go_on = true;
+
+    if( name.empty() )
+        source = &std::cin;
+    else if( open )
+        source = open( name );
+    else
+        source = new std::ifstream( name.c_str() );
+    try {
+        if( !source || source->fail() )
+            throw std::runtime_error("Could not open the file\n");
+        while( source->peek() != EOF ){
+            step = count;
+            if( source->peek() == '=' ){            // Separator
+                getline( *source, line );
+                sscanf( line.c_str(), "====%ld", &step );
+            }
+            if(( a_config = free_buffer() ) == NULL ){
+                go_on = false;
+                break;
+            }
+            try {
+                a_config->read( *source );
+            }
+            catch(...){
+                give_back( a_config );
+                if( source->eof() ) break;          // Nothing more in the file
+                throw;
+            }
+            queue( a_config, step );
+            count++;
+        }
+    }
+    catch(...){
+        if( source != &std::cin ) delete source;
+        throw;
+    }
+    if( source != &std::cin ) delete source;
+    return go_on;
+}
+
+config *
+frame_reader::free_buffer(){
+    std::unique_lock<std::mutex> guard( lock );
+    config  *a_config;
+
+    changed.wait( guard, [this]{
+        return stopping || !spare.empty() || ( (int)buffers.size() < n_buffers ); });
+    if( stopping ) return (config *)NULL;
+    if( spare.empty() ){
+        a_config = new config();
+        buffers.push_back( a_config );
+    } else {
+        a_config = spare.back();
+        spare.pop_back();
+    }
+    return a_config;
+}
+
+void
+frame_reader::queue(config *a_config, long step){
+    frame   a_frame;
+
+    a_frame.data   = a_config;
+    a_frame.step   = step;
+    {
+        std::unique_lock<std::mutex> guard( lock );
+        a_frame.number = n_frames++;
+        frames.push_back( a_frame );
+    }
+    changed.notify_all();
+}
+
+void
+frame_reader::give_back(config *a_config){
+    {
+        std::unique_lock<std::mutex> guard( lock );
+        spare.push_back( a_config );
+    }
+    changed.notify_all();
+}
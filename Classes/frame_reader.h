@@ -0,0 +1,91 @@
+/**
+ * @file    frame_reader.h
+ * @author  James Sturgis
+ * @date    October 16, 2026
+ * \brief   Header file for the frame_reader class.
+ *
+ * @class   frame_reader frame_reader.h
+ * @brief   Reads the frames of a series of files on a background thread.
+ *
+ * The files are read in order, each may be a binary trajectory (recognised
+ * whatever its name), a text trajectory of configurations separated by
+ * "====step====" lines or a single configuration. With no file names the
+ * configurations are read from std::cin. Text files are opened with the
+ * opener given to the constructor, so that a program can read compressed
+ * trajectories, or else as plain files.
+ *
+ * The frames are read into a fixed set of n_buffers configurations that are
+ * reused. next() gives the next frame read, waiting for it if necessary, and
+ * the configuration must be given back with release() once it has been
+ * analysed. next() and release() may be called from several threads, so a
+ * pool of workers can analyse frames while the reader thread decompresses and
+ * parses the following ones. Frames are numbered from 0 in the order of the
+ * files, which lets a worker make results that do not depend on which thread
+ * analysed the frame.
+ *
+ * Reading stops at the end of the last file or at the first file that can
+ * not be read, error() then gives the reason. An incomplete configuration at
+ * the end of a text file is taken as the end of the file.
+ */
+
+#ifndef FRAME_READER_H
+#define FRAME_READER_H
+
+#include <deque>
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <istream>
+#include <condition_variable>
+
+class config;
+
+class frame_reader {
+public:
+    typedef std::istream *(*opener)(const std::string& name); ///< Opens a text file, the stream is deleted after use.
+
+    frame_reader(const std::vector<std::string>& a_names,
+                 int a_n_buffers = 2, opener a_open = NULL
+                 );                 ///< Start reading the files.
+    virtual ~frame_reader();        ///< Stop reading and free the buffers.
+
+    config      *next(long *number = NULL, long *step = NULL
+                 );                 ///< The next frame, NULL when there are no more.
+    void        release(config *a_config
+                 );                 ///< Give back a configuration from next().
+    long        n_read();           ///< Number of frames read so far.
+    std::string error();            ///< Why reading stopped early, empty if it did not.
+private:
+    struct frame {
+        config      *data;
+        long        number;         ///< Position in the series of frames.
+        long        step;           ///< Step given in the file.
+    };
+    void        reader();           ///< Main loop of the reader thread.
+    bool        read_binary(const std::string& name
+                 );                 ///< Queue the frames of a binary trajectory.
+    bool        read_text(const std::string& name
+                 );                 ///< Queue the configurations of a text file.
+    config      *free_buffer();     ///< Wait for a buffer, NULL when stopping.
+    void        queue(config *a_config, long step
+                 );                 ///< Hand a frame to next().
+    void        give_back(config *a_config
+                 );                 ///< Return an unused buffer.
+
+    std::vector<std::string>    names;
+    opener                      open;
+    int                         n_buffers;
+    std::vector<config *>       buffers;    ///< All the buffers made.
+    std::vector<config *>       spare;      ///< Buffers ready for reuse.
+    std::deque<frame>           frames;     ///< Frames waiting for next().
+    long                        n_frames;   ///< Frames queued so far.
+    std::thread                 thread;
+    std::mutex                  lock;
+    std::condition_variable     changed;    ///< Signals frames queued or buffers returned.
+    bool                        finished;   ///< The reader thread has stopped.
+    bool                        stopping;
+    std::string                 error_text; ///< First error met by the reader.
+};
+
+#endif /* FRAME_READER_H */
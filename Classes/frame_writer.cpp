@@ -0,0 +1,206 @@
+/**
+ * @file    frame_writer.cpp
+ * @author  James Sturgis
+ * @date    October 16, 2026
+ * @brief   Implementation of the frame_writer class.
+ */
+
+#include "frame_writer.h"
+#include "config.h"
+#include <stdexcept>
+
+/**
+ * @brief Constructor, starts the writer thread.
+ *
+ * @param a_config      the configuration that will be written, it gives the
+ *                      boundary and the objects of all the frames.
+ * @param a_text        stream for a text trajectory, or NULL.
+ * @param a_binary      binary trajectory open for writing, or NULL.
+ * @param a_max_queue   the most frames waiting to be written, at least 1.
+ */
+frame_writer::frame_writer(config *a_config, std::ostream *a_text,
+        trajectory *a_binary, int a_max_queue){
+    frame     = new config( a_config );
+    text_dest = a_text;
+    binary    = a_binary;
+    max_queue = ( a_max_queue > 0 ) ? a_max_queue : 1;
+    n_frames  = 0;
+    n_waits   = 0;
+    n_lost    = 0;
+    busy      = false;
+    stopping  = false;
+    thread    = std::thread( &frame_writer::worker, this );
+}
+
+/**
+ * Destructor, writes all that is queued and stops the thread.
+ */
+frame_writer::~frame_writer(){
+    {
+        std::unique_lock<std::mutex> guard( lock );
+        stopping = true;
+    }
+    changed.notify_all();
+    thread.join();
+    for( size_t k = 0; k < spare.size(); k++ )
+        delete spare[k];
+    delete frame;
+}
+
+/**
+ * @brief Queue a frame, waiting if max_queue frames are already queued.
+ *
+ * @param a_config  the configuration, with the objects given to the
+ *                  constructor.
+ * @param step      the step number of the frame.
+ * @throws          runtime_error if the number of objects has changed or the
+ *                  writer thread has met an error.
+ */
+void
+frame_writer::write_frame(config *a_config, long step){
+    std::vector<double> *data;
+    object  *my_obj;
+    job     a_job;
+
+    if( !text_dest && !binary ) return;
+    if( a_config->n_objects() != frame->n_objects() )
+        throw std::runtime_error("The number of objects in the trajectory can not change\n");
+    {
+        std::unique_lock<std::mutex> guard( lock );
+        if( n_frames >= max_queue ){
+            n_waits++;
+            changed.wait( guard, [this]{ return n_frames < max_queue; });
+        }
+        if( !error.empty() )
+            throw std::runtime_error( error );
+        n_frames++;
+        if( spare.empty() ){
+            data = new std::vector<double>;
+        } else {
+            data = spare.back();
+            spare.pop_back();
+        }
+    }
+    data->resize( 3 * a_config->n_objects() );  // The only copy made here
+    for( int i = 0; i < a_config->n_objects(); i++ ){
+        my_obj = a_config->get_object( i );
+        (*data)[3*i]   = my_obj->pos_x;
+        (*data)[3*i+1] = my_obj->pos_y;
+        (*data)[3*i+2] = my_obj->orientation;
+    }
+    a_job.step = step;
+    a_job.data = data;
+    a_job.dest = NULL;
+    {
+        std::unique_lock<std::mutex> guard( lock );
+        jobs.push_back( a_job );
+    }
+    changed.notify_all();
+}
+
+/**
+ * Queue text to be written to a stream by the writer thread, the stream must
+ * not be used otherwise until flush().
+ *
+ * @param dest  the stream.
+ * @param text  the text.
+ */
+void
+frame_writer::write_log(std::ostream *dest, const std::string& text){
+    job     a_job;
+
+    a_job.step = 0;
+    a_job.data = NULL;
+    a_job.dest = dest;
+    a_job.text = text;
+    {
+        std::unique_lock<std::mutex> guard( lock );
+        jobs.push_back( a_job );
+    }
+    changed.notify_all();
+}
+
+/**
+ * Wait until all the queued jobs are written, and are in the files.
+ *
+ * @throws  runtime_error if the writer thread has met an error.
+ */
+void
+frame_writer::flush(){
+    std::unique_lock<std::mutex> guard( lock );
+
+    changed.wait( guard, [this]{ return jobs.empty() && !busy; });
+    if( text_dest ) text_dest->flush();
+    if( binary && error.empty() ){
+        try {
+            binary->flush();
+        }
+        catch( std::exception &e ){
+            error = e.what();
+        }
+    }
+    if( !error.empty() )
+        throw std::runtime_error( error );
+}
+
+void
+frame_writer::worker(){
+    job     a_job;
+    bool    written;
+
+    for(;;){
+        {
+            std::unique_lock<std::mutex> guard( lock );
+            changed.wait( guard, [this]{ return stopping || !jobs.empty(); });
+            if( jobs.empty() ) return;      // Stopping with nothing left
+            a_job = jobs.front();
+            jobs.pop_front();
+            busy = true;
+            written = !a_job.data || error.empty();  // No frames after a gap
+        }
+        try {
+            if( written ) write_job( a_job );
+        }
+        catch( std::exception &e ){
+            std::unique_lock<std::mutex> guard( lock );
+            if( error.empty() ) error = e.what();
+            written = false;
+        }
+        {
+            std::unique_lock<std::mutex> guard( lock );
+            if( a_job.data ){
+                spare.push_back( a_job.data );
+                n_frames--;
+                if( !written ) n_lost++;
+            }
+            busy = false;
+        }
+        changed.notify_all();
+    }
+}
+
+/**
+ * Format and write one frame, or some text.
+ */
+void
+frame_writer::write_job(job& a_job){
+    object  *my_obj;
+
+    if( !a_job.data ){
+        *a_job.dest << a_job.text;
+        a_job.dest->flush();                // Logs are read as they grow
+        return;
+    }
+    for( int i = 0; i < frame->n_objects(); i++ ){
+        my_obj = frame->get_object( i );
+        my_obj->pos_x       = (*a_job.data)[3*i];
+        my_obj->pos_y       = (*a_job.data)[3*i+1];
+        my_obj->orientation = (*a_job.data)[3*i+2];
+    }
+    if( binary ){
+        binary->write_frame( frame, a_job.step );
+    } else {
+        *text_dest << "====" << a_job.step << "====\n";
+        frame->write( *text_dest );
+    }
+}
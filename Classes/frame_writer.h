@@ -0,0 +1,83 @@
+/**
+ * @file    frame_writer.h
+ * @author  James Sturgis
+ * @date    October 16, 2026
+ * \brief   Header file for the frame_writer class.
+ *
+ * @class   frame_writer frame_writer.h
+ * @brief   Writes trajectory frames and log text on a background thread.
+ *
+ * write_frame() only copies the types, positions and orientations of the
+ * objects into a free buffer and queues it, the formatting, compression and
+ * writing are done by the writer thread, so the simulation can go on at
+ * once. The frames go either to a text stream, as config::write() with
+ * "====step====" separators, or to a binary trajectory. write_log() queues
+ * text for another stream, such as the log, which is then only written by
+ * the writer thread until flush().
+ *
+ * At most max_queue frames are waiting at any time, with 2 the simulation
+ * fills one buffer while the other is written. If the queue is full
+ * write_frame() waits, these waits are counted in n_waits. The objects must
+ * not change in number or type between frames. The destructor writes
+ * everything still queued.
+ *
+ * After an error the frames still queued are not written but counted in
+ * n_lost, so the file holds the frames queued before the error and no others,
+ * and the error is thrown by the next write_frame() or flush().
+ */
+
+#ifndef FRAME_WRITER_H
+#define FRAME_WRITER_H
+
+#include <deque>
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <ostream>
+#include <condition_variable>
+
+class config;
+class trajectory;
+
+class frame_writer {
+public:
+    frame_writer(config *a_config, std::ostream *a_text,
+                 trajectory *a_binary, int a_max_queue = 2
+                 );                 ///< Start the writer thread.
+    virtual ~frame_writer();        ///< Write what is queued and stop.
+
+    void    write_frame(config *a_config, long step
+                 );                 ///< Queue a snapshot of the configuration.
+    void    write_log(std::ostream *dest, const std::string& text
+                 );                 ///< Queue text for a stream.
+    void    flush();                ///< Wait until everything queued is written.
+
+    int     n_waits;                ///< Times write_frame() waited for a buffer.
+    long    n_lost;                 ///< Frames queued but not written after an error.
+private:
+    struct job {
+        long                step;   ///< Step of a frame.
+        std::vector<double> *data;  ///< x, y, orientation of a frame (NULL for text).
+        std::ostream        *dest;  ///< Stream for text.
+        std::string         text;   ///< The text.
+    };
+    void    worker();               ///< Main loop of the writer thread.
+    void    write_job(job& a_job);  ///< Write one job.
+
+    config                      *frame;     ///< Copy of the configuration used to format frames.
+    std::ostream                *text_dest; ///< Text trajectory (or NULL).
+    trajectory                  *binary;    ///< Binary trajectory (or NULL).
+    int                         max_queue;
+    int                         n_frames;   ///< Frames queued or being written.
+    std::deque<job>             jobs;
+    std::vector<std::vector<double> *> spare; ///< Buffers ready for reuse.
+    std::thread                 thread;
+    std::mutex                  lock;
+    std::condition_variable     changed;    ///< Signals jobs queued or done.
+    bool                        busy;       ///< The thread is writing a job.
+    bool                        stopping;
+    std::string                 error;      ///< First error met by the thread.
+};
+
+#endif /* FRAME_WRITER_H */
@@ -11,6 +11,7 @@
 #include <math.h>
 #include "integrator.h"
 #include "common.h"
+#include "profile.h"
 #include <fstream>
 #include <iostream>
 #include <sstream>
@@ -25,9 +26,13 @@ integrator::integrator(force_field *forces) {
     n_good     =
     n_bad      =
     n_step     = 0;
+    n_events   = 0;
+    n_good_total = 0;
+    n_bad_total  = 0;
     dl_max     = 1.0;
     i_adjust   = 1000;
     the_forces = forces;
+    stop_flag  = NULL;
 }
 
 /**
@@ -41,8 +46,12 @@ integrator::integrator(const integrator& orig) {
     n_bad      = orig.n_bad;
     dl_max     = orig.dl_max;
     n_step     = orig.n_step;
+    n_events   = orig.n_events;
+    n_good_total = orig.n_good_total;
+    n_bad_total  = orig.n_bad_total;
     i_adjust   = orig.i_adjust;
     the_forces = orig.the_forces;
+    stop_flag  = orig.stop_flag;
 }
 
 /**
@@ -56,12 +65,20 @@ integrator::~integrator() {
  *
  * Currently this integration is performed by at each time point:
  * - If necessary adjusting the integrator parameters and resetting the tallies.
- * - Moving an object in the configuration.
- * - Working out which parts of the energy need to be re-evaluated.
- * - Calculating a new energy for the configuration.
- * - Accepting or rejecting the configuration based on the metropolis criterion.
+ * - Moving an object in the configuration with a trial move, that also gives
+ *   the energy change from the neighbours of the object.
+ * - Accepting or rejecting the move based on the metropolis criterion, by
+ *   committing or undoing the trial move.
  * - Updating the integrator tallies.
  *
+ * The configuration is modified in place so a step neither copies the
+ * configuration nor allocates memory.
+ *
+ * If the force field only has hard cores and the configuration no overlaps,
+ * the energy is always zero or huge, so a move is accepted exactly when it
+ * creates no overlap. config::hard_move() is then used which stops at the
+ * first overlap found and calculates no energies.
+ *
  * @param state_h a handle to the configuration. This will be updated during
  *                the run, so the_state at the end is different if a change is
  *                made.
@@ -69,55 +86,253 @@ integrator::~integrator() {
  *                to use for the integration.
  * \param P       The pressure.
  * @param n_steps The number of requested steps to make.
- * @return        The total number of steps so far performed.
+ * @return        The number of steps made, fewer than n_steps if the stop
+ *                flag was set.
  *
  */
 int
 integrator::run(config **state_h, double beta, double P, int n_steps){
+    return make_steps( *state_h, beta, n_steps, true );
+}
+
+/**
+ * @brief The steps of run(), also used by sweep() and chains() when they can
+ * not be used.
+ *
+ * @param the_state the configuration.
+ * @param beta      The reciprocal temperature.
+ * @param n_steps   The number of requested steps to make.
+ * @param report    Call the progress hook and stop on the flag, false when
+ *                  the steps stand for a sweep or chain, which is then made
+ *                  whole so that a stopped run can be continued exactly.
+ * @return          The number of steps made.
+ */
+int
+integrator::make_steps(config *the_state, double beta, int n_steps, bool report){
     int     i;              ///< Iteration counter
     int     obj_number;     ///< Index of object to modify
     double  dU;             ///< Internal energy change.
     double  prob_new;       ///< Acceptance probability.
-    config  *the_state = *state_h;
-    config  *new_state;     ///< Pointer to modified state.
+    bool    hard;           ///< Only hard cores and no overlaps.
+
+    hard = ( beta > 0.0 ) && the_forces->is_hard() &&
+           ( the_state->energy( the_forces ) == 0.0 );
 
-    for(i = 0; i < n_steps; i++){
+    for(i = 0; ( i < n_steps ) && !( report && stopping()); i++){
+        if( report && progress && ( i > 0 ) && ( i % PROGRESS_STEPS == 0 ))
+            progress( i );
+        PROFILE_COUNT( COUNT_STEPS, 1 );
         /* If necessary adjust integrator parameters and tallies */
         if((n_step > 0) && ((n_step % i_adjust)== 0)){
-            if(((float)n_good/(n_good+n_bad)) < 0.3) dl_max /= 3.9;
-            if(((float)n_good/(n_good+n_bad)) > 0.7) dl_max *= 3.0;
-            dl_max = simple_min( dl_max, the_state->x_size);
-            dl_max = simple_min( dl_max, the_state->y_size);
-            n_good = n_bad = 0;
+            PROFILE_PHASE( PHASE_BOOKKEEPING );
+            adjust( the_state );
         }
 
-        /** Clone configuration and move an object in the new configuration */
+        /** Move an object and find the energy change                      */
         /** @todo   Chose between different types of modification           */
-        new_state = new config(*the_state);
-
-        /// The integrator move function.
-        obj_number = rnd_lin(1.0)*the_state->n_objects();
-        new_state->move(obj_number, dl_max);
-        new_state->invalidate_within(the_forces->cut_off, obj_number);
-        new_state->unchanged = false;
+        {
+            PROFILE_PHASE( PHASE_PROPOSAL );
+            obj_number = rnd_lin(1.0)*the_state->n_objects();
+            if( obj_number >= the_state->n_objects()) obj_number--;
+        }
+        if( hard ){                         // Accepted if no overlap
+            if( the_state->hard_move(obj_number, dl_max, the_forces))
+                n_good++;
+            else
+                n_bad++;
+            n_step++;
+            continue;
+        }
+        dU = the_state->trial_move(obj_number, dl_max, the_forces);
 
         /* Calculate probability of accepting the new state                */
-        dU = new_state->energy(the_forces)
-                - the_state->energy(the_forces);
-        prob_new = exp(- beta * dU );
-        prob_new = simple_min(1.0,prob_new);
+        bool    accept;
+        {
+            PROFILE_PHASE( PHASE_ACCEPT );
+            prob_new = exp(- beta * dU );
+            prob_new = simple_min(1.0,prob_new);
+            accept = rnd_lin(1.0)<= prob_new;
+        }
 
         /* Accept or reject the new state according to the probability     */
-        if(rnd_lin(1.0)<= prob_new ){
+        PROFILE_PHASE( PHASE_BOOKKEEPING );
+        if( accept ){
             n_good++;
-            delete(the_state);               
-            the_state = new_state;
+            the_state->commit_move();
         } else {
             n_bad++;
-            delete(new_state);                
+            the_state->reject_move();
         }
         n_step++;
     }
+    return i;
+}
+
+/**
+ * @brief Function to run a series of parallel sweeps on a configuration.
+ *
+ * Each sweep is done by config::checkerboard_sweep(), which tries to move
+ * every object once using the Metropolis criterion with the threads of the
+ * configuration. If the configuration cannot be divided into domains the
+ * sweep is made of n_objects() steps of run() instead. The integrator
+ * parameters are adjusted between sweeps once i_adjust moves have been
+ * tried.
+ *
+ * @param state_h  a handle to the configuration.
+ * @param beta     The reciprocal temperature.
+ * @param P        The pressure.
+ * @param n_sweeps The number of requested sweeps.
+ * @return         The number of sweeps made, fewer than n_sweeps if the stop
+ *                 flag was set.
+ */
+int
+integrator::sweep(config **state_h, double beta, double P, int n_sweeps){
+    int     n_tried;        ///< Moves tried in a sweep
+    int     n_accepted;     ///< Moves accepted in a sweep
+    config  *the_state = *state_h;
+    int     i;
+
+    for(i = 0; ( i < n_sweeps ) && !stopping(); i++){
+        if((n_good + n_bad) >= i_adjust)
+            adjust( the_state );
+        n_accepted = the_state->checkerboard_sweep(dl_max, beta, the_forces, &n_tried);
+        if( n_accepted < 0 ){               // Can not divide the configuration
+            if( make_steps( the_state, beta, the_state->n_objects(), false ) < the_state->n_objects())
+                break;                      // Not a whole sweep
+        } else {
+            n_good += n_accepted;
+            n_bad  += n_tried - n_accepted;
+            n_step += n_tried;
+        }
+        if( progress ) progress( i + 1 );
+    }
+    *state_h = the_state;
+    return i;
+}
+
+/**
+ * @brief Function to run a series of event chains on a configuration.
+ *
+ * Each chain starts with a random object and goes along +x or +y, chosen at
+ * random, see config::event_chain(). The collisions are counted in n_events.
+ * This is only possible for hard discs in periodic conditions without
+ * overlaps, otherwise each chain is replaced by n_objects() steps of run(),
+ * which also removes the overlaps.
+ *
+ * @param state_h  a handle to the configuration.
+ * @param beta     The reciprocal temperature (only used by run()).
+ * @param P        The pressure.
+ * @param n_chains The number of requested chains.
+ * @param length   The distance moved in each chain.
+ * @return         The number of chains made, fewer than n_chains if the stop
+ *                 flag was set.
+ */
+int
+integrator::chains(config **state_h, double beta, double P, int n_chains,
+        double length){
+    int     obj_number;     ///< Object starting the chain
+    config  *the_state = *state_h;
+    int     i;
+
+    for(i = 0; ( i < n_chains ) && !stopping(); i++){
+        if( !the_state->can_chain( the_forces )){
+            if( make_steps( the_state, beta, the_state->n_objects(), false ) < the_state->n_objects())
+                break;                      // Not a whole chain
+        } else {
+            obj_number = rnd_lin(1.0)*the_state->n_objects();
+            if( obj_number >= the_state->n_objects()) obj_number--;
+            n_events += the_state->event_chain(obj_number, rnd_current()->below(2), length, the_forces);
+            n_step++;
+        }
+        if( progress ) progress( i + 1 );
+    }
     *state_h = the_state;
+    return i;
+}
+
+/**
+ * @return The number of steps made, which sets when dl_max is next adjusted.
+ */
+int
+integrator::steps(){
     return n_step;
 }
+
+/**
+ * Set the number of steps made, with the tallies and dl_max this lets a new
+ * integrator continue a run exactly, as after a checkpoint.
+ *
+ * @param a_n_step  the number of steps made by the run.
+ */
+void
+integrator::set_steps(int a_n_step){
+    n_step = a_n_step;
+}
+
+/**
+ * Stop run(), sweep() and chains() after the step, sweep or chain under way
+ * whenever *flag is set, so that a signal handler can interrupt a long block
+ * of steps.
+ *
+ * @param flag  the flag, NULL never to stop.
+ */
+void
+integrator::stop_on(volatile sig_atomic_t *flag){
+    stop_flag = flag;
+}
+
+/**
+ * Call hook from inside run(), sweep() and chains(), every PROGRESS_STEPS
+ * steps or after each sweep or chain, with the number of steps, sweeps or
+ * chains made so far by the call. The hook must not change the configuration
+ * or the integrator.
+ *
+ * @param hook  the progress hook, an empty function for none.
+ */
+void
+integrator::on_progress(const std::function<void(int)>& hook){
+    progress = hook;
+}
+
+/**
+ * @return true if the stop flag is set.
+ */
+bool
+integrator::stopping(){
+    return stop_flag && *stop_flag;
+}
+
+/**
+ * @return The number of moves accepted since the start of the run, unlike
+ *         n_good this is never reset.
+ */
+long
+integrator::accepted(){
+    return n_good_total + n_good;
+}
+
+/**
+ * @return The number of moves tried since the start of the run.
+ */
+long
+integrator::tried(){
+    return n_good_total + n_bad_total + n_good + n_bad;
+}
+
+/**
+ * Adjust the maximum move distance to keep the acceptance rate between 30 and
+ * 70%, without exceeding the size of the configuration, and reset the
+ * tallies after adding them to the totals.
+ *
+ * @param the_state the configuration being integrated.
+ */
+void
+integrator::adjust(config *the_state){
+    if(((float)n_good/(n_good+n_bad)) < 0.3) dl_max /= 3.9;
+    if(((float)n_good/(n_good+n_bad)) > 0.7) dl_max *= 3.0;
+    dl_max = simple_min( dl_max, the_state->x_size);
+    dl_max = simple_min( dl_max, the_state->y_size);
+    n_good_total += n_good;
+    n_bad_total  += n_bad;
+    n_good = n_bad = 0;
+}
@@ -16,6 +16,28 @@
  * Currently the nature of the steps is hard coded as are the various integration
  * counters and control parameters.
  *
+ * Large configurations can instead be integrated by sweeps, in which every
+ * object is tried once on average and the box is cut into a checkerboard of
+ * domains that are moved in parallel by the threads of the configuration.
+ * A sweep of a configuration that cannot be divided, such as one with a
+ * polygon boundary, is made of n_objects() ordinary steps.
+ *
+ * Hard discs in periodic boxes can also be integrated by event chains, which
+ * move many discs a long way without rejections.
+ *
+ * n_good and n_bad only count the moves since dl_max was last adjusted, they
+ * are then added to n_good_total and n_bad_total. accepted() and tried() give
+ * the moves since the start of the run.
+ *
+ * A run can be stopped from outside, by a signal handler for example, through
+ * the flag given to stop_on(). run(), sweep() and chains() then return after
+ * the step, sweep or chain under way, with the number made.
+ *
+ * A progress hook, set with on_progress(), is called from inside the runs
+ * every PROGRESS_STEPS steps, and after each sweep or chain, with the number
+ * made so far by the call, so that a programme can report on long blocks of
+ * steps without changing where they start and end.
+ *
  * @todo    The integrator should incorporate more of the choices about
  *          integration to allow different types of dynamics. So there should
  *          be choices about the configuration manipulations possible and their
@@ -26,6 +48,10 @@
 #define INTEGRATOR_H
 
 #include "config.h"
+#include <csignal>
+#include <functional>
+
+#define PROGRESS_STEPS  1000                ///< Steps between calls of the progress hook
 
 class integrator {
 public:
@@ -33,13 +59,34 @@ public:
     integrator(const integrator& orig);     ///< Constructor with copy
     virtual ~integrator();                  ///< Destructor
     int     run(config **state_handle, double beta,
-                double P, int n_step);      ///< Run n_step integration steps
+                double P, int n_step);      ///< Run up to n_step integration steps
+    int     sweep(config **state_handle, double beta,
+                double P, int n_sweeps);    ///< Run up to n_sweeps parallel sweeps
+    int     chains(config **state_handle, double beta,
+                double P, int n_chains,
+                double length);             ///< Run up to n_chains event chains of hard discs
+    int     steps();                        ///< Number of integrator steps made so far.
+    void    set_steps(int a_n_step);        ///< Continue a run that had made a_n_step steps.
+    void    stop_on(volatile sig_atomic_t *flag); ///< Stop the runs when *flag is set.
+    void    on_progress(const std::function<void(int)>& hook
+                );                          ///< Call hook with the steps made during the runs.
+    long    accepted();                     ///< Moves accepted since the start of the run.
+    long    tried();                        ///< Moves tried since the start of the run.
     int     n_good;                         ///< Integrator tally, number of accepted moves.
     int     n_bad;                          ///< Integrator tally, number of rejected moves.
+    long    n_good_total;                   ///< Accepted moves before the last adjustment.
+    long    n_bad_total;                    ///< Rejected moves before the last adjustment.
     int     i_adjust;                       ///< Frequency of integrator adjustment.
     double  dl_max;                         ///< Maximum move distance.
+    long    n_events;                       ///< Integrator tally, number of event chain collisions.
 private:
+    void    adjust(config *the_state);      ///< Adjust dl_max to the acceptance rate.
     int     n_step;                         ///< Number of integrator steps made so far.
+    volatile sig_atomic_t *stop_flag;       ///< Stop the runs when set, or NULL.
+    bool    stopping();                     ///< Is the stop flag set.
+    std::function<void(int)> progress;      ///< The progress hook, or empty.
+    int     make_steps(config *the_state, double beta,
+                int n_steps, bool report);  ///< The steps of run().
     force_field *the_forces;
 };
 
@@ -0,0 +1,128 @@
+/**
+ * @file    metrics.cpp
+ * @author  James Sturgis
+ * @date    October 16, 2026
+ * @brief   Implementation of the metrics class.
+ */
+
+#include "metrics.h"
+#include <cstdio>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @param a_name    the file to write.
+ * @param a_run     the value of the run label of every value, to tell apart
+ *                  the runs on a machine.
+ */
+metrics::metrics(std::string a_name, std::string a_run){
+    file_name = a_name;
+    run       = a_run;
+}
+
+/**
+ * Destructor.
+ */
+metrics::~metrics(){
+}
+
+/**
+ * @param name  the name of the value, letters, digits and underscores.
+ * @param help  what it is.
+ * @param value the value.
+ */
+void
+metrics::gauge(std::string name, std::string help, double value){
+    set( name, help, "gauge", value );
+}
+
+/**
+ * @param name  the name of the value, by convention ending with _total.
+ * @param help  what it is.
+ * @param value the value.
+ */
+void
+metrics::counter(std::string name, std::string help, double value){
+    set( name, help, "counter", value );
+}
+
+void
+metrics::set(std::string name, std::string help, std::string type, double value){
+    for( size_t k = 0; k < names.size(); k++ )
+        if( names[k] == name ){
+            helps[k]  = help;
+            types[k]  = type;
+            values[k] = value;
+            return;
+        }
+    names.push_back( name );
+    helps.push_back( help );
+    types.push_back( type );
+    values.push_back( value );
+}
+
+/**
+ * @brief Write the values.
+ *
+ * The file is written as file_name.tmp and then renamed.
+ *
+ * @throws  runtime_error if the file could not be written.
+ */
+void
+metrics::write(){
+    std::string tmp_name = file_name + ".tmp";
+    std::string label;
+    FILE        *dest;
+    bool        failed;
+
+    for( size_t k = 0; k < run.length(); k++ ){    // Escape the label value
+        if(( run[k] == '\\' ) || ( run[k] == '"' )) label += '\\';
+        if( run[k] == '\n' ) label += "\\n";
+        else label += run[k];
+    }
+    if(( dest = fopen( tmp_name.c_str(), "w" )) == NULL )
+        throw std::runtime_error("Could not create metrics file " + tmp_name + "\n");
+    for( size_t k = 0; k < names.size(); k++ ){
+        fprintf( dest, "# HELP %s %s\n", names[k].c_str(), helps[k].c_str() );
+        fprintf( dest, "# TYPE %s %s\n", names[k].c_str(), types[k].c_str() );
+        fprintf( dest, "%s{run=\"%s\"} %.15g\n", names[k].c_str(), label.c_str(), values[k] );
+    }
+    failed = ( fflush( dest ) != 0 ) || ferror( dest );
+    if(( fclose( dest ) != 0 ) || failed ||
+       ( rename( tmp_name.c_str(), file_name.c_str() ) != 0 )){
+        remove( tmp_name.c_str() );
+        throw std::runtime_error("Could not write metrics file " + file_name + "\n");
+    }
+}
+
+/**
+ * @return  the resident set size of the programme in bytes, from
+ *          /proc/self/statm, or 0 if it can not be read.
+ */
+double
+metrics::resident_bytes(){
+    FILE    *source;
+    long    size, resident;
+    int     n_read;
+
+    if(( source = fopen( "/proc/self/statm", "r" )) == NULL )
+        return 0.0;
+    n_read = fscanf( source, "%ld %ld", &size, &resident );
+    fclose( source );
+    if( n_read != 2 ) return 0.0;
+    return (double)resident * sysconf( _SC_PAGESIZE );
+}
+
+/**
+ * @param name  a file name.
+ * @return      the size of the file in bytes, 0 if there is no such file.
+ */
+double
+metrics::file_bytes(std::string name){
+    struct stat info;
+
+    if( name.empty() || ( stat( name.c_str(), &info ) != 0 ))
+        return 0.0;
+    return (double)info.st_size;
+}
@@ -0,0 +1,60 @@
+/**
+ * @file    metrics.h
+ * @author  James Sturgis
+ * @date    October 16, 2026
+ * \brief   Header file for the metrics class.
+ *
+ * @class   metrics metrics.h
+ * @brief   A file of values describing a run as it goes, for monitoring
+ *          programs to read.
+ *
+ * The values are written in the Prometheus text format, as read by the
+ * textfile collector of the node exporter, one block per value:
+ *
+ *      # HELP hard_discs_steps_total Steps made.
+ *      # TYPE hard_discs_steps_total counter
+ *      hard_discs_steps_total{run="name"} 12000
+ *
+ * The values are given with gauge() and counter(), which replace any
+ * earlier value of the same name, and write() writes them all to the file.
+ * The file is written under a temporary name and then renamed, so a reader
+ * always sees a complete file. The textfile collector only reads files
+ * whose name ends with .prom.
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <string>
+#include <vector>
+
+class metrics {
+public:
+    metrics(std::string a_name, std::string a_run
+                     );             ///< Values for a file, labelled with the run.
+    virtual ~metrics();
+
+    void        gauge(std::string name, std::string help, double value
+                     );             ///< Set a value that goes up and down.
+    void        counter(std::string name, std::string help, double value
+                     );             ///< Set a value that only goes up.
+    void        write();            ///< Write all the values, replacing the file only when complete.
+
+    static double resident_bytes(); ///< Memory used by the programme.
+    static double file_bytes(std::string name
+                     );             ///< Size of a file, 0 if there is none.
+
+    std::string file_name;          ///< The file written.
+    std::string run;                ///< Value of the run label.
+
+private:
+    void        set(std::string name, std::string help, std::string type,
+                    double value);
+
+    std::vector<std::string> names; ///< Names of the values, in order.
+    std::vector<std::string> helps; ///< Their descriptions.
+    std::vector<std::string> types; ///< Their types, gauge or counter.
+    std::vector<double> values;     ///< The values.
+};
+
+#endif /* METRICS_H */
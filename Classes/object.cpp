@@ -9,6 +9,8 @@
 #include <math.h>
 #include <float.h>
 #include "common.h"
+#include "pair_kernel.h"
+#include "profile.h"
 #include <boost/format.hpp>
 #include <fstream>
 #include <sstream>
@@ -26,6 +28,8 @@ object::object() {
     orientation  = 0.0;
     recalculate  = true;
     saved_energy = 0.0;
+    size_atoms( 0 );
+    forget_atoms();
 }
 
 /**
@@ -42,6 +46,8 @@ object::object(int  type, double x_pos, double y_pos, double angle ) {
     orientation  = angle;
     recalculate  = true;
     saved_energy = 0.0;
+    size_atoms( 0 );
+    forget_atoms();
 }
 
 /**
@@ -49,6 +55,7 @@ object::object(int  type, double x_pos, double y_pos, double angle ) {
  * @param orig  The original object.
  */
 object::object(const object& orig) {
+    size_atoms( 0 );
     assign(orig);
 }
 
@@ -70,6 +77,37 @@ object::assign(const object& orig) {
     orientation  = orig.orientation;
     recalculate  = true;            // Can't guarantee same context.
     saved_energy = 0.0;             // This does not mater.
+    forget_atoms();                 // Nor for the atom cache.
+}
+
+/**
+ * @brief   Copy an object with its energy and atom cache, as in a vector of
+ *          objects. The atom cache is copied into the storage of this object.
+ * @param orig  The original object.
+ * @return      This object.
+ */
+object&
+object::operator=(const object& orig) {
+    if( this == &orig ) return *this;
+    o_type         = orig.o_type;
+    pos_x          = orig.pos_x;
+    pos_y          = orig.pos_y;
+    orientation    = orig.orientation;
+    recalculate    = orig.recalculate;
+    saved_energy   = orig.saved_energy;
+    n_atoms        = orig.n_atoms;
+    cache_topology = orig.cache_topology;
+    cache_x        = orig.cache_x;
+    cache_y        = orig.cache_y;
+    cache_angle    = orig.cache_angle;
+    size_atoms( n_atoms );
+    for(int i = 0; i < n_atoms; i++){
+        atom_x[i] = orig.atom_x[i];
+        atom_y[i] = orig.atom_y[i];
+        atom_r[i] = orig.atom_r[i];
+        atom_t[i] = orig.atom_t[i];
+    }
+    return *this;
 }
 
 /**
@@ -120,27 +158,15 @@ void    object::rotate(double angle){
  *
  */
 double  object::distance(object* obj2, double x_size, double y_size, bool periodic){
-    double dx, dy, dx2, dy2;
-
-    dx = pos_x - obj2->pos_x;
-    dx *= dx;
-    dy = pos_y - obj2->pos_y;
-    dy *= dy;
-    if(periodic){
-        dx2 = pos_x + x_size;
-        dx2 *= dx2;
-        dx  = simple_min(dx, dx2);
-        dx2 = pos_x - x_size;
-        dx2 *= dx2;
-        dx  = simple_min(dx, dx2);
-        dy2 = pos_y + y_size;
-        dy2 *= dy2;
-        dy  = simple_min(dy, dy2 );
-        dy2 = pos_y - y_size;
-        dy2 *= dy2;
-        dy  = simple_min(dy, dy2 );
+    double dx, dy;
+
+    dx = obj2->pos_x - pos_x;
+    dy = obj2->pos_y - pos_y;
+    if(periodic){                           // Use the closest image of obj2
+        dx -= x_size * floor( dx / x_size + 0.5 );
+        dy -= y_size * floor( dy / y_size + 0.5 );
     }
-    return sqrt(dx+dy);
+    return sqrt(dx*dx+dy*dy);
 }
 
 /**
@@ -182,56 +208,125 @@ double  object::get_energy(){
     return saved_energy;
 }
 
+/**
+ * @brief   Fill the atom cache if it is out of date.
+ * @param the_topology  Topology information for the objects.
+ *
+ * The cache is valid if it was filled with the same topology, position and
+ * orientation as the object has now, otherwise for each atom its position is
+ * recalculated from the position and orientation of the object.
+ */
+void    object::update_atoms(topology *the_topology){
+    atom    *at;
+    double  c, s;
+
+    if(( cache_topology == the_topology ) && ( cache_x == pos_x ) &&
+            ( cache_y == pos_y ) && ( cache_angle == orientation )){
+        PROFILE_COUNT( COUNT_CACHE_HITS, 1 );
+        return;
+    }
+    PROFILE_COUNT( COUNT_CACHE_MISSES, 1 );
+
+    n_atoms = the_topology->molecules(o_type).n_atoms;
+    size_atoms( n_atoms );
+    c = cos(orientation);
+    s = sin(orientation);
+    for(int i = 0; i < n_atoms; i++){
+        at = &(the_topology->molecules(o_type).the_atoms(i));
+        atom_x[i] = pos_x + c * at->x_pos - s * at->y_pos;
+        atom_y[i] = pos_y + s * at->x_pos + c * at->y_pos;
+        atom_t[i] = at->type;
+        atom_r[i] = the_topology->atom_sizes(at->type);
+    }
+    cache_topology = the_topology;
+    cache_x        = pos_x;
+    cache_y        = pos_y;
+    cache_angle    = orientation;
+}
+
+/**
+ * @brief   Make room in the atom cache for n atoms, keeping the room that
+ *          there already is.
+ * @param n     the number of atoms.
+ */
+void    object::size_atoms(int n){
+    int     room;
+
+    if(( n > 0 ) && ( n <= (int)cache_types.size() ))
+        return;
+    room = simple_max( n, (int)cache_types.size() );
+    cache_coords.resize( 3 * room );
+    cache_types.resize( room );
+    atom_x = room ? &cache_coords[0] : (double *)NULL;
+    atom_y = room ? atom_x + room : (double *)NULL;
+    atom_r = room ? atom_y + room : (double *)NULL;
+    atom_t = room ? &cache_types[0] : (int *)NULL;
+}
+
+/**
+ * @brief   Empty the atom cache, for example when the topology changes.
+ */
+void    object::forget_atoms(){
+    n_atoms        = 0;
+    cache_topology = (topology *)NULL;
+}
+
 /**
  * @brief   Calculate the interaction energy with another object.
  * @param the_force       The force field to use for calculating the energy.
  * @param the_topologies  Topology information for the objects.
  * @param obj2            The second object with which this one is interacting.
+ * @param shift_x         Displacement to apply to obj2 (for periodic images).
+ * @param shift_y         Displacement to apply to obj2 (for periodic images).
  * @return                The calculated energy.
  *
- * For each atom in the first object calculate its position. Then for each atom
- * in the second object calculate its position. From the positions calculate
- * the interaction distance. Then use the force field to calculate the energy
- * given the distance.
+ * For each atom in the first object take its position from the cache. Then
+ * for each atom in the second object take its position. From the positions
+ * calculate the squared interaction distances. Then use the force field to
+ * calculate the energies given the squared distances. This is done by the
+ * kernel the topology chose for the two molecule types, see object_kernel.h.
  */
 double  object::interaction(force_field* the_force,
                 topology *the_topologies,
-                object* obj2){
-    int     i,j;
-    int     n1;
-    double  energy = 0.0;
-    atom    *at1, *at2;
-    double  x1, x2, dx, y1, y2, dy;
-    double  distance;
-    int     n2, t2;
-    double  oo2, ox2, oy2;
-    double  ax2, ay2;
-
-    n1 = the_topologies->molecules(o_type).n_atoms;
-    n2 = the_topologies->molecules(obj2->o_type).n_atoms;
-    
-    t2  = obj2->o_type;
-    oo2 = obj2->orientation;
-    ox2 = obj2->pos_x;
-    oy2 = obj2->pos_y;
-
-    for(i = 0; i < n1; i++){
-        at1 = &(the_topologies->molecules(o_type).the_atoms(i));
-        x1 = pos_x - sin(orientation)*at1->y_pos + cos(orientation)*at1->x_pos;
-        y1 = pos_y + cos(orientation)*at1->y_pos + sin(orientation)*at1->x_pos;
-        for(j = 0; j < n2; j++){ // This segment is the slowest...
-            at2 = &(the_topologies->molecules(t2).the_atoms(j));
-            ax2 = at2->x_pos;
-            ay2 = at2->y_pos;
-            x2 = ox2 - sin(oo2) * ay2 + cos(oo2)*ax2;
-            y2 = oy2 + cos(oo2) * ay2 + sin(oo2)*ax2;
-            dx = x2 - x1;
-            dy = y2 - y1;
-            distance = sqrt(dx*dx+dy*dy);
-            energy += the_force->interaction(at1->type, at2->type, distance );
-        }
-    }
-    return energy;
+                object* obj2,
+                double shift_x, double shift_y){
+    update_atoms( the_topologies );
+    obj2->update_atoms( the_topologies );
+    PROFILE_COUNT( COUNT_ATOM_PAIRS, n_atoms * obj2->n_atoms );
+
+    return the_topologies->interaction_kernel( o_type, obj2->o_type )(
+                the_force, this, obj2, shift_x, shift_y );
+}
+
+/**
+ * @brief   Test if the hard cores of the atoms overlap those of another object.
+ * @param the_force       The force field giving the hard cores.
+ * @param the_topologies  Topology information for the objects.
+ * @param obj2            The second object.
+ * @param shift_x         Displacement to apply to obj2 (for periodic images).
+ * @param shift_y         Displacement to apply to obj2 (for periodic images).
+ * @return                true if interaction() would include a hard core
+ *                        energy, found without calculating the energy.
+ *
+ * If the topology has a hard core block for the pair of molecules made from
+ * this force field, see topology::compile_hard(), the vector kernel
+ * block_overlap() is used, otherwise the unrolled kernel of the pair.
+ */
+bool    object::overlaps(force_field* the_force,
+                topology *the_topologies,
+                object* obj2,
+                double shift_x, double shift_y){
+    update_atoms( the_topologies );
+    obj2->update_atoms( the_topologies );
+    PROFILE_COUNT( COUNT_ATOM_PAIRS, n_atoms * obj2->n_atoms );
+
+    const double *hard2 = the_topologies->hard_block( o_type, obj2->o_type,
+                the_force->stamp );
+    if( hard2 )
+        return block_overlap( n_atoms, atom_x, atom_y, shift_x, shift_y,
+                obj2->n_atoms, obj2->atom_x, obj2->atom_y, hard2 );
+    return the_topologies->overlap_kernel( o_type, obj2->o_type )(
+                the_force, this, obj2, shift_x, shift_y );
 }
 
 /**
@@ -253,19 +348,16 @@ double  object::box_energy(
         force_field* the_force,
         topology* the_topology,
         double x_size, double y_size ){
-    int     n1, i;
     double  x1, y1, r;
-    atom    *at1;
     double  value = 0.0;
 
-    n1 = the_topology->molecules(o_type).n_atoms;
-    for(i=0;i<n1;i++){
-        at1 = &(the_topology->molecules(o_type).the_atoms(i));
-        x1 = pos_x - sin(orientation)*at1->y_pos + cos(orientation)*at1->x_pos;
-        y1 = pos_y + cos(orientation)*at1->y_pos + sin(orientation)*at1->x_pos;
-        r  = the_force->size(at1->type);
+    update_atoms( the_topology );
+    for(int i = 0; i < n_atoms; i++){
+        x1 = atom_x[i];
+        y1 = atom_y[i];
+        r  = the_force->size(atom_t[i]);
         if((x1 < r ) || (x1 > (x_size-r)) ||
-                (y1 < r) || (x1 > (y_size-r))) value += the_force->big_energy;
+                (y1 < r) || (y1 > (y_size-r))) value += the_force->big_energy;
     }
     return value;
 }
@@ -274,18 +366,13 @@ double  object::box_energy(
 	force_field *the_force,
         topology *the_topology,
         polygon *the_box ){
-    int     n1, i;
-    double  x1, y1, r;
-    atom    *at1;
+    double  r;
     double  value = 0.0;
 
-    n1 = the_topology->molecules(o_type).n_atoms;
-    for(i=0;i<n1;i++){
-        at1 = &(the_topology->molecules(o_type).the_atoms(i));
-        x1 = pos_x - sin(orientation)*at1->y_pos + cos(orientation)*at1->x_pos;
-        y1 = pos_y + cos(orientation)*at1->y_pos + sin(orientation)*at1->x_pos;
-        r  = the_force->size(at1->type);
-        if(!the_box->is_inside(x1,y1,r)) value += the_force->big_energy;
+    update_atoms( the_topology );
+    for(int i = 0; i < n_atoms; i++){
+        r  = the_force->size(atom_t[i]);
+        if(!the_box->is_inside(atom_x[i],atom_y[i],r)) value += the_force->big_energy;
     }
     return value;
 }
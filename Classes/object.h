@@ -7,6 +7,15 @@
  * @class   object object.h
  * \brief   An object in a configuration.
  *
+ * As well as its type, position and orientation an object keeps a cache of
+ * the positions (in the configuration frame), types and radii of its atoms.
+ * The cache is filled by update_atoms() from the topology and is only
+ * recalculated when the position or orientation of the object has changed
+ * since it was filled (or the topology is different), so the trigonometry is
+ * not repeated for every pair of atoms. The cache holds only as many atoms
+ * as the molecule of the object has, so a disc costs a few words rather
+ * than room for MAX_ATOMS atoms, which keeps more objects in the processor
+ * caches. atom_x, atom_y, atom_r and atom_t point into it.
  */
 
 #ifndef OBJECT_H
@@ -17,6 +26,7 @@
 #include "polygon.h"
 #include <fstream>
 #include <sstream>
+#include <vector>
 
 class object {
 public:
@@ -28,6 +38,7 @@ public:
     virtual ~object();                      ///< Destructor
 
     void    assign(const object &orig);	    ///< Copy assignment
+    object& operator=(const object &orig);  ///< Copy with the energy and atom cache
 
     void    move(double dx, double dy);     ///< Move the object by dx, dy
     void    rotate(double angle );          ///< Rotate the object angle.
@@ -41,7 +52,14 @@ public:
     void    expand(double dl);              ///< Move coordinates by multiplication with dl.
     double  interaction(force_field *the_force,
                 topology *the_topology,
-                object *obj2);              ///< The energy of interaction with obj2
+                object *obj2,
+                double shift_x = 0.0,
+                double shift_y = 0.0 );     ///< The energy of interaction with obj2 (displaced by shift_x, shift_y)
+    bool    overlaps(force_field *the_force,
+                topology *the_topology,
+                object *obj2,
+                double shift_x = 0.0,
+                double shift_y = 0.0 );     ///< Do the hard cores overlap those of obj2 (displaced by shift_x, shift_y)
     double  box_energy(force_field *the_force,
                 topology *the_topology,
                 double x_size,
@@ -53,8 +71,23 @@ public:
     double  pos_x, pos_y;                   ///< Position of the object
     double  orientation;                    ///< Rotational orientation
     int     o_type;                         ///< Type of object determines atoms.
+
+    void    update_atoms(topology *the_topology
+                 );                         ///< Make sure the atom cache is up to date.
+    void    forget_atoms();                 ///< Mark the atom cache as out of date.
+    int     n_atoms;                        ///< Number of atoms in the cache.
+    double  *atom_x;                        ///< Cached x coordinates of the atoms.
+    double  *atom_y;                        ///< Cached y coordinates of the atoms.
+    double  *atom_r;                        ///< Cached radii of the atoms (from the topology).
+    int     *atom_t;                        ///< Cached types of the atoms.
 private:
     double  saved_energy;                   ///< Short cut if no need to recalculate
+    topology *cache_topology;               ///< Topology used to fill the atom cache (NULL if empty).
+    double  cache_x, cache_y;               ///< Position used to fill the atom cache.
+    double  cache_angle;                    ///< Orientation used to fill the atom cache.
+    std::vector<double> cache_coords;       ///< Storage of atom_x, atom_y and atom_r.
+    std::vector<int>    cache_types;        ///< Storage of atom_t.
+    void    size_atoms(int n);              ///< Make room in the atom cache for n atoms.
 };
 
 #endif /* OBJECT_H */
@@ -0,0 +1,106 @@
+/**
+ * @file    object_kernel.cpp
+ * @author  James Sturgis
+ * @date    October 16, 2026
+ * @brief   The interaction kernels between objects and their tables.
+ */
+
+#include "object_kernel.h"
+#include "object.h"
+#include <array>
+#include <cassert>
+#include <utility>
+
+#define N_COUNTS    ( MAX_ATOMS + 1 )       // Atom counts 0 to MAX_ATOMS
+
+/*
+ * The energy of N1 atoms of obj1 with N2 atoms of obj2, displaced by
+ * shift_x, shift_y, summed atom by atom of obj1 as in object::interaction().
+ */
+template<int N1, int N2>
+static double
+interaction_kernel(force_field *the_force, const object *obj1, const object *obj2,
+        double shift_x, double shift_y){
+    double  energy = 0.0;
+    double  x, y, dx, dy, value;
+
+    for( int i = 0; i < N1; i++ ){
+        x     = obj1->atom_x[i] - shift_x;
+        y     = obj1->atom_y[i] - shift_y;
+        value = 0.0;
+        for( int j = 0; j < N2; j++ ){
+            dx     = obj2->atom_x[j] - x;
+            dy     = obj2->atom_y[j] - y;
+            value += the_force->interaction2( obj1->atom_t[i], obj2->atom_t[j],
+                                              dx*dx + dy*dy );
+        }
+        energy += value;
+    }
+    return energy;
+}
+
+/*
+ * true at the first pair of the N1 atoms of obj1 and N2 atoms of obj2 whose
+ * hard cores overlap.
+ */
+template<int N1, int N2>
+static bool
+overlap_kernel(force_field *the_force, const object *obj1, const object *obj2,
+        double shift_x, double shift_y){
+    double  x, y, dx, dy;
+
+    for( int i = 0; i < N1; i++ ){
+        x = obj1->atom_x[i] - shift_x;
+        y = obj1->atom_y[i] - shift_y;
+        for( int j = 0; j < N2; j++ ){
+            dx = obj2->atom_x[j] - x;
+            dy = obj2->atom_y[j] - y;
+            if( the_force->overlap2( obj1->atom_t[i], obj2->atom_t[j], dx*dx + dy*dy ))
+                return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * The tables of kernels, entry n1 * N_COUNTS + n2 is for n1 and n2 atoms.
+ */
+template<size_t... K>
+static constexpr std::array<interaction_fn, sizeof...(K)>
+interaction_table(std::index_sequence<K...>){
+    return {{ &interaction_kernel<K / N_COUNTS, K % N_COUNTS>... }};
+}
+
+template<size_t... K>
+static constexpr std::array<overlap_fn, sizeof...(K)>
+overlap_table(std::index_sequence<K...>){
+    return {{ &overlap_kernel<K / N_COUNTS, K % N_COUNTS>... }};
+}
+
+static constexpr std::array<interaction_fn, N_COUNTS * N_COUNTS> interaction_kernels =
+    interaction_table( std::make_index_sequence<N_COUNTS * N_COUNTS>() );
+static constexpr std::array<overlap_fn, N_COUNTS * N_COUNTS> overlap_kernels =
+    overlap_table( std::make_index_sequence<N_COUNTS * N_COUNTS>() );
+
+/**
+ * @param n1    atoms of the first object, 0 to MAX_ATOMS.
+ * @param n2    atoms of the second object.
+ * @return      the kernel giving the energy of the two objects.
+ */
+interaction_fn
+find_interaction_kernel(int n1, int n2){
+    assert(( n1 >= 0 ) && ( n1 <= MAX_ATOMS ) && ( n2 >= 0 ) && ( n2 <= MAX_ATOMS ));
+    return interaction_kernels[ n1 * N_COUNTS + n2 ];
+}
+
+/**
+ * @param n1    atoms of the first object, 0 to MAX_ATOMS.
+ * @param n2    atoms of the second object.
+ * @return      the kernel testing if the hard cores of the two objects
+ *              overlap.
+ */
+overlap_fn
+find_overlap_kernel(int n1, int n2){
+    assert(( n1 >= 0 ) && ( n1 <= MAX_ATOMS ) && ( n2 >= 0 ) && ( n2 <= MAX_ATOMS ));
+    return overlap_kernels[ n1 * N_COUNTS + n2 ];
+}
@@ -0,0 +1,34 @@
+/**
+ * @file    object_kernel.h
+ * @author  James Sturgis
+ * @date    October 16, 2026
+ * @brief   Interaction kernels between two objects for each pair of atom
+ *          counts.
+ *
+ * object::interaction() and object::overlaps() compare every atom of one
+ * object with every atom of the other. The loops are written as templates on
+ * the two numbers of atoms, instantiated for 0 to MAX_ATOMS atoms each, so the
+ * compiler can unroll them completely and keep the atoms in registers. Single
+ * disc molecules then reduce to one distance and one table look up.
+ *
+ * The topology chooses the kernels for each pair of molecule types when it is
+ * made, in find_bounds(), and object::interaction() calls the one for its pair
+ * through topology::interaction_kernel(), object::overlaps() likewise through
+ * topology::overlap_kernel() unless the topology has a hard core block for the
+ * pair (see pair_kernel.h). The kernels make the same floating point
+ * operations, in the same order, as the batch path of pair_distances()
+ * followed by force_field::interactions() or overlaps(), so the results are
+ * identical.
+ */
+
+#ifndef OBJECT_KERNEL_H
+#define OBJECT_KERNEL_H
+
+#include "topology.h"
+
+interaction_fn  find_interaction_kernel(int n1, int n2
+                    );                      ///< The energy kernel for n1 and n2 atoms.
+overlap_fn      find_overlap_kernel(int n1, int n2
+                    );                      ///< The hard core kernel for n1 and n2 atoms.
+
+#endif /* OBJECT_KERNEL_H */
@@ -0,0 +1,381 @@
+/**
+ * @file    pair_kernel.cpp
+ * @author  James Sturgis
+ * @date    October 16, 2026
+ * @brief   Scalar, AVX2 and AVX-512 versions of the atom pair kernels.
+ *
+ * The vector versions are compiled for their instruction set with target
+ * attributes, so the rest of the program does not need special compiler
+ * flags, and they are only called if the processor supports them. Fused
+ * multiply-add is disabled for the file as it would change the rounding of
+ * dx*dx + dy*dy compared to the scalar version.
+ */
+
+#pragma GCC optimize ("fp-contract=off")
+
+#include "pair_kernel.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define HAVE_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+typedef void (*distance_function)(double, double, int, const double *,
+                const double *, double *);
+typedef bool (*overlap_function)(double, double, double, int, const double *,
+                const double *, const double *, double, double);
+typedef bool (*block_function)(int, const double *, const double *, double,
+                double, int, const double *, const double *, const double *);
+
+/* Scalar versions, these define the results of the others. */
+
+static void
+distances_scalar(double x, double y, int n, const double *xs, const double *ys,
+        double *r2){
+    double  dx, dy;
+
+    for( int j = 0; j < n; j++ ){
+        dx = xs[j] - x;
+        dy = ys[j] - y;
+        r2[j] = dx*dx + dy*dy;
+    }
+}
+
+static bool
+overlap_scalar(double x, double y, double r, int n, const double *xs,
+        const double *ys, const double *rs, double x_period, double y_period){
+    double  dx, dy, s;
+
+    for( int j = 0; j < n; j++ ){
+        dx = xs[j] - x;
+        dy = ys[j] - y;
+        if( x_period > 0.0 ){               // Find closest image
+            if( dx > ( x_period - r - rs[j] )) dx -= x_period;
+            if( dx < ( r + rs[j] - x_period )) dx += x_period;
+            if( dy > ( y_period - r - rs[j] )) dy -= y_period;
+            if( dy < ( r + rs[j] - y_period )) dy += y_period;
+        }
+        s = r + rs[j];
+        if( dx*dx + dy*dy < s*s ) return true;
+    }
+    return false;
+}
+
+static bool
+block_scalar(int n1, const double *x1, const double *y1, double shift_x,
+        double shift_y, int n2, const double *x2, const double *y2,
+        const double *hard2){
+    double  x, y, dx, dy;
+
+    for( int i = 0; i < n1; i++ ){
+        x = x1[i] - shift_x;
+        y = y1[i] - shift_y;
+        for( int j = 0; j < n2; j++ ){
+            dx = x2[j] - x;
+            dy = y2[j] - y;
+            if( dx*dx + dy*dy < hard2[ i * n2 + j ] ) return true;
+        }
+    }
+    return false;
+}
+
+#ifdef HAVE_X86_KERNELS
+
+/*
+ * AVX2 versions, 4 atoms at a time with a mask for the last ones. The last
+ * atoms are not left to the scalar versions, that would run SSE code with the
+ * upper halves of the registers in use and pay for the change of state on
+ * every call.
+ */
+
+__attribute__((target("avx2"))) static void
+distances_avx2(double x, double y, int n, const double *xs, const double *ys,
+        double *r2){
+    __m256d vx = _mm256_set1_pd( x );
+    __m256d vy = _mm256_set1_pd( y );
+    __m256i lane = _mm256_set_epi64x( 3, 2, 1, 0 );
+    __m256i k;
+    __m256d dx, dy;
+
+    for( int j = 0; j < n; j += 4 ){
+        k  = _mm256_cmpgt_epi64( _mm256_set1_epi64x( n - j ), lane );
+        dx = _mm256_sub_pd( _mm256_maskload_pd( xs + j, k ), vx );
+        dy = _mm256_sub_pd( _mm256_maskload_pd( ys + j, k ), vy );
+        _mm256_maskstore_pd( r2 + j, k, _mm256_add_pd( _mm256_mul_pd( dx, dx ),
+                                                       _mm256_mul_pd( dy, dy )));
+    }
+}
+
+__attribute__((target("avx2"))) static bool
+overlap_avx2(double x, double y, double r, int n, const double *xs,
+        const double *ys, const double *rs, double x_period, double y_period){
+    __m256d vx = _mm256_set1_pd( x );
+    __m256d vy = _mm256_set1_pd( y );
+    __m256d vr = _mm256_set1_pd( r );
+    __m256d lx = _mm256_set1_pd( x_period );
+    __m256d ly = _mm256_set1_pd( y_period );
+    __m256i lane = _mm256_set_epi64x( 3, 2, 1, 0 );
+    __m256i k;
+    __m256d dx, dy, r2, s, m;
+
+    for( int j = 0; j < n; j += 4 ){
+        k  = _mm256_cmpgt_epi64( _mm256_set1_epi64x( n - j ), lane );
+        r2 = _mm256_maskload_pd( rs + j, k );
+        dx = _mm256_sub_pd( _mm256_maskload_pd( xs + j, k ), vx );
+        dy = _mm256_sub_pd( _mm256_maskload_pd( ys + j, k ), vy );
+        if( x_period > 0.0 ){
+            m  = _mm256_cmp_pd( dx, _mm256_sub_pd( _mm256_sub_pd( lx, vr ), r2 ), _CMP_GT_OQ );
+            dx = _mm256_blendv_pd( dx, _mm256_sub_pd( dx, lx ), m );
+            m  = _mm256_cmp_pd( dx, _mm256_sub_pd( _mm256_add_pd( vr, r2 ), lx ), _CMP_LT_OQ );
+            dx = _mm256_blendv_pd( dx, _mm256_add_pd( dx, lx ), m );
+            m  = _mm256_cmp_pd( dy, _mm256_sub_pd( _mm256_sub_pd( ly, vr ), r2 ), _CMP_GT_OQ );
+            dy = _mm256_blendv_pd( dy, _mm256_sub_pd( dy, ly ), m );
+            m  = _mm256_cmp_pd( dy, _mm256_sub_pd( _mm256_add_pd( vr, r2 ), ly ), _CMP_LT_OQ );
+            dy = _mm256_blendv_pd( dy, _mm256_add_pd( dy, ly ), m );
+        }
+        s  = _mm256_add_pd( vr, r2 );
+        r2 = _mm256_add_pd( _mm256_mul_pd( dx, dx ), _mm256_mul_pd( dy, dy ));
+        m  = _mm256_cmp_pd( r2, _mm256_mul_pd( s, s ), _CMP_LT_OQ );
+        if( _mm256_movemask_pd( _mm256_and_pd( m, _mm256_castsi256_pd( k ))))
+            return true;
+    }
+    return false;
+}
+
+__attribute__((target("avx2"))) static bool
+block_avx2(int n1, const double *x1, const double *y1, double shift_x,
+        double shift_y, int n2, const double *x2, const double *y2,
+        const double *hard2){
+    __m256i lane = _mm256_set_epi64x( 3, 2, 1, 0 );
+    __m256i k;
+    __m256d vx, vy, dx, dy, r2, m;
+
+    for( int i = 0; i < n1; i++, hard2 += n2 ){
+        vx = _mm256_set1_pd( x1[i] - shift_x );
+        vy = _mm256_set1_pd( y1[i] - shift_y );
+        for( int j = 0; j < n2; j += 4 ){
+            k  = _mm256_cmpgt_epi64( _mm256_set1_epi64x( n2 - j ), lane );
+            dx = _mm256_sub_pd( _mm256_maskload_pd( x2 + j, k ), vx );
+            dy = _mm256_sub_pd( _mm256_maskload_pd( y2 + j, k ), vy );
+            r2 = _mm256_add_pd( _mm256_mul_pd( dx, dx ), _mm256_mul_pd( dy, dy ));
+            m  = _mm256_cmp_pd( r2, _mm256_maskload_pd( hard2 + j, k ), _CMP_LT_OQ );
+            if( _mm256_movemask_pd( _mm256_and_pd( m, _mm256_castsi256_pd( k ))))
+                return true;
+        }
+    }
+    return false;
+}
+
+/* AVX-512 versions, 8 atoms at a time with a mask for the last ones. */
+
+__attribute__((target("avx512f"))) static void
+distances_avx512(double x, double y, int n, const double *xs, const double *ys,
+        double *r2){
+    __m512d vx = _mm512_set1_pd( x );
+    __m512d vy = _mm512_set1_pd( y );
+    __m512d dx, dy;
+    __mmask8 k;
+
+    for( int j = 0; j < n; j += 8 ){
+        k  = ( n - j >= 8 ) ? 0xff : (__mmask8)(( 1 << ( n - j )) - 1 );
+        dx = _mm512_sub_pd( _mm512_maskz_loadu_pd( k, xs + j ), vx );
+        dy = _mm512_sub_pd( _mm512_maskz_loadu_pd( k, ys + j ), vy );
+        _mm512_mask_storeu_pd( r2 + j, k, _mm512_add_pd( _mm512_mul_pd( dx, dx ),
+                                                         _mm512_mul_pd( dy, dy )));
+    }
+}
+
+__attribute__((target("avx512f"))) static bool
+overlap_avx512(double x, double y, double r, int n, const double *xs,
+        const double *ys, const double *rs, double x_period, double y_period){
+    __m512d vx = _mm512_set1_pd( x );
+    __m512d vy = _mm512_set1_pd( y );
+    __m512d vr = _mm512_set1_pd( r );
+    __m512d lx = _mm512_set1_pd( x_period );
+    __m512d ly = _mm512_set1_pd( y_period );
+    __m512d dx, dy, r2, s;
+    __mmask8 k, m;
+
+    for( int j = 0; j < n; j += 8 ){
+        k  = ( n - j >= 8 ) ? 0xff : (__mmask8)(( 1 << ( n - j )) - 1 );
+        r2 = _mm512_maskz_loadu_pd( k, rs + j );
+        dx = _mm512_sub_pd( _mm512_maskz_loadu_pd( k, xs + j ), vx );
+        dy = _mm512_sub_pd( _mm512_maskz_loadu_pd( k, ys + j ), vy );
+        if( x_period > 0.0 ){
+            m  = _mm512_cmp_pd_mask( dx, _mm512_sub_pd( _mm512_sub_pd( lx, vr ), r2 ), _CMP_GT_OQ );
+            dx = _mm512_mask_sub_pd( dx, m, dx, lx );
+            m  = _mm512_cmp_pd_mask( dx, _mm512_sub_pd( _mm512_add_pd( vr, r2 ), lx ), _CMP_LT_OQ );
+            dx = _mm512_mask_add_pd( dx, m, dx, lx );
+            m  = _mm512_cmp_pd_mask( dy, _mm512_sub_pd( _mm512_sub_pd( ly, vr ), r2 ), _CMP_GT_OQ );
+            dy = _mm512_mask_sub_pd( dy, m, dy, ly );
+            m  = _mm512_cmp_pd_mask( dy, _mm512_sub_pd( _mm512_add_pd( vr, r2 ), ly ), _CMP_LT_OQ );
+            dy = _mm512_mask_add_pd( dy, m, dy, ly );
+        }
+        s  = _mm512_add_pd( vr, r2 );
+        r2 = _mm512_add_pd( _mm512_mul_pd( dx, dx ), _mm512_mul_pd( dy, dy ));
+        if( _mm512_mask_cmp_pd_mask( k, r2, _mm512_mul_pd( s, s ), _CMP_LT_OQ ))
+            return true;
+    }
+    return false;
+}
+
+__attribute__((target("avx512f"))) static bool
+block_avx512(int n1, const double *x1, const double *y1, double shift_x,
+        double shift_y, int n2, const double *x2, const double *y2,
+        const double *hard2){
+    __m512d vx, vy, dx, dy, r2;
+    __mmask8 k;
+
+    for( int i = 0; i < n1; i++, hard2 += n2 ){
+        vx = _mm512_set1_pd( x1[i] - shift_x );
+        vy = _mm512_set1_pd( y1[i] - shift_y );
+        for( int j = 0; j < n2; j += 8 ){
+            k  = ( n2 - j >= 8 ) ? 0xff : (__mmask8)(( 1 << ( n2 - j )) - 1 );
+            dx = _mm512_sub_pd( _mm512_maskz_loadu_pd( k, x2 + j ), vx );
+            dy = _mm512_sub_pd( _mm512_maskz_loadu_pd( k, y2 + j ), vy );
+            r2 = _mm512_add_pd( _mm512_mul_pd( dx, dx ), _mm512_mul_pd( dy, dy ));
+            if( _mm512_mask_cmp_pd_mask( k, r2, _mm512_maskz_loadu_pd( k, hard2 + j ), _CMP_LT_OQ ))
+                return true;
+        }
+    }
+    return false;
+}
+
+#endif /* HAVE_X86_KERNELS */
+
+/* Selection of the kernels */
+
+static int                  kernel_level  = KERNEL_SCALAR;
+static distance_function    distance_kernel = distances_scalar;
+static overlap_function     overlap_kernel  = overlap_scalar;
+static block_function       block_kernel    = block_scalar;
+static int                  kernel_init   = set_pair_kernel( KERNEL_AUTO );
+
+/**
+ * @brief Select the version of the kernels to use.
+ *
+ * If the processor does not support the requested version the next best one
+ * is used.
+ *
+ * @param level KERNEL_SCALAR, KERNEL_AVX2, KERNEL_AVX512 or KERNEL_AUTO for
+ *              the best available.
+ * @return      The level actually selected.
+ */
+int
+set_pair_kernel(int level){
+    if( level == KERNEL_AUTO ) level = KERNEL_AVX512;
+    kernel_level    = KERNEL_SCALAR;
+    distance_kernel = distances_scalar;
+    overlap_kernel  = overlap_scalar;
+    block_kernel    = block_scalar;
+#ifdef HAVE_X86_KERNELS
+    __builtin_cpu_init();
+    if(( level >= KERNEL_AVX512 ) && __builtin_cpu_supports( "avx512f" )){
+        kernel_level    = KERNEL_AVX512;
+        distance_kernel = distances_avx512;
+        overlap_kernel  = overlap_avx512;
+        block_kernel    = block_avx512;
+    } else if(( level >= KERNEL_AVX2 ) && __builtin_cpu_supports( "avx2" )){
+        kernel_level    = KERNEL_AVX2;
+        distance_kernel = distances_avx2;
+        overlap_kernel  = overlap_avx2;
+        block_kernel    = block_avx2;
+    }
+#endif
+    return kernel_level;
+}
+
+/**
+ * @return The kernel version in use.
+ */
+int
+pair_kernel(){
+    return kernel_level;
+}
+
+/**
+ * @return The name of the kernel version in use.
+ */
+const char *
+pair_kernel_name(){
+    switch( kernel_level ){
+        case KERNEL_AVX512: return "avx512";
+        case KERNEL_AVX2:   return "avx2";
+        default:            return "scalar";
+    }
+}
+
+/**
+ * @brief Squared distances from a point to a block of atoms.
+ *
+ * @param x     x coordinate of the point.
+ * @param y     y coordinate of the point.
+ * @param n     number of atoms.
+ * @param xs    x coordinates of the atoms.
+ * @param ys    y coordinates of the atoms.
+ * @param r2    receives (xs[j]-x)^2 + (ys[j]-y)^2 for each atom.
+ */
+void
+pair_distances(double x, double y, int n, const double *xs, const double *ys,
+        double *r2){
+    if( n < VECTOR_ATOMS )
+        distances_scalar( x, y, n, xs, ys, r2 );
+    else
+        distance_kernel( x, y, n, xs, ys, r2 );
+}
+
+/**
+ * @brief Test if an atom overlaps any of a block of atoms.
+ *
+ * With periodic conditions an atom in the block is moved by one period if it
+ * is closer than r + rs[j] to the opposite edge, as in config::test_clash().
+ *
+ * @param x         x coordinate of the atom.
+ * @param y         y coordinate of the atom.
+ * @param r         radius of the atom.
+ * @param n         number of atoms in the block.
+ * @param xs        x coordinates of the block atoms.
+ * @param ys        y coordinates of the block atoms.
+ * @param rs        radii of the block atoms.
+ * @param x_period  width of the periodic box, 0 if not periodic.
+ * @param y_period  height of the periodic box.
+ * @return          true if the distance between the centers of the atom and
+ *                  an atom of the block is less than the sum of the radii.
+ */
+bool
+pair_overlap(double x, double y, double r, int n, const double *xs,
+        const double *ys, const double *rs, double x_period, double y_period){
+    if( n < VECTOR_ATOMS )
+        return overlap_scalar( x, y, r, n, xs, ys, rs, x_period, y_period );
+    return overlap_kernel( x, y, r, n, xs, ys, rs, x_period, y_period );
+}
+
+/**
+ * @brief Test if any atom of one molecule is within the hard core of an atom
+ * of another.
+ *
+ * The squared hard core distances of the pairs of atoms are given by a block,
+ * so that the vector loop has no force field lookups.
+ *
+ * @param n1        number of atoms of the first molecule.
+ * @param x1        x coordinates of its atoms.
+ * @param y1        y coordinates of its atoms.
+ * @param shift_x   displacement of the second molecule in x, subtracted from
+ *                  the atoms of the first.
+ * @param shift_y   displacement of the second molecule in y.
+ * @param n2        number of atoms of the second molecule.
+ * @param x2        x coordinates of its atoms.
+ * @param y2        y coordinates of its atoms.
+ * @param hard2     squared hard core distance of atom i of the first and
+ *                  atom j of the second at i * n2 + j.
+ * @return          true at the first pair closer than their hard core
+ *                  distance.
+ */
+bool
+block_overlap(int n1, const double *x1, const double *y1, double shift_x,
+        double shift_y, int n2, const double *x2, const double *y2,
+        const double *hard2){
+    if( n2 < VECTOR_ATOMS )
+        return block_scalar( n1, x1, y1, shift_x, shift_y, n2, x2, y2, hard2 );
+    return block_kernel( n1, x1, y1, shift_x, shift_y, n2, x2, y2, hard2 );
+}
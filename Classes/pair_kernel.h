@@ -0,0 +1,65 @@
+/**
+ * @file    pair_kernel.h
+ * @author  James Sturgis
+ * @date    October 16, 2026
+ * @brief   Vectorized kernels for comparing atoms with blocks of atoms.
+ *
+ * The atom caches of the objects hold their atom coordinates and radii as
+ * separate arrays, so one atom can be compared with all the atoms of another
+ * molecule several at a time using the SIMD units of the processor.
+ *
+ * * pair_distances() calculates the squared distances from an atom to a
+ *   block of atoms, these are then used with the tabulated force field.
+ *   Together with force_field::interactions() and overlaps() this is the
+ *   batch entry point for one atom against a block of atoms. The energies of
+ *   objects use the unrolled kernels of object_kernel.h instead, which make
+ *   the same operations for a known number of atoms.
+ * * pair_overlap() tests if an atom overlaps any atom of a block, with the
+ *   periodic image rules used by config::test_clash().
+ * * block_overlap() tests if any atom of one molecule is within the hard
+ *   core of an atom of another, the squared hard core distances of each pair
+ *   of atoms being given in a block so that no force field lookups remain in
+ *   the vector loop. object::overlaps() uses it when the topology has such a
+ *   block, see topology::compile_hard().
+ *
+ * Only the distances of the energies are vectorized, the sum of the energies
+ * stays scalar: each pair needs a lookup in the tabulated potential, which
+ * would be a gather, and with the few atoms of a molecule a vector of energies
+ * was slower than the scalar loop.
+ *
+ * Each kernel exists in a scalar version, and on x86 processors in AVX2 and
+ * AVX-512 versions. The best version supported by the processor is selected
+ * when the program starts, set_pair_kernel() can force a particular version
+ * (for testing). Blocks of fewer than VECTOR_ATOMS atoms always use the
+ * scalar version, for them a vector is mostly empty and slower. The vector
+ * versions do exactly the same floating point operations, in the same order
+ * and without fused multiply-add, as the scalar version so the results, and
+ * in particular the hard core decisions, are identical whichever version is
+ * used.
+ */
+
+#ifndef PAIR_KERNEL_H
+#define PAIR_KERNEL_H
+
+#define KERNEL_AUTO     -1                  ///< The best kernel available
+#define KERNEL_SCALAR   0                   ///< Plain c++ loops
+#define KERNEL_AVX2     1                   ///< 4 atoms at a time
+#define KERNEL_AVX512   2                   ///< 8 atoms at a time
+#define VECTOR_ATOMS    4                   ///< Fewest atoms in a block for the vector versions
+
+void    pair_distances(double x, double y,
+            int n, const double *xs, const double *ys,
+            double *r2 );                   ///< Squared distances from x, y to n atoms.
+bool    pair_overlap(double x, double y, double r,
+            int n, const double *xs, const double *ys, const double *rs,
+            double x_period, double y_period ); ///< Does the atom at x, y of radius r overlap one of n atoms.
+bool    block_overlap(int n1, const double *x1, const double *y1,
+            double shift_x, double shift_y,
+            int n2, const double *x2, const double *y2,
+            const double *hard2 );          ///< Is an atom of one molecule within the hard core of an atom of another.
+
+int     set_pair_kernel(int level);         ///< Choose the kernel, returns the one actually used.
+int     pair_kernel();                      ///< The kernel in use.
+const char *pair_kernel_name();             ///< Name of the kernel in use.
+
+#endif /* PAIR_KERNEL_H */
@@ -94,6 +94,72 @@ polygon::area(){
     return abs(Area / 2.0);
 }
 
+/*
+ * Signed area of the part of the triangle 0, a, b that is inside the circle
+ * of radius r around 0. The edge a, b is cut where it crosses the circle, the
+ * pieces inside give triangles and those outside circular sectors.
+ */
+double
+triangle_circle_area( Point a, Point b, double r ){
+    double  dx = b.x - a.x;
+    double  dy = b.y - a.y;
+    double  qa = dx * dx + dy * dy;		// |a + t(b-a)|^2 = r^2
+    double  qb = a.x * dx + a.y * dy;
+    double  qc = a.x * a.x + a.y * a.y - r * r;
+    double  t[4];
+    int     n_t = 0;
+    double  result = 0.0;
+
+    t[n_t++] = 0.0;
+    if( qa > 0.0 ){
+        double disc = qb * qb - qa * qc;
+        if( disc > 0.0 ){
+            double root = sqrt( disc );
+            double t1 = ( -qb - root ) / qa;
+            double t2 = ( -qb + root ) / qa;
+            if(( t1 > 0.0 ) && ( t1 < 1.0 )) t[n_t++] = t1;
+            if(( t2 > 0.0 ) && ( t2 < 1.0 )) t[n_t++] = t2;
+        }
+    }
+    t[n_t++] = 1.0;
+    for( int k = 0; k < n_t - 1; k++ ){
+        Point p = Point( a.x + t[k] * dx, a.y + t[k] * dy );
+        Point q = Point( a.x + t[k+1] * dx, a.y + t[k+1] * dy );
+        double cross = p.x * q.y - p.y * q.x;
+        double mx = ( p.x + q.x ) / 2.0;
+        double my = ( p.y + q.y ) / 2.0;
+        if( mx * mx + my * my <= r * r )
+            result += cross / 2.0;			// Triangle
+        else
+            result += r * r * atan2( cross, p.x * q.x + p.y * q.y ) / 2.0; // Sector
+    }
+    return result;
+}
+
+/**
+ * Area of the intersection of a disc with the polygon, calculated exactly by
+ * adding the intersections of the disc with the triangles made by its center
+ * and each edge.
+ *
+ * @param x     x coordinate of the center of the disc.
+ * @param y     y coordinate of the center of the disc.
+ * @param r     radius of the disc.
+ * @return      the area of the disc inside the polygon.
+ */
+double
+polygon::circle_area( double x, double y, double r ){
+    double Area = 0.0;
+
+    if( r <= 0.0 ) return 0.0;
+    for(int i = 0; i < n_vertex; i++){
+        Point curr = _vertices[i];
+        Point next = _vertices[(i + 1)%n_vertex];
+        Area += triangle_circle_area( Point( curr.x - x, curr.y - y ),
+                                      Point( next.x - x, next.y - y ), r );
+    }
+    return abs(Area);
+}
+
 double
 polygon::max_dist()			// Calculate maximum length in polygon.
 {
@@ -42,6 +42,8 @@ public:
     void    rotate( double angle );	///< Rotate about origin (clockwise) (JS 24/1/20)
 
     double  area();
+    double  circle_area( double x,	///< Area of the disc of radius r around x, y that is inside
+		double y, double r );
     double  max_dist();			///< Longest vertex to vertex distance (JS 8/1/20)
     double  x_min();			///< Points on bounding rectangle (JS 8/1/20)
     double  x_max();
@@ -0,0 +1,112 @@
+/**
+ * @file    profile.cpp
+ * @author  James Sturgis
+ * @date    October 16, 2026
+ * @brief   Implementation of the profiling counters.
+ */
+
+#include "profile.h"
+#include <cstring>
+#include <mutex>
+#include <vector>
+#include <boost/format.hpp>
+
+using boost::format;
+
+static std::mutex                       profile_lock;
+static std::vector<profile_counters *>  profile_all;    ///< Counters of every thread.
+static thread_local profile_counters    *profile_mine = nullptr;
+
+static const char *phase_names[N_PHASES] = {
+    "proposal", "neighbours", "energy", "accept", "bookkeeping"
+};
+
+static const char *event_names[N_EVENTS] = {
+    "steps", "atom pairs", "pairs beyond range", "overlap early exits",
+    "atom cache hits", "atom cache misses", "Verlet lookups", "cell lookups",
+    "neighbours found"
+};
+
+/**
+ * @return  true if the programme was compiled with PROFILE defined.
+ */
+bool
+profile_enabled(){
+#ifdef PROFILE
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ * The counters are made the first time a thread uses them and kept until the
+ * end of the programme, so the counts of threads that have stopped are still
+ * in the summary.
+ *
+ * @return  the counters of the calling thread.
+ */
+profile_counters *
+profile_thread(){
+    if( !profile_mine ){
+        profile_mine = new profile_counters;
+        memset( profile_mine, 0, sizeof(profile_counters) );
+        std::lock_guard<std::mutex> guard( profile_lock );
+        profile_all.push_back( profile_mine );
+    }
+    return profile_mine;
+}
+
+/**
+ * Set the counters of all the threads to zero, no other thread must be
+ * counting at the same time.
+ */
+void
+profile_reset(){
+    std::lock_guard<std::mutex> guard( profile_lock );
+
+    for( size_t k = 0; k < profile_all.size(); k++ )
+        memset( profile_all[k], 0, sizeof(profile_counters) );
+}
+
+/**
+ * Write the time in each phase, as a total, per call and as a fraction of
+ * the time of all the phases, and the number of each event, in all and per
+ * step. No other thread must be counting at the same time.
+ *
+ * @param dest  the stream.
+ */
+void
+profile_write(std::ostream& dest){
+    profile_counters    sum;
+    uint64_t            total_ns = 0;
+    double              steps;
+
+    memset( &sum, 0, sizeof(sum) );
+    {
+        std::lock_guard<std::mutex> guard( profile_lock );
+        for( size_t k = 0; k < profile_all.size(); k++ ){
+            for( int i = 0; i < N_EVENTS; i++ )
+                sum.events[i] += profile_all[k]->events[i];
+            for( int i = 0; i < N_PHASES; i++ ){
+                sum.calls[i] += profile_all[k]->calls[i];
+                sum.ns[i]    += profile_all[k]->ns[i];
+            }
+        }
+    }
+    for( int i = 0; i < N_PHASES; i++ )
+        total_ns += sum.ns[i];
+    steps = ( sum.events[COUNT_STEPS] > 0 ) ? sum.events[COUNT_STEPS] : 1;
+
+    dest << "Profile of " << sum.events[COUNT_STEPS] << " steps\n";
+    dest << format("%-20s %12s %12s %10s %8s\n") % "phase" % "calls" % "ms" % "ns/call" % "%";
+    for( int i = 0; i < N_PHASES; i++ )
+        dest << format("%-20s %12d %12.1f %10.1f %8.1f\n") % phase_names[i]
+                % sum.calls[i] % ( sum.ns[i] * 1e-6 )
+                % ( sum.calls[i] > 0 ? (double)sum.ns[i] / sum.calls[i] : 0.0 )
+                % ( total_ns > 0 ? 100.0 * sum.ns[i] / total_ns : 0.0 );
+    dest << format("%-20s %12s %12s\n") % "event" % "count" % "per step";
+    for( int i = 1; i < N_EVENTS; i++ )
+        dest << format("%-20s %12d %12.3f\n") % event_names[i]
+                % sum.events[i] % ( sum.events[i] / steps );
+}
@@ -0,0 +1,108 @@
+/**
+ * @file    profile.h
+ * @author  James Sturgis
+ * @date    October 16, 2026
+ * \brief   Counters and timers for the phases of the integration steps.
+ *
+ * The integrator and the configuration count and time what is done in each
+ * step, to show where the time goes for a given system before tuning the cut
+ * off, the skin or the step size. The time of a step is split between the
+ * phases:
+ *
+ * * proposal: choosing the object and moving it.
+ * * neighbours: finding the neighbours, in the Verlet or cell lists.
+ * * energy: the energies of the object, or the search for an overlap.
+ * * accept: the Metropolis test.
+ * * bookkeeping: keeping or undoing the move, updating the saved energies
+ *   and lists and adjusting dl_max.
+ *
+ * and the events counted are the steps, the atom pairs whose distance was
+ * calculated, the object pairs beyond range skipped without looking at their
+ * atoms, the hard steps stopped at the first overlap found, the atom cache
+ * hits and misses and the neighbour lookups with the Verlet or cell lists
+ * and the neighbours they gave.
+ *
+ * The instrumentation is only compiled in when PROFILE is defined, for
+ * example with
+ *
+ *      make clean; make binaries CFLAGS="-Wall -O2 -pthread -DPROFILE"
+ *
+ * otherwise PROFILE_PHASE() and PROFILE_COUNT() are empty and the steps cost
+ * exactly what they did. Each thread has its own counters, profile_write()
+ * gives the sum for all the threads.
+ */
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <cstdint>
+#include <chrono>
+#include <ostream>
+
+enum profile_phase {
+    PHASE_PROPOSAL,
+    PHASE_NEIGHBOURS,
+    PHASE_ENERGY,
+    PHASE_ACCEPT,
+    PHASE_BOOKKEEPING,
+    N_PHASES
+};
+
+enum profile_event {
+    COUNT_STEPS,
+    COUNT_ATOM_PAIRS,
+    COUNT_FAR_PAIRS,
+    COUNT_OVERLAP_EXITS,
+    COUNT_CACHE_HITS,
+    COUNT_CACHE_MISSES,
+    COUNT_VERLET_LOOKUPS,
+    COUNT_CELL_LOOKUPS,
+    COUNT_NEIGHBOURS,
+    N_EVENTS
+};
+
+/**
+ * The counters of one thread.
+ */
+struct profile_counters {
+    uint64_t    events[N_EVENTS];   ///< Number of each event.
+    uint64_t    calls[N_PHASES];    ///< Times each phase was timed.
+    uint64_t    ns[N_PHASES];       ///< Nanoseconds in each phase.
+};
+
+bool        profile_enabled();      ///< Was the instrumentation compiled in.
+profile_counters *profile_thread(); ///< The counters of the calling thread.
+void        profile_reset();        ///< Set all the counters to zero.
+void        profile_write(std::ostream& dest
+                          );        ///< Write the summary of all the threads.
+
+/**
+ * Adds the time from its construction to its destruction to a phase.
+ */
+class profile_timer {
+public:
+    profile_timer(profile_phase a_phase){
+        phase = a_phase;
+        start = std::chrono::steady_clock::now();
+    }
+    ~profile_timer(){
+        profile_counters *counters = profile_thread();
+
+        counters->calls[phase]++;
+        counters->ns[phase] += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                std::chrono::steady_clock::now() - start ).count();
+    }
+private:
+    profile_phase   phase;
+    std::chrono::steady_clock::time_point start;
+};
+
+#ifdef PROFILE
+#define PROFILE_PHASE(phase)    profile_timer profile_scope( phase )
+#define PROFILE_COUNT(event, n) ( profile_thread()->events[event] += (n) )
+#else
+#define PROFILE_PHASE(phase)
+#define PROFILE_COUNT(event, n)
+#endif
+
+#endif /* PROFILE_H */
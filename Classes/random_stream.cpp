@@ -0,0 +1,222 @@
+/**
+ * @file    random_stream.cpp
+ * @author  James Sturgis
+ * @date    October 16, 2026
+ * @brief   Implementation of the random_stream class and the random numbers.
+ *
+ * The generator is Philox 4x32-10 of Salmon et al. (2011), "Parallel random
+ * numbers: as easy as 1, 2, 3", the 128 bit counter is the block number in
+ * the low words and the stream number in the high words, the 64 bit key is
+ * the seed.
+ */
+
+#include "random_stream.h"
+#include <chrono>
+
+#define PHILOX_M0   0xD2511F53u
+#define PHILOX_M1   0xCD9E8D57u
+#define PHILOX_W0   0x9E3779B9u
+#define PHILOX_W1   0xBB67AE85u
+#define PHILOX_ROUNDS 10
+
+static random_stream    default_stream;     ///< Used when a thread has not chosen.
+static thread_local random_stream *current_stream = nullptr;
+
+/**
+ * @brief Constructor.
+ *
+ * @param a_seed    the seed, streams with different seeds are unrelated.
+ * @param a_stream  the stream number.
+ */
+random_stream::random_stream(uint64_t a_seed, uint64_t a_stream){
+    set( a_seed, a_stream );
+}
+
+/**
+ * Restart at the beginning of another stream.
+ *
+ * @param a_seed    the seed.
+ * @param a_stream  the stream number.
+ */
+void
+random_stream::set(uint64_t a_seed, uint64_t a_stream){
+    seed    = a_seed;
+    stream  = a_stream;
+    counter = 0;
+    used    = 4;                            // Nothing made yet
+}
+
+/**
+ * Encrypt the counter, stream and block number, with the seed to give the
+ * next four words.
+ */
+void
+random_stream::block(){
+    uint32_t    c0 = (uint32_t)counter;
+    uint32_t    c1 = (uint32_t)( counter >> 32 );
+    uint32_t    c2 = (uint32_t)stream;
+    uint32_t    c3 = (uint32_t)( stream >> 32 );
+    uint32_t    k0 = (uint32_t)seed;
+    uint32_t    k1 = (uint32_t)( seed >> 32 );
+    uint64_t    p0, p1;
+
+    for( int r = 0; r < PHILOX_ROUNDS; r++ ){
+        if( r > 0 ){
+            k0 += PHILOX_W0;
+            k1 += PHILOX_W1;
+        }
+        p0 = (uint64_t)PHILOX_M0 * c0;
+        p1 = (uint64_t)PHILOX_M1 * c2;
+        c0 = (uint32_t)( p1 >> 32 ) ^ c1 ^ k0;
+        c2 = (uint32_t)( p0 >> 32 ) ^ c3 ^ k1;
+        c1 = (uint32_t)p1;
+        c3 = (uint32_t)p0;
+    }
+    words[0] = c0;
+    words[1] = c1;
+    words[2] = c2;
+    words[3] = c3;
+}
+
+/**
+ * @return The next 32 random bits of the stream.
+ */
+uint32_t
+random_stream::next(){
+    if( used == 4 ){
+        block();
+        counter++;
+        used = 0;
+    }
+    return words[ used++ ];
+}
+
+/**
+ * @return The next 64 random bits of the stream.
+ */
+uint64_t
+random_stream::next64(){
+    uint64_t    high = next();
+
+    return ( high << 32 ) | next();
+}
+
+/**
+ * @return A uniform double in [0, 1) with 53 random bits.
+ */
+double
+random_stream::uniform(){
+    uint64_t    high = next() >> 5;
+    uint64_t    low  = next() >> 6;
+
+    return ( high * 67108864.0 + low ) * ( 1.0 / 9007199254740992.0 );
+}
+
+/**
+ * Fill an array with uniform doubles, the same ones as n calls to uniform().
+ *
+ * @param n         the number of values.
+ * @param values    array that receives them.
+ */
+void
+random_stream::uniforms(int n, double *values){
+    int     i = 0;
+
+    if( used & 1 ){                         // Values straddle the blocks
+        for( ; i < n; i++ )
+            values[i] = uniform();
+        return;
+    }
+    for( ; ( i < n ) && ( used < 4 ); i++ )
+        values[i] = uniform();
+    for( ; i + 1 < n; i += 2 ){             // Then whole blocks
+        block();
+        counter++;
+        values[i]   = (( words[0] >> 5 ) * 67108864.0 + ( words[1] >> 6 )) * ( 1.0 / 9007199254740992.0 );
+        values[i+1] = (( words[2] >> 5 ) * 67108864.0 + ( words[3] >> 6 )) * ( 1.0 / 9007199254740992.0 );
+    }
+    for( ; i < n; i++ )
+        values[i] = uniform();
+}
+
+/**
+ * @param n the number of values, at least 1.
+ * @return  a uniform integer from 0 to n-1.
+ */
+int
+random_stream::below(int n){
+    return (int)(( (uint64_t)next() * (uint64_t)n ) >> 32 );
+}
+
+/**
+ * @return How far along the stream is, as a number of 32 bit words.
+ */
+uint64_t
+random_stream::position(){
+    return 4 * counter - ( 4 - used );
+}
+
+/**
+ * Go to a position in the stream, as given by position().
+ *
+ * @param a_position    the number of words already used.
+ */
+void
+random_stream::seek(uint64_t a_position){
+    counter = a_position / 4;
+    used    = 4;
+    if( a_position % 4 ){
+        block();
+        counter++;
+        used = a_position % 4;
+    }
+}
+
+/**
+ * Restart the default stream with a new seed, this is the stream used by all
+ * the threads that have not chosen their own with rnd_use().
+ *
+ * @param seed  the seed.
+ */
+void
+rnd_seed(uint64_t seed){
+    default_stream.set( seed, 0 );
+}
+
+/**
+ * @return A seed from the clock, for when the user does not give one.
+ */
+uint64_t
+rnd_clock_seed(){
+    return std::chrono::high_resolution_clock::now().time_since_epoch().count();
+}
+
+/**
+ * Choose the stream used by rnd_lin() in the calling thread.
+ *
+ * @param a_stream  the stream, NULL to return to the default stream.
+ * @return          the stream used before.
+ */
+random_stream *
+rnd_use(random_stream *a_stream){
+    random_stream *old = current_stream;
+
+    current_stream = a_stream;
+    return old;
+}
+
+/**
+ * @return The stream used by rnd_lin() in the calling thread.
+ */
+random_stream *
+rnd_current(){
+    return current_stream ? current_stream : &default_stream;
+}
+
+/**
+ * @return A uniform double in [0, 1) from the stream of the calling thread.
+ */
+double
+rnd_uniform(){
+    return rnd_current()->uniform();
+}
@@ -0,0 +1,61 @@
+/**
+ * @file    random_stream.h
+ * @author  James Sturgis
+ * @date    October 16, 2026
+ * \brief   Header file for the random_stream class and the random numbers.
+ *
+ * @class   random_stream random_stream.h
+ * @brief   A counter based random number generator (Philox 4x32-10).
+ *
+ * The numbers are made by encrypting a counter with a key, so a stream is
+ * fully defined by its seed, its stream number and how far along it is.
+ * Streams with the same seed and different stream numbers are independent,
+ * they can be given to threads, replicas or domains without any care about
+ * which thread makes which numbers. A stream costs a few words of memory and
+ * nothing to create, so one can be made for each task of a parallel job.
+ *
+ * position() and seek() give and set how far along the stream is, in 32 bit
+ * words, so a stream can be saved and restored exactly.
+ *
+ * The rest of the code gets its random numbers through rnd_lin() in common.h
+ * which uses the current stream of the calling thread. This is a program wide
+ * default stream, set by rnd_seed(), unless the thread has chosen its own
+ * with rnd_use(). Threads other than the main one must choose their own
+ * stream before drawing numbers.
+ */
+
+#ifndef RANDOM_STREAM_H
+#define RANDOM_STREAM_H
+
+#include <cstdint>
+
+class random_stream {
+public:
+    random_stream(uint64_t a_seed = 1, uint64_t a_stream = 0); ///< Start a stream.
+
+    void        set(uint64_t a_seed, uint64_t a_stream); ///< Restart as another stream.
+    uint32_t    next();                     ///< Next 32 random bits.
+    uint64_t    next64();                   ///< Next 64 random bits.
+    double      uniform();                  ///< Uniform double in [0, 1).
+    void        uniforms(int n, double *values); ///< n uniform doubles in [0, 1).
+    int         below(int n);               ///< Uniform integer from 0 to n-1.
+    uint64_t    position();                 ///< Number of words used.
+    void        seek(uint64_t a_position);  ///< Go to a position.
+
+    uint64_t    seed;                       ///< The key of the stream.
+    uint64_t    stream;                     ///< The stream number.
+private:
+    void        block();                    ///< Make the words for the counter.
+
+    uint64_t    counter;                    ///< Number of the current block.
+    uint32_t    words[4];                   ///< The current block.
+    int         used;                       ///< Words of the block already used.
+};
+
+void        rnd_seed(uint64_t seed);        ///< Restart the default stream.
+uint64_t    rnd_clock_seed();               ///< A seed that changes from run to run.
+random_stream *rnd_use(random_stream *a_stream); ///< Choose the stream of this thread.
+random_stream *rnd_current();               ///< The stream of this thread.
+double      rnd_uniform();                  ///< Uniform in [0, 1) from the stream of this thread.
+
+#endif /* RANDOM_STREAM_H */
@@ -0,0 +1,103 @@
+/**
+ * @file    thread_pool.cpp
+ * @author  James Sturgis
+ * @date    October 16, 2026
+ * @brief   Implementation of the thread_pool class.
+ */
+
+#include "thread_pool.h"
+
+/**
+ * @brief Constructor, starts the worker threads.
+ *
+ * @param a_n_threads   Total number of threads to use including the caller
+ *                      of run(), if zero or less one per core.
+ */
+thread_pool::thread_pool(int a_n_threads){
+    n_threads  = ( a_n_threads > 0 ) ? a_n_threads : hardware_threads();
+    job        = NULL;
+    n_tasks    = 0;
+    next_task  = 0;
+    busy       = 0;
+    generation = 0;
+    stopping   = false;
+    for( int i = 1; i < n_threads; i++ )
+        workers.push_back( std::thread( &thread_pool::worker, this, i ));
+}
+
+/**
+ * Destructor, waits for the workers to stop.
+ */
+thread_pool::~thread_pool(){
+    {
+        std::unique_lock<std::mutex> guard( lock );
+        stopping = true;
+    }
+    start.notify_all();
+    for( size_t i = 0; i < workers.size(); i++ )
+        workers[i].join();
+}
+
+/**
+ * @return The number of hardware threads, at least 1.
+ */
+int
+thread_pool::hardware_threads(){
+    int n = std::thread::hardware_concurrency();
+    return ( n > 0 ) ? n : 1;
+}
+
+/**
+ * @brief Share out a job between the threads.
+ *
+ * @param a_n_tasks The number of tasks.
+ * @param work      Function called as work( task, thread ) for each task.
+ */
+void
+thread_pool::run(int a_n_tasks, const std::function<void(int, int)>& work){
+    if( workers.empty() || ( a_n_tasks <= 1 )){ // Nothing to share
+        for( int t = 0; t < a_n_tasks; t++ )
+            work( t, 0 );
+        return;
+    }
+    {
+        std::unique_lock<std::mutex> guard( lock );
+        job       = &work;
+        n_tasks   = a_n_tasks;
+        next_task = 0;
+        busy      = workers.size();
+        generation++;
+    }
+    start.notify_all();
+    do_tasks( 0 );                          // Help with the work
+    std::unique_lock<std::mutex> guard( lock );
+    done.wait( guard, [this]{ return busy == 0; });
+    job = NULL;
+}
+
+void
+thread_pool::do_tasks(int id){
+    int     task;
+
+    while(( task = next_task++ ) < n_tasks )
+        (*job)( task, id );
+}
+
+void
+thread_pool::worker(int id){
+    unsigned    seen = 0;
+
+    for(;;){
+        {
+            std::unique_lock<std::mutex> guard( lock );
+            start.wait( guard, [&]{ return stopping || ( generation != seen ); });
+            if( stopping ) return;
+            seen = generation;
+        }
+        do_tasks( id );
+        {
+            std::unique_lock<std::mutex> guard( lock );
+            if( --busy == 0 ) done.notify_one();
+        }
+    }
+}
@@ -0,0 +1,58 @@
+/**
+ * @file    thread_pool.h
+ * @author  James Sturgis
+ * @date    October 16, 2026
+ * \brief   Header file for the thread_pool class.
+ *
+ * @class   thread_pool thread_pool.h
+ * @brief   A fixed set of worker threads that share out numbered tasks.
+ *
+ * run( n_tasks, work ) calls work( task, thread ) once for each task number
+ * from 0 to n_tasks-1 and returns when they are all finished. The calling
+ * thread takes part as thread 0, the workers are numbered 1 to n_threads-1,
+ * so thread can be used to index per thread scratch space. Tasks are handed
+ * out in order, but which thread does which task is not fixed, so any result
+ * that must not depend on the number of threads should be stored per task and
+ * combined afterwards in task order.
+ *
+ * The workers sleep between calls to run(), which must not be nested.
+ */
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+
+class thread_pool {
+public:
+    thread_pool(int n_threads);             ///< Start n_threads-1 workers (0 for one per core).
+    virtual ~thread_pool();                 ///< Stop the workers.
+
+    void    run(int n_tasks,
+                const std::function<void(int, int)>& work
+                );                          ///< Do work( task, thread ) for all the tasks.
+    static int  hardware_threads();         ///< Number of threads the machine can run.
+
+    int     n_threads;                      ///< Number of threads including the caller.
+private:
+    void    worker(int id);                 ///< Main loop of a worker thread.
+    void    do_tasks(int id);               ///< Take tasks until there are none left.
+
+    std::vector<std::thread>    workers;
+    std::mutex                  lock;
+    std::condition_variable     start;      ///< Signals a new job or stop.
+    std::condition_variable     done;       ///< Signals that the workers are idle.
+    const std::function<void(int, int)> *job;
+    int                         n_tasks;    ///< Number of tasks in the job.
+    std::atomic<int>            next_task;  ///< Next task to hand out.
+    int                         busy;       ///< Workers still on the job.
+    unsigned                    generation; ///< Counts the jobs.
+    bool                        stopping;
+};
+
+#endif /* THREAD_POOL_H */
@@ -9,6 +9,9 @@
 #include <malloc.h>
 #include "topology.h"
 #include "common.h"
+#include "object_kernel.h"
+#include "force_field.h"
+#include "pair_kernel.h"
 #include <cmath>
 #include <fstream>
 #include <iostream>
@@ -22,6 +25,7 @@ using namespace std;
 topology::topology() {                          // An empty topology has no molecules or atoms.
     n_atom_types = 0;
     n_molecules  = 0;
+    hard_stamp   = 0;
     check();
 }
 
@@ -43,16 +47,23 @@ topology::topology(topology* orig){		// Make a deep copy
             molecules(i).the_atoms(j) = orig->molecules(i).the_atoms(j);
         }
     }
+    extents = orig->extents;
+    radii   = orig->radii;
+    interaction_kernels = orig->interaction_kernels;
+    overlap_kernels     = orig->overlap_kernels;
+    hard_stamp          = 0;                // Blocks are made again when needed
 }
 
 topology::topology(const char *filename) {      // Read the topology from a named file.
     ifstream ff(filename);
     read_topology( ff );
     ff.close();
+    find_bounds();
 }
 
 topology::topology(std::istream& source) {      // Read the topology from an open file.
     read_topology( source );
+    find_bounds();
 }
 
 topology::topology(float size) {
@@ -145,6 +156,8 @@ topology::read_topology(std::istream& ff ) {
         if (!(iss >> molecules[i].n_atoms)) 
                                       throw runtime_error("File ended unexpectedly in molecule descriptions., exiting... \n");
         assert( molecules[i].n_atoms > 0 );
+        if( molecules[i].n_atoms > MAX_ATOMS )
+                                      throw runtime_error("Too many atoms in molecule, the limit is MAX_ATOMS (topology.h)\n");
         molecules[i].the_atoms.resize(molecules[i].n_atoms);
         for(int j=0; j< molecules[i].n_atoms; j++ ){
             if(!my_getline(ff, &line ))
@@ -216,5 +229,115 @@ topology::add_molecule( float r ){
     molecules[i].rename( "Hard disk" );
     molecules[i].add_atom( an_atom );
     delete an_atom;
+    find_bounds();
+}
+
+/**
+ * Find the extent and the bounding radius of each molecule type from the
+ * positions and sizes of its atoms, and the kernels for each pair of types
+ * from their numbers of atoms.
+ */
+void
+topology::find_bounds(){
+    double  r;
+
+    extents.assign( n_molecules, 0.0 );
+    radii.assign( n_molecules, 0.0 );
+    for( size_t i = 0; i < n_molecules; i++ )
+        for( int j = 0; j < molecules(i).n_atoms; j++ ){
+            r = sqrt( molecules(i).the_atoms(j).x_pos * molecules(i).the_atoms(j).x_pos
+                    + molecules(i).the_atoms(j).y_pos * molecules(i).the_atoms(j).y_pos );
+            extents[i] = simple_max( extents[i], r );
+            r += atom_sizes( molecules(i).the_atoms(j).type );
+            radii[i]   = simple_max( radii[i], r );
+        }
+    interaction_kernels.resize( n_molecules * n_molecules );
+    overlap_kernels.resize( n_molecules * n_molecules );
+    for( size_t i = 0; i < n_molecules; i++ )
+        for( size_t j = 0; j < n_molecules; j++ ){
+            interaction_kernels[ i * n_molecules + j ] =
+                find_interaction_kernel( molecules(i).n_atoms, molecules(j).n_atoms );
+            overlap_kernels[ i * n_molecules + j ] =
+                find_overlap_kernel( molecules(i).n_atoms, molecules(j).n_atoms );
+        }
+    hard_stamp = 0;                             // The atoms may have changed
+}
+
+/**
+ * Make the hard core blocks of the force field, unless they are already
+ * those of the force field as it is now. Each block holds, for a pair of
+ * molecule types, the squared hard core distances of all the pairs of their
+ * atoms, atom i of the first and j of the second at i * n2 + j. Only pairs
+ * whose second molecule has VECTOR_ATOMS atoms or more have one, with fewer
+ * atoms the unrolled kernels are faster.
+ *
+ * This must not be called while other threads use the blocks.
+ *
+ * @param the_force the force field.
+ */
+void
+topology::compile_hard(force_field *the_force){
+    int     n1, n2;
+
+    if(( the_force->stamp == 0 ) || ( hard_stamp == the_force->stamp ))
+        return;
+    hard_offsets.assign( n_molecules * n_molecules, -1 );
+    hard_table.clear();
+    for( size_t i = 0; i < n_molecules; i++ )
+        for( size_t j = 0; j < n_molecules; j++ ){
+            n1 = molecules(i).n_atoms;
+            n2 = molecules(j).n_atoms;
+            if( n2 < VECTOR_ATOMS ) continue;
+            hard_offsets[ i * n_molecules + j ] = hard_table.size();
+            for( int a = 0; a < n1; a++ )
+                for( int b = 0; b < n2; b++ )
+                    hard_table.push_back( the_force->hard2(
+                            molecules(i).the_atoms(a).type,
+                            molecules(j).the_atoms(b).type ));
+        }
+    hard_stamp = the_force->stamp;
+}
+
+/**
+ * @param type  the molecule type.
+ * @return      the distance from the center of the molecule to the
+ *              furthest atom center.
+ */
+double
+topology::extent(int type){
+    return extents[type];
+}
+
+/**
+ * @param type  the molecule type.
+ * @return      the radius of the smallest circle around the center of the
+ *              molecule that contains all its atoms.
+ */
+double
+topology::bound_radius(int type){
+    return radii[type];
+}
+
+/**
+ * @param t1        the first molecule type.
+ * @param t2        the second molecule type.
+ * @param cut_off   the largest atom distance with an interaction.
+ * @return          the center to center distance beyond which two molecules
+ *                  of these types have no interaction.
+ */
+double
+topology::pair_range(int t1, int t2, double cut_off){
+    return cut_off + extents[t1] + extents[t2];
+}
+
+/**
+ * @param t1        the first molecule type.
+ * @param t2        the second molecule type.
+ * @return          the center to center distance beyond which two molecules
+ *                  of these types can not clash.
+ */
+double
+topology::clash_range(int t1, int t2){
+    return radii[t1] + radii[t2];
 }
 
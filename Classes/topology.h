@@ -8,12 +8,32 @@
  * \class   topology topology.h
  * \brief   A class describing the structure of several molecules.
  *
+ * For each molecule type the topology also keeps the distance from the center
+ * to the furthest atom center, extent(), and the radius of the circle around
+ * all its atoms, bound_radius(). These give, for a pair of molecule types,
+ * the center to center distances beyond which they can not interact,
+ * pair_range(), or clash, clash_range(), so that distant pairs of objects can
+ * be skipped without looking at their atoms. They are found when the topology
+ * is made and must be remade with find_bounds() if the atoms are changed.
+ *
+ * find_bounds() also chooses, for each pair of molecule types, the kernels
+ * made for their numbers of atoms (see object_kernel.h) that object uses for
+ * the energy, interaction_kernel(), and the hard cores, overlap_kernel().
+ *
+ * For a force field with only hard cores the Monte Carlo steps only test for
+ * overlaps. compile_hard() then keeps, for each pair of molecule types whose
+ * second molecule has at least VECTOR_ATOMS atoms, the squared hard core
+ * distance of each pair of their atoms in one block, hard_block(), so that
+ * the vector kernel block_overlap() (see pair_kernel.h) can load them a vector
+ * at a time. The blocks are only those of the force field that made them, and
+ * are dropped by find_bounds().
  */
 
 #ifndef TOPOLOGY_H
 #define TOPOLOGY_H
 
 #include "molecule.h"
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <boost/numeric/ublas/vector.hpp>
@@ -24,6 +44,14 @@ using namespace boost::numeric::ublas;   // For vector
 #define MAX_ATOMS   16
 #define MAX_TOPO    16
 
+class object;
+class force_field;
+
+typedef double (*interaction_fn)(force_field *the_force, const object *obj1,
+                const object *obj2, double shift_x, double shift_y);
+typedef bool   (*overlap_fn)(force_field *the_force, const object *obj1,
+                const object *obj2, double shift_x, double shift_y);
+
 class topology {
 public:
     topology();				 ///< Constructor empty topology
@@ -47,6 +75,20 @@ public:
     int     write(std::ostream& dest );  ///< Write the topology to c++ ofstream.
 
     void    add_molecule( float r );     ///< Add a new molecule type to the topology circle radius r.
+    void    find_bounds();               ///< Find the extent and bounding radius of each molecule type.
+    double  extent(int type);            ///< Distance from the center to the furthest atom center.
+    double  bound_radius(int type);      ///< Radius of a circle containing all the atoms.
+    double  pair_range(int t1, int t2,
+                double cut_off );        ///< Center distance beyond which molecules t1 and t2 do not interact.
+    double  clash_range(int t1, int t2); ///< Center distance beyond which molecules t1 and t2 can not clash.
+    interaction_fn interaction_kernel(int t1, int t2
+                 );                      ///< Energy kernel for molecules t1 and t2.
+    overlap_fn overlap_kernel(int t1, int t2
+                 );                      ///< Hard core kernel for molecules t1 and t2.
+    void    compile_hard(force_field *the_force
+                 );                      ///< Make the hard core blocks for a force field.
+    const double *hard_block(int t1, int t2,
+                uint64_t stamp );        ///< Hard core block of molecules t1 and t2, or NULL.
 
     size_t  n_atom_types;                ///< Total number of different atom types.
     vector<std::string>    atom_names;   ///< Labels for the different types of atoms.
@@ -56,6 +98,13 @@ public:
 private:
     void    read_topology(std::istream& source); ///< Helper routine for reading a topology file.
     bool    check();                     ///< Helper routine verify that the topology is good.
+    std::vector<double>    extents;      ///< extent() of each molecule type.
+    std::vector<double>    radii;        ///< bound_radius() of each molecule type.
+    std::vector<interaction_fn> interaction_kernels; ///< interaction_kernel() of each pair of types.
+    std::vector<overlap_fn> overlap_kernels; ///< overlap_kernel() of each pair of types.
+    uint64_t               hard_stamp;   ///< Stamp of the force field of the blocks, 0 if none.
+    std::vector<int>       hard_offsets; ///< Start of the block of each pair of types, -1 if none.
+    std::vector<double>    hard_table;   ///< The blocks.
 
 /*  bool    check_topology();            ///< Verify all is well with the topology.
     int     len[MAX_TOPO];               ///< Number of atoms of different types. (JS 16/4)
@@ -65,5 +114,42 @@ private:
 */
 };
 
+/**
+ * @param t1    the first molecule type.
+ * @param t2    the second molecule type.
+ * @return      the kernel for the energy of two molecules of these types.
+ */
+inline interaction_fn
+topology::interaction_kernel(int t1, int t2){
+    return interaction_kernels[ t1 * n_molecules + t2 ];
+}
+
+/**
+ * @param t1    the first molecule type.
+ * @param t2    the second molecule type.
+ * @return      the kernel testing if two molecules of these types overlap.
+ */
+inline overlap_fn
+topology::overlap_kernel(int t1, int t2){
+    return overlap_kernels[ t1 * n_molecules + t2 ];
+}
+
+/**
+ * @param t1    the first molecule type.
+ * @param t2    the second molecule type.
+ * @param stamp the stamp of the force field.
+ * @return      the squared hard core distance of atom i of t1 and atom j of
+ *              t2 at i * n2 + j, n2 the number of atoms of t2, or NULL if
+ *              there is no block for this pair and force field.
+ */
+inline const double *
+topology::hard_block(int t1, int t2, uint64_t stamp){
+    int     k;
+
+    if(( hard_stamp == 0 ) || ( hard_stamp != stamp )) return NULL;
+    k = hard_offsets[ t1 * n_molecules + t2 ];
+    return ( k < 0 ) ? NULL : &hard_table[k];
+}
+
 #endif /* TOPOLOGY_H */
 
@@ -0,0 +1,365 @@
+/**
+ * @file    trajectory.cpp
+ * @author  James Sturgis
+ * @date    October 16, 2026
+ * @brief   Implementation of the trajectory class.
+ */
+
+#include "trajectory.h"
+#include "config.h"
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define TRAJ_MAGIC      "HDTRAJ01"
+#define INDEX_MAGIC     "HDTRIDX1"
+#define TRAJ_VERSION    1
+#define FLAG_PERIODIC   1
+#define FLAG_RECTANGLE  2
+
+/**
+ * @brief Open an existing trajectory and map it in memory for reading.
+ *
+ * @param name  the file name.
+ * @throws      runtime_error if the file can not be read or is not a
+ *              trajectory.
+ */
+trajectory::trajectory(std::string name){
+    int         fd;
+    struct stat info;
+    void        *map;
+
+    dest   = NULL;
+    base   = NULL;
+    length = 0;
+    if(( fd = open( name.c_str(), O_RDONLY )) < 0 )
+        throw std::runtime_error("Could not open trajectory file " + name + "\n");
+    if(( fstat( fd, &info ) != 0 ) || ( info.st_size < 8 )){
+        ::close( fd );
+        throw std::runtime_error("Could not read trajectory file " + name + "\n");
+    }
+    length = info.st_size;
+    map = mmap( NULL, length, PROT_READ, MAP_PRIVATE, fd, 0 );
+    ::close( fd );
+    if( map == MAP_FAILED )
+        throw std::runtime_error("Could not map trajectory file " + name + "\n");
+    base = (const char *)map;
+    try {
+        read_header();
+    }
+    catch(...){
+        munmap( (void *)base, length );
+        base = NULL;
+        throw;
+    }
+}
+
+/**
+ * @brief Create a trajectory file for a configuration.
+ *
+ * The boundary and the objects of the configuration are written in the
+ * header, all the frames must have the same objects.
+ *
+ * @param name      the file name, an existing file is replaced.
+ * @param a_config  the configuration.
+ * @param topo_name the topology file used with the configuration.
+ * @throws          runtime_error if the file can not be written.
+ */
+trajectory::trajectory(std::string name, config *a_config, std::string topo_name){
+    base          = NULL;
+    length        = 0;
+    topology_name = topo_name;
+    if(( dest = fopen( name.c_str(), "wb" )) == NULL )
+        throw std::runtime_error("Could not create trajectory file " + name + "\n");
+    write_header( a_config );
+}
+
+/**
+ * @brief Open an existing trajectory to add frames after its first n_keep
+ * frames.
+ *
+ * The frames after these and the index are removed from the file, the index
+ * is written again by close().
+ *
+ * @param name      the file name.
+ * @param n_keep    the number of frames to keep.
+ * @throws          runtime_error if the file can not be read or written or
+ *                  has fewer than n_keep frames.
+ */
+trajectory::trajectory(std::string name, long n_keep) : trajectory( name ){
+    size_t  end;
+
+    if(( n_keep < 0 ) || ( n_keep > n_frames() ))
+        throw std::runtime_error("Trajectory file " + name + " has too few frames\n");
+    steps.resize( n_keep );
+    offsets.resize( n_keep );
+    end = header_size + n_keep * frame_size();
+    munmap( (void *)base, length );
+    base   = NULL;
+    length = 0;
+    if(( truncate( name.c_str(), end ) != 0 ) ||
+       (( dest = fopen( name.c_str(), "r+b" )) == NULL ))
+        throw std::runtime_error("Could not write trajectory file " + name + "\n");
+    if( fseek( dest, end, SEEK_SET ) != 0 )
+        throw std::runtime_error("Could not write trajectory file " + name + "\n");
+    buffer.assign( ( frame_size() - 8 ) / sizeof(float), 0.0f );
+}
+
+/**
+ * Destructor, closes the file, with its index if it was being written.
+ */
+trajectory::~trajectory(){
+    close();
+    if( base )
+        munmap( (void *)base, length );
+}
+
+/**
+ * @param name  a file name.
+ * @return      true if the file starts as a binary trajectory.
+ */
+bool
+trajectory::is_trajectory(std::string name){
+    char    magic[8];
+    FILE    *src = fopen( name.c_str(), "rb" );
+    bool    found;
+
+    if( src == NULL ) return false;
+    found = ( fread( magic, 1, 8, src ) == 8 ) && ( memcmp( magic, TRAJ_MAGIC, 8 ) == 0 );
+    fclose( src );
+    return found;
+}
+
+void
+trajectory::write_header(config *a_config){
+    uint32_t    word;
+    int32_t     o_type;
+    double      value;
+    Point       vertex;
+
+    n_objects    = a_config->n_objects();
+    is_periodic  = a_config->is_periodic;
+    is_rectangle = a_config->is_rectangle;
+    x_size       = a_config->x_size;
+    y_size       = a_config->y_size;
+    vertices.clear();
+    if( !is_rectangle )
+        for( int i = 0; i < a_config->poly->n_vertex; i++ ){
+            vertex = a_config->poly->get_vertex( i );
+            vertices.push_back( vertex.x );
+            vertices.push_back( vertex.y );
+        }
+    types.resize( n_objects );
+    for( int i = 0; i < n_objects; i++ )
+        types[i] = a_config->get_object( i )->o_type;
+
+    fwrite( TRAJ_MAGIC, 1, 8, dest );
+    word = TRAJ_VERSION;
+    fwrite( &word, sizeof(word), 1, dest );
+    word = ( is_periodic ? FLAG_PERIODIC : 0 ) | ( is_rectangle ? FLAG_RECTANGLE : 0 );
+    fwrite( &word, sizeof(word), 1, dest );
+    word = n_objects;
+    fwrite( &word, sizeof(word), 1, dest );
+    word = vertices.size() / 2;
+    fwrite( &word, sizeof(word), 1, dest );
+    fwrite( &x_size, sizeof(x_size), 1, dest );
+    fwrite( &y_size, sizeof(y_size), 1, dest );
+    for( size_t i = 0; i < vertices.size(); i++ ){
+        value = vertices[i];
+        fwrite( &value, sizeof(value), 1, dest );
+    }
+    word = topology_name.length();
+    fwrite( &word, sizeof(word), 1, dest );
+    fwrite( topology_name.data(), 1, word, dest );
+    for( int i = 0; i < n_objects; i++ ){
+        o_type = types[i];
+        fwrite( &o_type, sizeof(o_type), 1, dest );
+    }
+    header_size = 8 + 4 * 4 + 2 * 8 + 8 * vertices.size() + 4 + topology_name.length() + 4 * n_objects;
+    while( header_size % 8 ){
+        fputc( 0, dest );
+        header_size++;
+    }
+    buffer.assign( ( frame_size() - 8 ) / sizeof(float), 0.0f );
+    if( ferror( dest ))
+        throw std::runtime_error("Error writing the trajectory header\n");
+}
+
+/**
+ * Check a header and the index, or find the frames from their size if there
+ * is no index.
+ */
+void
+trajectory::read_header(){
+    size_t      at = 8;
+    uint32_t    word, flags, n_vertex;
+    int32_t     o_type;
+    int64_t     value, n, index;
+
+    auto get = [&]( void *to, size_t size ){
+        if( at + size > length )
+            throw std::runtime_error("Trajectory file is truncated\n");
+        memcpy( to, base + at, size );
+        at += size;
+    };
+
+    if( memcmp( base, TRAJ_MAGIC, 8 ) != 0 )
+        throw std::runtime_error("Not a trajectory file\n");
+    get( &word, sizeof(word) );
+    if( word != TRAJ_VERSION )
+        throw std::runtime_error("Unknown trajectory file version\n");
+    get( &flags, sizeof(flags) );
+    is_periodic  = flags & FLAG_PERIODIC;
+    is_rectangle = flags & FLAG_RECTANGLE;
+    get( &word, sizeof(word) );
+    n_objects = word;
+    get( &n_vertex, sizeof(n_vertex) );
+    get( &x_size, sizeof(x_size) );
+    get( &y_size, sizeof(y_size) );
+    vertices.resize( 2 * n_vertex );
+    for( size_t i = 0; i < vertices.size(); i++ )
+        get( &vertices[i], sizeof(double) );
+    get( &word, sizeof(word) );
+    if( at + word > length )
+        throw std::runtime_error("Trajectory file is truncated\n");
+    topology_name.assign( base + at, word );
+    at += word;
+    types.resize( n_objects );
+    for( int i = 0; i < n_objects; i++ ){
+        get( &o_type, sizeof(o_type) );
+        types[i] = o_type;
+    }
+    header_size = ( at + 7 ) & ~(size_t)7;
+
+    steps.clear();
+    offsets.clear();
+    if(( length >= header_size + 24 ) &&
+       ( memcmp( base + length - 8, INDEX_MAGIC, 8 ) == 0 )){
+        at = length - 24;
+        get( &n, sizeof(n) );
+        get( &index, sizeof(index) );
+        if(( n >= 0 ) && ( index >= (int64_t)header_size ) &&
+           ( index + 16 * n + 24 == (int64_t)length )){
+            at = index;
+            for( int64_t k = 0; k < n; k++ ){
+                get( &value, sizeof(value) );
+                steps.push_back( value );
+                get( &value, sizeof(value) );
+                if(( value < (int64_t)header_size ) || ( value + frame_size() > (size_t)index ))
+                    throw std::runtime_error("Bad trajectory index\n");
+                offsets.push_back( value );
+            }
+            return;
+        }
+    }
+    for( at = header_size; at + frame_size() <= length; at += frame_size() ){
+        memcpy( &value, base + at, sizeof(value) );  // Unfinished file
+        steps.push_back( value );
+        offsets.push_back( at );
+    }
+}
+
+/**
+ * @return The size in bytes of each frame.
+ */
+size_t
+trajectory::frame_size(){
+    return 8 + (( 3 * n_objects + 1 ) & ~1 ) * sizeof(float);
+}
+
+/**
+ * @brief Add a frame at the end of a trajectory being written.
+ *
+ * @param a_config  the configuration, with the objects of the header.
+ * @param step      the step number of the frame.
+ * @throws          runtime_error if the objects do not match the header or
+ *                  the frame could not be written.
+ */
+void
+trajectory::write_frame(config *a_config, int64_t step){
+    object  *my_obj;
+
+    if( !dest )
+        throw std::runtime_error("The trajectory is not open for writing\n");
+    if( a_config->n_objects() != n_objects )
+        throw std::runtime_error("The number of objects in the trajectory can not change\n");
+    for( int i = 0; i < n_objects; i++ ){
+        my_obj = a_config->get_object( i );
+        if( my_obj->o_type != types[i] )
+            throw std::runtime_error("The types of the objects in the trajectory can not change\n");
+        buffer[3*i]   = my_obj->pos_x;
+        buffer[3*i+1] = my_obj->pos_y;
+        buffer[3*i+2] = my_obj->orientation;
+    }
+    fwrite( &step, sizeof(step), 1, dest );
+    fwrite( buffer.data(), sizeof(float), buffer.size(), dest );
+    if( ferror( dest ))
+        throw std::runtime_error("Error writing a trajectory frame\n");
+    steps.push_back( step );                // Only frames that are in the file
+    offsets.push_back( header_size + offsets.size() * frame_size() );
+}
+
+/**
+ * Make sure the frames written so far are in the file, so that it can be
+ * read, or continued after a checkpoint, even if close() is never called.
+ *
+ * @throws  runtime_error if the frames could not be written.
+ */
+void
+trajectory::flush(){
+    if( dest && ( fflush( dest ) != 0 ))
+        throw std::runtime_error("Error writing a trajectory frame\n");
+}
+
+/**
+ * Add the index to a trajectory being written and close the file, this does
+ * nothing for a trajectory being read.
+ */
+void
+trajectory::close(){
+    int64_t     value;
+
+    if( !dest ) return;
+    for( size_t k = 0; k < steps.size(); k++ ){
+        fwrite( &steps[k], sizeof(int64_t), 1, dest );
+        fwrite( &offsets[k], sizeof(int64_t), 1, dest );
+    }
+    value = steps.size();
+    fwrite( &value, sizeof(value), 1, dest );
+    value = header_size + steps.size() * frame_size();
+    fwrite( &value, sizeof(value), 1, dest );
+    fwrite( INDEX_MAGIC, 1, 8, dest );
+    fclose( dest );
+    dest = NULL;
+}
+
+/**
+ * @return The number of frames in the trajectory.
+ */
+long
+trajectory::n_frames(){
+    return steps.size();
+}
+
+/**
+ * @param frame the frame number, from 0.
+ * @return      the step number of the frame.
+ */
+int64_t
+trajectory::step(long frame){
+    return steps.at( frame );
+}
+
+/**
+ * @param frame the frame number, from 0, of a trajectory being read.
+ * @return      the x, y and orientation of each object, in the mapped file.
+ */
+const float *
+trajectory::frame_data(long frame){
+    if( !base )
+        throw std::runtime_error("The trajectory is not open for reading\n");
+    return (const float *)( base + offsets.at( frame ) + 8 );
+}
@@ -0,0 +1,95 @@
+/**
+ * @file    trajectory.h
+ * @author  James Sturgis
+ * @date    October 16, 2026
+ * \brief   Header file for the trajectory class.
+ *
+ * @class   trajectory trajectory.h
+ * @brief   A binary trajectory file with an index of its frames.
+ *
+ * A trajectory holds a series of frames of a configuration whose boundary,
+ * number of objects and object types do not change, as for the NVT
+ * programme. These are written once in a header and each frame then only
+ * holds the step number and the positions and orientations of the objects as
+ * floats, so all the frames have the same size. When the file is closed an
+ * index of the frames is added at the end. The file is read by mapping it in
+ * memory, so any frame can be used directly without reading the others, and
+ * without the index (if the writer stopped before closing it) the frames are
+ * found from their size.
+ *
+ * The file layout, in the byte order of the machine, is:
+ *
+ * * header: "HDTRAJ01", version, flags (1 periodic, 2 rectangle),
+ *   n_objects, n_vertex (uint32), x_size, y_size (double), the n_vertex
+ *   vertices of the polygon as x, y doubles, the length of the topology file
+ *   name (uint32) and the name, the n_objects object types (int32), padded
+ *   with zeros to a multiple of 8 bytes.
+ * * frames: step (int64), x, y, orientation of each object (float), padded
+ *   to a multiple of 8 bytes.
+ * * index: step and offset (int64) of each frame, the number of frames and
+ *   the offset of the index (int64) and "HDTRIDX1".
+ *
+ * A trajectory is opened either for writing, with a configuration that gives
+ * the header, or for reading. config has a constructor that makes the
+ * configuration of a frame. An existing trajectory can also be opened to add
+ * frames after its first n_keep frames, the later frames and the index are
+ * dropped, which is how a run restarted from a checkpoint continues its
+ * trajectory.
+ */
+
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class config;
+
+class trajectory {
+public:
+    trajectory(std::string name);   ///< Open a trajectory for reading.
+    trajectory(std::string name, config *a_config,
+               std::string topo_name
+               );                   ///< Create a trajectory for writing.
+    trajectory(std::string name, long n_keep
+               );                   ///< Continue writing after the first n_keep frames.
+    virtual ~trajectory();          ///< Close the file.
+
+    static bool is_trajectory(std::string name
+                              );    ///< Is a file a binary trajectory.
+
+    void        write_frame(config *a_config, int64_t step
+                              );    ///< Add a frame at the end.
+    void        flush();            ///< Write the buffered frames to the file.
+    void        close();            ///< Write the index and close the file.
+
+    long        n_frames();         ///< Number of frames.
+    int64_t     step(long frame);   ///< Step number of a frame.
+    const float *frame_data(long frame
+                              );    ///< x, y, orientation of each object in a frame.
+
+    int         n_objects;          ///< Objects in each frame.
+    bool        is_periodic;        ///< The configuration has periodic boundaries.
+    bool        is_rectangle;       ///< The boundary is x_size by y_size.
+    double      x_size;             ///< Width of a rectangular boundary.
+    double      y_size;             ///< Height of a rectangular boundary.
+    std::vector<double> vertices;   ///< x, y of the polygon vertices.
+    std::vector<int> types;         ///< Type of each object.
+    std::string topology_name;      ///< Topology file used for the trajectory.
+private:
+    void        write_header(config *a_config);
+    void        read_header();
+    size_t      frame_size();       ///< Bytes in each frame.
+
+    FILE        *dest;              ///< The file being written (NULL when reading).
+    std::vector<float> buffer;      ///< A frame being written.
+    const char  *base;              ///< The mapped file (NULL when writing).
+    size_t      length;             ///< Length of the mapped file.
+    size_t      header_size;        ///< Bytes before the first frame.
+    std::vector<int64_t> steps;     ///< Step of each frame.
+    std::vector<int64_t> offsets;   ///< Offset of each frame.
+};
+
+#endif /* TRAJECTORY_H */
@@ -0,0 +1,173 @@
+/**
+ * @file    verlet_list.cpp
+ * @author  James Sturgis
+ * @date    October 16, 2026
+ * @brief   Implementation of the verlet_list class.
+ */
+
+#include "verlet_list.h"
+#include "common.h"
+#include <math.h>
+
+/**
+ * @brief Constructor for an empty (stale) list.
+ *
+ * @param a_range   The largest distance at which objects interact.
+ * @param a_skin    The extra distance to include in the lists.
+ */
+verlet_list::verlet_list(double a_range, double a_skin){
+    range     = a_range;
+    skin      = a_skin;
+    stale     = true;
+    n_builds  = 0;
+    n_refresh = 0;
+    x_period  = y_period = 0.0;
+}
+
+/**
+ * Destructor for the list.
+ */
+verlet_list::~verlet_list(){
+}
+
+/**
+ * Objects that are in a list can be up to range + skin from the reference
+ * position, and so up to skin/2 further from their current position.
+ *
+ * @return The smallest cell size that will find all the neighbours.
+ */
+double
+verlet_list::cell_size(){
+    return range + 1.5 * skin;
+}
+
+/**
+ * @brief Build all the neighbour lists from the current object positions.
+ *
+ * @param objects   The objects of the configuration.
+ * @param cells     A cell list of the objects with cells at least cell_size() wide.
+ * @param x_size    Width of the configuration (for periodic conditions).
+ * @param y_size    Height of the configuration (for periodic conditions).
+ * @param periodic  Use the closest periodic images.
+ */
+void
+verlet_list::build(std::vector<object>& objects, cell_list *cells,
+        double x_size, double y_size, bool periodic){
+    int     n = objects.size();
+    int     nbr[9];
+    int     n_cells;
+
+    assert( cells->size >= cell_size() );
+    x_period = periodic ? x_size : 0.0;
+    y_period = periodic ? y_size : 0.0;
+    lists.resize( n );
+    ref_x.resize( n );
+    ref_y.resize( n );
+    for( int i = 0; i < n; i++ ){
+        ref_x[i] = objects[i].pos_x;
+        ref_y[i] = objects[i].pos_y;
+    }
+    for( int i = 0; i < n; i++ ){
+        lists[i].clear();
+        n_cells = cells->neighbour_cells( cells->cell( i ), nbr );
+        for( int k = 0; k < n_cells; k++ )
+            for( int j = cells->first( nbr[k] ); j >= 0; j = cells->next( j ))
+                if(( j != i ) && within( i, j )) lists[i].push_back( j );
+    }
+    stale = false;
+    n_builds++;
+}
+
+/**
+ * @brief Remake the list of an object that has moved too far.
+ *
+ * The current position becomes the reference position of the object, and it
+ * is removed from, or added to, the lists of the other objects as necessary
+ * so that the lists stay symmetric.
+ *
+ * @param index     The object that has moved.
+ * @param objects   The objects of the configuration.
+ * @param cells     The up to date cell list of the objects.
+ */
+void
+verlet_list::refresh(int index, std::vector<object>& objects, cell_list *cells){
+    int     nbr[9];
+    int     n_cells;
+
+    assert( !stale );
+    assert( cells->size >= cell_size() );
+    for( size_t k = 0; k < lists[index].size(); k++ )
+        remove( lists[index][k], index );
+    lists[index].clear();
+    ref_x[index] = objects[index].pos_x;
+    ref_y[index] = objects[index].pos_y;
+    n_cells = cells->neighbour_cells( cells->cell( index ), nbr );
+    for( int k = 0; k < n_cells; k++ )
+        for( int j = cells->first( nbr[k] ); j >= 0; j = cells->next( j ))
+            if(( j != index ) && within( index, j )){
+                lists[index].push_back( j );
+                lists[j].push_back( index );
+            }
+    n_refresh++;
+}
+
+/**
+ * @param index The object number.
+ * @param x     A position for the object.
+ * @param y     A position for the object.
+ * @return      true if x, y is further than skin/2 from the reference
+ *              position of the object.
+ */
+bool
+verlet_list::moved_too_far(int index, double x, double y){
+    double  dx = x - ref_x[index];
+    double  dy = y - ref_y[index];
+
+    if( x_period > 0.0 ){                   // Wrapping is not a displacement
+        dx -= x_period * floor( dx / x_period + 0.5 );
+        dy -= y_period * floor( dy / y_period + 0.5 );
+    }
+    return ( 4.0 * ( dx*dx + dy*dy ) > skin * skin );
+}
+
+/**
+ * @param index The object number.
+ * @return      The number of neighbours in the list of the object.
+ */
+int
+verlet_list::n_neighbours(int index){
+    return lists[index].size();
+}
+
+/**
+ * @param index The object number.
+ * @return      A pointer to the first neighbour in the list of the object.
+ */
+int *
+verlet_list::neighbours(int index){
+    return lists[index].data();
+}
+
+bool
+verlet_list::within(int i, int j){
+    double  dx = ref_x[j] - ref_x[i];
+    double  dy = ref_y[j] - ref_y[i];
+
+    if( x_period > 0.0 ){
+        dx -= x_period * floor( dx / x_period + 0.5 );
+        dy -= y_period * floor( dy / y_period + 0.5 );
+    }
+    return ( dx*dx + dy*dy < ( range + skin ) * ( range + skin ));
+}
+
+void
+verlet_list::remove(int index, int other){
+    std::vector<int>    &a_list = lists[index];
+
+    for( size_t k = 0; k < a_list.size(); k++ )
+        if( a_list[k] == other ){
+            a_list[k] = a_list.back();      // Order is not important
+            a_list.pop_back();
+            return;
+        }
+}
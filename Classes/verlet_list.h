@@ -0,0 +1,67 @@
+/**
+ * @file    verlet_list.h
+ * @author  James Sturgis
+ * @date    October 16, 2026
+ * \brief   Header file for the verlet_list class.
+ *
+ * @class   verlet_list verlet_list.h
+ * @brief   Lists of the neighbours of each object, with a skin.
+ *
+ * A Verlet list holds for each object the other objects whose reference
+ * positions are closer than range + skin. The reference position of an object
+ * is where it was when its list was last made. As long as no object is more
+ * than skin/2 from its reference position every pair of objects closer than
+ * range is in the lists, and these can be used in place of a search through
+ * the cells.
+ *
+ * In a Monte Carlo simulation objects move one at a time, so when an object
+ * has moved too far, see moved_too_far(), only its own list is remade by
+ * refresh() and it is added to or removed from the lists of the objects
+ * around it. The whole list is only built when the configuration changes as
+ * a whole. Both are counted so that the skin can be tuned.
+ *
+ * The cell list used to find the neighbours must have cells at least
+ * range + 1.5 skin wide, cell_size() gives this value.
+ */
+
+#ifndef VERLET_LIST_H
+#define VERLET_LIST_H
+
+#include <vector>
+#include "object.h"
+#include "cell_list.h"
+
+class verlet_list {
+public:
+    verlet_list(double range, double skin); ///< Constructor for an empty list.
+    virtual ~verlet_list();                 ///< Destructor
+
+    void    build(std::vector<object>& objects,
+                cell_list *cells,
+                double x_size, double y_size,
+                bool periodic );            ///< Rebuild all the lists.
+    void    refresh(int index,
+                std::vector<object>& objects,
+                cell_list *cells );         ///< Remake the list of an object at its current position.
+    bool    moved_too_far(int index,
+                double x, double y );       ///< Is x, y more than skin/2 from the reference position of index.
+    double  cell_size();                    ///< Smallest cell size that can be used.
+    int     n_neighbours(int index);        ///< Number of neighbours of object index.
+    int     *neighbours(int index);         ///< The neighbours of object index.
+
+    double  range;                          ///< Interaction range the list was built for.
+    double  skin;                           ///< Extra distance included in the list.
+    bool    stale;                          ///< Set when the list must be rebuilt before use.
+    int     n_builds;                       ///< Number of times the whole list has been built.
+    int     n_refresh;                      ///< Number of times the list of a single object was remade.
+private:
+    bool    within(int i, int j);           ///< Are the reference positions of i and j within range + skin.
+    void    remove(int index, int other);   ///< Take other out of the list of index.
+
+    std::vector< std::vector<int> > lists;  ///< The neighbours of each object.
+    std::vector<double> ref_x;              ///< Reference position of each object.
+    std::vector<double> ref_y;
+    double  x_period, y_period;             ///< Periods, zero if not periodic.
+};
+
+#endif /* VERLET_LIST_H */
@@ -21,7 +21,9 @@
  * To use the program the command line is:
  *
  *      NVT [-vp][-t topology][-f forcefield][-o final_config][-c initial_config]
- *          [-l log_file] n_steps print_frequency beta pressure
+ *          [-l log_file][-k skin][-j threads][-d][-e length][-S seed][-b]
+ *          [-C checkpoint][-w check_freq][-r checkpoint]
+ *          [-M metrics_file][-i interval] n_steps print_frequency beta pressure
  *
  * Where the various parameters are:
  *      n_steps         The number of simulation steps to make.
@@ -49,6 +51,72 @@
  *      -n frame_freq	The frequency to save frames to the trajectory file.
  *
  *      -s traj_file	Optional file for logging the trajectory a gzipped format.
+ *                      The frames, and the reports to the log, are formatted
+ *                      and written by a background thread (see frame_writer).
+ *                      If the trajectory can not be written the error is
+ *                      logged and the run stops, writing the final
+ *                      configuration, and ends with EXIT_FAILURE.
+ *
+ *      -b              Write the trajectory in the indexed binary format of the
+ *                      trajectory class rather than as gzipped text.
+ *
+ *      -k skin         Use Verlet neighbour lists that include objects up to
+ *                      skin further than the interaction range. The number of
+ *                      times the lists are rebuilt or updated is reported in
+ *                      the log to help choose the skin.
+ *
+ *      -j threads      Number of threads used for full energy calculations
+ *                      (0 for one per core, default 1).
+ *
+ *      -d              Integrate by parallel sweeps over a checkerboard of
+ *                      domains, n_steps, print_frequency and frame_freq then
+ *                      count sweeps (each tries every object once).
+ *
+ *      -e length       Integrate hard discs in a periodic box by event chains
+ *                      of this length, n_steps, print_frequency and frame_freq
+ *                      then count chains.
+ *
+ *      -S seed         Seed for the random numbers, by default one is taken
+ *                      from the clock. The seed is given in the log and a run
+ *                      with the same seed and parameters is identical, whatever
+ *                      the number of threads.
+ *
+ *      -C checkpoint   Write checkpoints to this file, when the programme is
+ *                      stopped by SIGTERM or can not write the trajectory,
+ *                      and every check_freq steps. The run
+ *                      then stops after the step, sweep or chain under way,
+ *                      with the trajectory and log complete, and writes the
+ *                      final configuration as usual.
+ *
+ *      -w check_freq   The number of steps between checkpoints (with -C).
+ *
+ *      -r checkpoint   Continue the run saved in a checkpoint, up to n_steps
+ *                      in all. The configuration, topology, force field,
+ *                      integrator, random numbers and periodic conditions are
+ *                      those of the checkpoint, -c, -t, -f, -p and -S are
+ *                      ignored, the other options must be those of the first
+ *                      run. The log and trajectory are continued and the run
+ *                      is the same as if it had not stopped. After a SIGTERM
+ *                      between checkpoints only the order in which the
+ *                      neighbour energies are added up may differ.
+ *
+ *      -M metrics_file The file for the metrics of the run, rewritten as it
+ *                      goes in the Prometheus text format (see metrics), with
+ *                      the steps made and per second, the moves accepted and
+ *                      tried (in all and since dl_max was adjusted),
+ *                      dl_max, the energy, the wall time, the expected time
+ *                      left, the memory used and the size of the trajectory.
+ *                      The values are labelled with the run, the file name
+ *                      without directory and extension.
+ *
+ *      -i interval     The shortest time between writes of the metrics file
+ *                      in seconds (default 60). It is also written from
+ *                      inside the blocks of steps, so print_frequency does
+ *                      not matter.
+ *
+ * When built with PROFILE defined a summary of the time spent in each phase
+ * of the steps of the main loop, and what was counted, ends the log (see
+ * profile.h).
  *
  * \todo log file       Use a dedicated function for writing data so it is easier
  *                      to parse after and control the structure.  Perhaps in
@@ -59,7 +127,14 @@
 #include <cstdlib>
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <chrono>
+#include <csignal>
 #include "../Classes/integrator.h"
+#include "../Classes/frame_writer.h"
+#include "../Classes/checkpoint.h"
+#include "../Classes/profile.h"
+#include "../Classes/metrics.h"
 #include "../Classes/common.h"
 
 #include "../Libraries/gzstream.h"
@@ -79,11 +154,44 @@ using namespace std;
                     exit(EXIT_FAILURE); \
                 }
 
+static volatile sig_atomic_t stop_requested = 0;   // Set by SIGTERM
+
+static void
+request_stop(int signal_number){
+    stop_requested = 1;
+}
+
+/*
+ * Keep the first n_frames frames of a gzipped text trajectory and open it to
+ * add more. gzip files can not be truncated so the frames are copied to a new
+ * file, the old one is kept as name.old if this fails.
+ */
+static bool
+continue_text_trajectory(const string& name, long n_frames, ogzstream& dest){
+    string      old_name = name + ".old";
+    string      line;
+    long        n = 0;
+
+    if( rename( name.c_str(), old_name.c_str() ) != 0 ) return false;
+    igzstream   source( old_name.c_str() );
+    dest.open( name.c_str() );
+    if( !source.good() || !dest.good() ) return false;
+    while( getline( source, line )){
+        if(( line.compare( 0, 4, "====" ) == 0 ) && ( n++ == n_frames )) break;
+        dest << line << "\n";
+    }
+    if( n < n_frames ) return false;
+    source.close();
+    remove( old_name.c_str() );
+    return true;
+}
 
 void 
 usage(int val){
     std::cerr << "NVT [-vp][-t topology][-f forcefield][-o final_config][-c initial_config]"
-        << "[-l log_file] [-n save-frequency] [-s save_file] n_steps print_frequency beta pressure \n";
+        << "[-l log_file] [-n save-frequency] [-s save_file] [-k skin] [-j threads] [-d] [-e length] [-S seed] [-b] "
+        << "[-C checkpoint] [-w check_freq] [-r checkpoint] [-M metrics_file] [-i interval] "
+        << "n_steps print_frequency beta pressure \n";
     exit(val);
 }
 
@@ -99,6 +207,9 @@ int main(int argc, char** argv) {
     string       log_name;
     string       topo_name;
     string	 traj_name;
+    string       check_name;            // Checkpoints written
+    string       resume_name;           // Checkpoint continued
+    string       metrics_name;          // Metrics of the run
 
     // Objects in headers
     config      *current_state = NULL;
@@ -107,32 +218,43 @@ int main(int argc, char** argv) {
     force_field *the_forces = NULL; 
     integrator  *the_integrator = NULL;
     topology    *a_topology = NULL;
+    checkpoint  *the_checkpoint = NULL;
 
     int         N1;
     double      U1, V1;
-    int         i, step;
+    int         i, step, made;
     int         c;
     bool	verbose  = false;
     bool	periodic = false;
+    bool	sweeps   = false;		// Parallel checkerboard sweeps
+    bool	binary   = false;		// Binary trajectory
 
     int         it_max = 0;
     int         n_print = 0;
     int		traj_freq = 0;		// Frequency for saving frames to trajectory (0=never)
+    int         check_freq = 0;         // Frequency for checkpoints (0=only on SIGTERM)
+    long        n_frames = 0;           // Frames written to the trajectory
+    bool        writer_failed = false;  // The trajectory could not be written
     double      beta = 1.0;
     double      dl_max = 1.0;
     double      pressure = 1.0;
-
-    // Initialization
-
-    srand((long)&argv[0]);
+    double      skin = 0.0;             // Verlet list skin (0 = no lists)
+    int         n_threads = 1;          // Threads for full energy calculations
+    double      chain_length = 0.0;     // Event chain length (0 = no chains)
+    double      run_time = 0.0;         // Seconds spent integrating
+    double      metrics_interval = 60.0;  // Seconds between metrics files
+    auto        wall_start = std::chrono::steady_clock::now();
+    uint64_t    seed = rnd_clock_seed();  // Seed for the random numbers
 
     // Handle command line
-    while( ( c = getopt (argc, argv, "vpc:f:t:o:l:n:s:") ) != -1 )
+    while( ( c = getopt (argc, argv, "vpdbc:f:t:o:l:n:s:k:j:e:S:C:w:r:M:i:") ) != -1 )
     {
         switch(c)
         {
             case 'v': verbose  = true; break;
             case 'p': periodic = true; break;
+            case 'd': sweeps   = true; break;
+            case 'b': binary   = true; break;
             case 'c': if (optarg) in_name = optarg;
                 break;
             case 'l': if (optarg) log_name = optarg;
@@ -147,11 +269,32 @@ int main(int argc, char** argv) {
                 break;
             case 's': if (optarg) traj_name = optarg;
                 break;
+            case 'k': if (optarg) skin = std::atof(optarg);
+                break;
+            case 'j': if (optarg) n_threads = std::atoi(optarg);
+                break;
+            case 'e': if (optarg) chain_length = std::atof(optarg);
+                break;
+            case 'S': if (optarg) seed = std::strtoull(optarg, NULL, 0);
+                break;
+            case 'C': if (optarg) check_name = optarg;
+                break;
+            case 'w': if (optarg) check_freq = std::atoi(optarg);
+                break;
+            case 'r': if (optarg) resume_name = optarg;
+                break;
+            case 'M': if (optarg) metrics_name = optarg;
+                break;
+            case 'i': if (optarg) metrics_interval = std::atof(optarg);
+                break;
             case 'h': usage(EXIT_SUCCESS);
             case '?':				// Something wrong.
                 if (optopt == 'c' or optopt == 'f' or optopt == 't' or 
                     optopt == 'o' or optopt == 'l' or optopt == 'n' or
-                    optopt == 's' ){
+                    optopt == 's' or optopt == 'k' or
+                    optopt == 'j' or optopt == 'e' or optopt == 'S' or
+                    optopt == 'C' or optopt == 'w' or optopt == 'r' or
+                    optopt == 'M' or optopt == 'i' ){
                     std::cerr << "The -" << optopt << " option is missing a parameter!\n";
                 } else {
                     std::cerr << "Unknown option " << optopt << "!\n";
@@ -164,12 +307,30 @@ int main(int argc, char** argv) {
     std::ofstream log_file;
     #define logger ((log_file.is_open())? log_file : std::cout )
     if( log_name.length() > 0 ){
-       log_file.open( log_name, std::ofstream::out );
+       log_file.open( log_name, std::ofstream::out |
+                      (( resume_name.length() > 0 ) ? std::ofstream::app : std::ofstream::trunc ));
     }
 
     if( verbose ) logger << "Verbose flag set\n";
     if(( log_name.length() > 0 ) && verbose ) logger << "opened " << log_name << "as logfile.";
 
+    if( resume_name.length() > 0 ){
+        try{
+            the_checkpoint = new checkpoint( resume_name );
+        }
+        catch( exception &e ){
+            std::cerr << e.what() << "Error reading checkpoint aborting.\n";
+            exit( EXIT_FAILURE );
+        }
+        seed = the_checkpoint->seed;
+        logger << "Continuing from " << resume_name << " after "
+               << the_checkpoint->step << " steps\n";
+    } else {
+        the_checkpoint = new checkpoint();
+    }
+    rnd_seed( seed );
+    logger << "Random seed " << seed << "\n";
+
     if(( argc - optind ) != 4 ){	        // Check enough parameters
         std::cerr << "Not right number of parameters!\n";
         usage(EXIT_FAILURE);
@@ -199,7 +360,10 @@ int main(int argc, char** argv) {
 
     if( verbose ) logger << "Reading configuration.\n";
     try{
-        if( in_name.length() > 0 ){
+        if( resume_name.length() > 0 ){
+            current_state = new config();
+            current_state->read( the_checkpoint );
+        } else if( in_name.length() > 0 ){
             current_state = new config(in_name);
         } else {
             current_state = new config(std::cin);
@@ -213,7 +377,7 @@ int main(int argc, char** argv) {
     if( verbose ) logger << "Read configuration successfully.\n";
 
     // Load the force field from the force field file
-    if( force_name.length() == 0 ){
+    if(( force_name.length() == 0 ) && ( resume_name.length() == 0 )){
         std::cerr << "Error the force field file was required but was not declared. Aborting.\n";
         if( current_state ) delete current_state;
         exit( EXIT_FAILURE );
@@ -221,7 +385,13 @@ int main(int argc, char** argv) {
 
     if( verbose ) logger << "Reading force field from " << force_name << ".\n";
     try{
-        the_forces = new force_field(force_name.c_str());
+        if( resume_name.length() > 0 ){
+            the_forces = the_checkpoint->make_forces();
+        } else {
+            the_forces = new force_field(force_name.c_str());
+            if( check_name.length() > 0 )
+                the_checkpoint->force_text = checkpoint::file_text( force_name );
+        }
     }
     catch(...){
         std::cerr << "Error reading force field. Aborting.\n";
@@ -236,7 +406,7 @@ int main(int argc, char** argv) {
         logger << "==============================\n";
     }
     // Load the topology from the topology file
-    if( topo_name.length() == 0 ){
+    if(( topo_name.length() == 0 ) && ( resume_name.length() == 0 )){
         std::cerr << "Error the topology file is required but was not declared. Aborting.\n";
         delete current_state;
         delete the_forces;
@@ -245,7 +415,13 @@ int main(int argc, char** argv) {
 
     if( verbose ) logger << "Reading topology from" << topo_name << ".\n";
     try{
-        a_topology = new topology(topo_name.c_str());
+        if( resume_name.length() > 0 ){
+            a_topology = the_checkpoint->make_topology();
+        } else {
+            a_topology = new topology(topo_name.c_str());
+            if( check_name.length() > 0 )
+                the_checkpoint->topology_text = checkpoint::file_text( topo_name );
+        }
     }
     catch(...){
         logger << "Error reading topology. Aborting.\n";
@@ -263,6 +439,7 @@ int main(int argc, char** argv) {
 
     // Setup to save trajectory
     ogzstream	traj_stream;
+    trajectory	*binary_traj = NULL;
 
     if( traj_freq > 0 ){
         if( traj_name.length() == 0 ){
@@ -273,8 +450,23 @@ int main(int argc, char** argv) {
             exit( EXIT_FAILURE );
         }
         logger << "Snap shots saved every " << traj_freq << " steps\n";
-        traj_stream.open( traj_name.c_str() );
-        if( ! traj_stream.good() ){
+        if( binary ){
+            try{
+                if( resume_name.length() > 0 )     // Drop frames after the checkpoint
+                    binary_traj = new trajectory( traj_name, the_checkpoint->n_frames );
+                else
+                    binary_traj = new trajectory( traj_name, current_state, topo_name );
+            }
+            catch(...){
+                binary_traj = NULL;
+            }
+        } else if( resume_name.length() > 0 ){
+            if( !continue_text_trajectory( traj_name, the_checkpoint->n_frames, traj_stream ))
+                traj_stream.setstate( std::ios::failbit );
+        } else {
+            traj_stream.open( traj_name.c_str() );
+        }
+        if( binary ? ( binary_traj == NULL ) : ! traj_stream.good() ){
             std::cerr << "Error while opening file " << traj_name << " for the trajectory.\n";
             delete current_state;
             delete the_forces;
@@ -288,10 +480,29 @@ int main(int argc, char** argv) {
         traj_freq = it_max + 1;					// Don't want a trajectory
     }
 
+    // Setup for checkpoints
+    if( check_name.length() > 0 ){
+        if( check_freq > 0 )
+            logger << "Checkpoints written to " << check_name << " every " << check_freq << " steps\n";
+        else
+            check_freq = it_max + 1;				// Only when stopped
+        signal( SIGTERM, request_stop );
+    } else if( check_freq > 0 ){
+        std::cerr << "You must specify a file name for the checkpoints (-C option)\n";
+        delete current_state;
+        delete the_forces;
+        delete a_topology;
+        exit( EXIT_FAILURE );
+    } else {
+        check_freq = it_max + 1;				// Don't want checkpoints
+    }
+
     // Add the topology to the configuration.
     current_state->add_topology(a_topology);
 
-    if( current_state->is_rectangle ){
+    if( resume_name.length() > 0 ){
+        // The boundary conditions are those of the checkpoint
+    } else if( current_state->is_rectangle ){
         current_state->is_periodic = periodic;
     } else if( periodic ){					/// TODO convert parallelogram to rectangle
         if( current_state->poly->is_parallelogram() ){
@@ -304,12 +515,18 @@ int main(int argc, char** argv) {
         }
     }
     
+    current_state->set_threads( n_threads );
+    if( skin > 0.0 ){
+        current_state->use_verlet( skin );
+        if( verbose ) logger << "Using Verlet lists with skin " << skin << "\n";
+    }
+
     U1 = current_state->energy(the_forces);
     V1 = current_state->area();
     N1 = current_state->n_objects();
 
     // Print report of state, both in terminal and log
-    logger << "After" << std::to_string( 0 ) << " steps...\n";
+    logger << "After" << std::to_string( the_checkpoint->step ) << " steps...\n";
     logger << format("N objects = %9d Pressure = %9g   Beta = %9g\n") % N1 % pressure % beta;
     logger << format("Area      = %9g  Density = %9g Energy = %9g\n\n") % V1 % (N1/V1) % U1;
 
@@ -325,7 +542,7 @@ int main(int argc, char** argv) {
     
     i = 0;
 
-    while(U1 > the_forces->big_energy){
+    while(( U1 > the_forces->big_energy ) && ( resume_name.length() == 0 )){
         if( the_integrator ) delete the_integrator;
         if( i > 2000*N1 ){
             delete the_forces;
@@ -356,54 +573,235 @@ int main(int argc, char** argv) {
         logger << format("Area      = %9g  Density = %9g Energy = %9g\n\n") % V1 % (N1/V1) % U1;
     }
 
+    // Frames and reports are written by a background thread
+    frame_writer *writer = new frame_writer( current_state,
+            ( binary_traj || ( traj_freq > it_max )) ? NULL : &traj_stream, binary_traj );
+    std::ostringstream report;
+
+    // After an error writing the trajectory the run stops, once the reports
+    // still queued are written, with a last checkpoint that only counts the
+    // frames that are in the file.
+    auto trajectory_error = [&]( exception &e ){
+        std::cerr << e.what();
+        try{
+            writer->flush();
+        }
+        catch( exception & ){}				// The same error
+        n_frames     -= writer->n_lost;
+        writer_failed = true;
+        logger << "Error writing the trajectory after " << i << " steps\n";
+    };
+
     // Start NVT montecarlo loop
     // Calculate next step size...
     step = simple_min(n_print,it_max);
     step = simple_min(step, traj_freq);
+    step = simple_min(step, check_freq);
     the_integrator = new integrator(the_forces);
     the_integrator->dl_max = dl_max;
+    the_integrator->stop_on( &stop_requested );     // Only set with -C
+    i = 0;
+    if( resume_name.length() > 0 ){			// Carry on from the checkpoint
+        the_checkpoint->restore( the_integrator );
+        i        = the_checkpoint->step;
+        n_frames = the_checkpoint->n_frames;
+        step = simple_min(it_max-i+1,(n_print - (i%n_print)));
+        step = simple_min(step,(traj_freq - (i%traj_freq)));
+        step = simple_min(step,(check_freq - (i%check_freq)));
+    }
 
     if( verbose ){
         logger << "With" << (current_state->is_periodic?" ":"out ") << "periodic boundary conditions.\n";
         logger << "Boundary is " << (current_state->is_rectangle ? "rectangle" : "polygon") << "\n";
+        if( sweeps ) logger << "Steps are checkerboard sweeps\n";
+        if( chain_length > 0.0 ) logger << "Steps are event chains of length " << chain_length << "\n";
         logger << "Starting iteration loop\n";
     }
 
-    for(i=0;i<it_max;){
+    // The metrics file, rewritten every metrics_interval seconds
+    metrics     *the_metrics = NULL;
+    int         metrics_step = i;                       // Steps at the last write
+    double      rate = 0.0;                             // Steps per second since then
+    auto        metrics_time = std::chrono::steady_clock::now();
+    auto write_metrics = [&]( int steps, bool finished ){
+        auto    now = std::chrono::steady_clock::now();
+        double  seconds = std::chrono::duration<double>( now - metrics_time ).count();
+
+        if(( steps > metrics_step ) && ( seconds > 0.0 ))  // Otherwise keep the last rate
+            rate = ( steps - metrics_step ) / seconds;
+
+        the_metrics->counter( "hard_discs_nvt_steps_total", "Steps made.", steps );
+        the_metrics->gauge( "hard_discs_nvt_steps_target", "Steps to make.", it_max );
+        the_metrics->gauge( "hard_discs_nvt_steps_per_second",
+                "Steps per second over the last interval.", rate );
+        the_metrics->counter( "hard_discs_nvt_moves_accepted_total",
+                "Moves accepted since the start of the run.", the_integrator->accepted() );
+        the_metrics->counter( "hard_discs_nvt_moves_tried_total",
+                "Moves tried since the start of the run.", the_integrator->tried() );
+        the_metrics->gauge( "hard_discs_nvt_moves_accepted",
+                "Moves accepted since dl_max was last adjusted.", the_integrator->n_good );
+        the_metrics->gauge( "hard_discs_nvt_moves_tried",
+                "Moves tried since dl_max was last adjusted.",
+                the_integrator->n_good + the_integrator->n_bad );
+        the_metrics->gauge( "hard_discs_nvt_dl_max", "Scale of the moves.", the_integrator->dl_max );
+        the_metrics->gauge( "hard_discs_nvt_energy",
+                "Energy of the configuration at the end of the last block of steps.", U1 );
+        the_metrics->gauge( "hard_discs_nvt_wall_seconds", "Seconds since the programme started.",
+                std::chrono::duration<double>( now - wall_start ).count() );
+        the_metrics->gauge( "hard_discs_nvt_eta_seconds",
+                "Seconds left at the current rate, -1 if unknown.",
+                ( rate > 0.0 ) ? ( it_max - steps ) / rate : ( finished ? 0.0 : -1.0 ));
+        the_metrics->gauge( "hard_discs_nvt_resident_memory_bytes",
+                "Resident memory of the programme.", metrics::resident_bytes() );
+        the_metrics->gauge( "hard_discs_nvt_trajectory_bytes",
+                "Size of the trajectory file.", metrics::file_bytes( traj_name ));
+        the_metrics->gauge( "hard_discs_nvt_last_update_timestamp_seconds",
+                "Unix time of this update.",
+                std::chrono::duration<double>( std::chrono::system_clock::now().time_since_epoch() ).count() );
+        the_metrics->gauge( "hard_discs_nvt_finished", "1 once the run has stopped.", finished ? 1 : 0 );
+        try{
+            the_metrics->write();
+        }
+        catch( exception &e ){
+            std::cerr << e.what();
+        }
+        if( steps > metrics_step ){
+            metrics_step = steps;
+            metrics_time = now;
+        }
+    };
+    auto metrics_due = [&](){
+        return std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - metrics_time ).count() >= metrics_interval;
+    };
+    if( metrics_name.length() > 0 ){
+        string  run_name = metrics_name.substr( metrics_name.find_last_of( '/' ) + 1 );
+        the_metrics = new metrics( metrics_name, run_name.substr( 0, run_name.find( '.' )));
+        if( verbose )
+            logger << "Metrics written to " << metrics_name << " every " << metrics_interval << " s\n";
+        write_metrics( i, false );
+        // Also from inside the blocks of steps, which are not cut short so
+        // that the run does not depend on the interval.
+        the_integrator->on_progress( [&]( int made ){
+            if( metrics_due() ) write_metrics( i + made, false );
+        });
+    }
+    profile_reset();                                    // Only the main loop
+
+    for(;i<it_max;){
 
         state_h = &current_state;
-        the_integrator->run(state_h, beta, pressure, step);
+        auto start = std::chrono::steady_clock::now();
+        if( chain_length > 0.0 )            // Fewer than step if stopped
+            made = the_integrator->chains(state_h, beta, pressure, step, chain_length);
+        else if( sweeps )
+            made = the_integrator->sweep(state_h, beta, pressure, step);
+        else
+            made = the_integrator->run(state_h, beta, pressure, step);
+        run_time += std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
         current_state = *state_h;
 
         U1 = current_state->energy(the_forces);
         V1 = current_state->area();
         N1 = current_state->n_objects();
 
-        i += step;
+        i += made;
 
         if( i%n_print == 0 ){				// Is it time to print to the log file
-            logger << format("After %d steps N = %d, P = %g, beta = %g\n") 
+            report.str("");
+            report << format("After %d steps N = %d, P = %g, beta = %g\n") 
                 % i % N1 % pressure % beta;
-            logger << format("Area = %g, Density = %g Energy = %g\n") 
+            report << format("Area = %g, Density = %g Energy = %g\n") 
                 % V1 % (N1/V1) % U1;
-            logger << format("Moves %d in %d, Dist_max = %g\n\n") 
+            report << format("Moves %d in %d, Dist_max = %g\n\n") 
                 % (the_integrator->n_good)
                 % (the_integrator->n_good + the_integrator->n_bad)
                 % (the_integrator->dl_max);
+            if( skin > 0.0 )
+                report << format("Verlet lists built %d times, %d object updates (%g per step)\n\n")
+                    % current_state->verlet_builds()
+                    % current_state->verlet_updates()
+                    % ((double)current_state->verlet_updates() / i);
+            if( chain_length > 0.0 )
+                report << format("Event chains made %d collisions (%g per second)\n\n")
+                    % the_integrator->n_events
+                    % ( run_time > 0.0 ? the_integrator->n_events / run_time : 0.0 );
+            writer->write_log( &logger, report.str() );
         }
         if( i%traj_freq == 0 ){				// Is it time to print to the trajectory
-            traj_stream << "====" << i << "====\n";
-            current_state->write( traj_stream );
+            try{
+                writer->write_frame( current_state, i );
+                n_frames++;
+            }
+            catch( exception &e ){
+                trajectory_error( e );
+            }
+        }
+        if( check_name.length() > 0 ){
+            if(( i%check_freq == 0 ) || stop_requested || writer_failed ){	// Is it time for a checkpoint
+                // A continued run starts with new cell lists, so make new
+                // ones here too so that the neighbours are then found in
+                // the same order whether or not the run stops here.
+                current_state->drop_cells();
+                if( !writer_failed ){
+                    try{
+                        writer->flush();		// The trajectory is complete
+                    }
+                    catch( exception &e ){
+                        trajectory_error( e );
+                    }
+                }
+                try{
+                    the_checkpoint->save( current_state, the_integrator );
+                    the_checkpoint->step     = i;
+                    the_checkpoint->n_frames = n_frames;
+                    the_checkpoint->write( check_name );
+                }
+                catch( exception &e ){
+                    std::cerr << e.what();
+                    logger << "Error writing the checkpoint after " << i << " steps\n";
+                }
+            }
+        }
+        if( the_metrics && metrics_due() )
+            write_metrics( i, false );
+        if( stop_requested || writer_failed ){
+            logger << "Stopped after " << i << " steps";
+            if( check_name.length() > 0 ) logger << ", continue with -r " << check_name;
+            logger << "\n";
+            break;
         }
         
         step = simple_min(it_max-i+1,(n_print - (i%n_print)));
         step = simple_min(step,(traj_freq - (i%traj_freq)));
+        step = simple_min(step,(check_freq - (i%check_freq)));
     }
-    delete the_integrator;
+    if( !writer_failed ){
+        try{
+            writer->flush();				// Writes what is still queued
+        }
+        catch( exception &e ){
+            trajectory_error( e );
+        }
+    }
+    if( verbose )
+        logger << "Snap shots waited for the writer " << writer->n_waits << " times\n";
+    if( profile_enabled() )
+        profile_write( logger );
+    delete writer;
     
     if( traj_stream.good() ){				// If we are writing a trajectory
         traj_stream.close();				// Close the file
     }
+    if( binary_traj ){
+        binary_traj->close();				// Adds the index
+        delete binary_traj;
+    }
+    if( the_metrics ){                                  // With the final trajectory size
+        write_metrics( i, true );
+        delete the_metrics;
+    }
+    delete the_integrator;
  
     if( verbose ) logger << "Writing final configuration.\n";
     if( out_name.length() > 0 ){
@@ -417,11 +815,12 @@ int main(int argc, char** argv) {
 
     delete current_state;
     delete the_forces;
+    delete the_checkpoint;
 
     logger << "\n...Done...\n";
 
     // And close the log and output
     if( log_name.length() > 0 ){log_file.close();}
 
-    return 0;
+    return writer_failed ? EXIT_FAILURE : EXIT_SUCCESS;
 }
@@ -0,0 +1,434 @@
+/**
+ * \file    RENVT.cpp
+ * \author  James Sturgis
+ * \date    October 16, 2026
+ * \version 1.0
+ * \brief   Run a replica exchange (parallel tempering) NVT simulation.
+ *
+ * This file contains the main routine for the RENVT program that is part of
+ * the Very Coarse Grained disc simulation programmes.
+ *
+ * The programme loads a configuration and makes n_replicas copies of it, each
+ * integrated in the NVT ensemble, exactly as by the NVT programme, at one of
+ * a geometric ladder of beta values from beta_min to beta_max. The replicas
+ * are integrated at the same time on a pool of threads. Every exchange_freq
+ * steps swaps of the configurations at neighbouring temperatures i and j are
+ * attempted, alternately for the even and the odd pairs, and accepted with the
+ * probability min(1, e^((beta_i - beta_j)(U_i - U_j))) so that each
+ * temperature keeps its Boltzmann distribution. The acceptance of the swaps
+ * of each pair is reported in the log, a low value means that the betas of
+ * the pair are too far apart.
+ *
+ * Each beta of the ladder has its own random number stream, and the swaps use
+ * the main stream, so a run is fully defined by its seed whatever the number
+ * of threads.
+ *
+ * To use the program the command line is:
+ *
+ *      RENVT [-vp][-t topology][-f forcefield][-o final_prefix][-c initial_config]
+ *            [-l log_file][-n frame_freq][-s traj_prefix][-k skin][-j threads]
+ *            [-x exchange_freq][-S seed] n_steps print_frequency beta_min
+ *            beta_max n_replicas pressure
+ *
+ * Where the various parameters are:
+ *      n_steps         The number of simulation steps to make for each replica.
+ *      print_frequency The number of steps between reports to the log file
+ *                      of how the integration is progressing.
+ *      beta_min        The smallest (highest temperature) beta of the ladder.
+ *      beta_max        The largest (lowest temperature) beta of the ladder.
+ *      n_replicas      The number of replicas, at least 2.
+ *      pressure        The pressure (this is not used but is for compatibility
+ *                      with other ensembles such as NPT or the Gibbs ensemble).
+ *
+ *      -t topology     The topology file to use for the integration (required).
+ *      -f forcefield   The forcefield file to use for the integration (required).
+ *      -c initial_config The starting configuration, if none is given the
+ *                      stdin will be read.
+ *      -o final_prefix The final configuration at the k'th beta of the
+ *                      ladder is written to final_prefix.k, if none is given
+ *                      the configuration at beta_max is written to stdout.
+ *      -l log_file     Optional file for logging output.
+ *      -n frame_freq   The frequency to save frames to the trajectories.
+ *      -s traj_prefix  The trajectory at the k'th beta is saved, gzipped, to
+ *                      traj_prefix.k.gz.
+ *      -k skin         Use Verlet neighbour lists in each replica.
+ *      -j threads      Number of threads (0 for one per core, the default),
+ *                      there is no use in more than n_replicas.
+ *      -x exchange_freq Number of steps between swap attempts (default 1000).
+ *      -S seed         Seed for the random numbers, by default one is taken
+ *                      from the clock. The seed is given in the log.
+ */
+
+#include <cstdlib>
+#include <cmath>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include "../Classes/integrator.h"
+#include "../Classes/thread_pool.h"
+#include "../Classes/common.h"
+
+#include "../Libraries/gzstream.h"
+
+#include <boost/format.hpp>
+
+using boost::format;
+
+using namespace std;
+
+
+#define fatal_error(format, value) {\
+                    fprintf(stderr, format, value ); \
+                    exit(EXIT_FAILURE); \
+                }
+
+
+void
+usage(int val){
+    std::cerr << "RENVT [-vp][-t topology][-f forcefield][-o final_prefix][-c initial_config]"
+        << "[-l log_file] [-n save-frequency] [-s save_prefix] [-k skin] [-j threads] [-x exchange_freq] [-S seed] "
+        << "n_steps print_frequency beta_min beta_max n_replicas pressure \n";
+    exit(val);
+}
+
+/*
+ *
+ */
+int main(int argc, char** argv) {
+
+    string       in_name;
+    string       out_name;
+    string       force_name;
+    string       log_name;
+    string       topo_name;
+    string       traj_name;
+
+    config      *initial_state = NULL;
+    force_field *the_forces = NULL;
+    topology    *a_topology = NULL;
+    thread_pool *the_pool = NULL;
+
+    int         N1;
+    double      V1;
+    int         i, k, step;
+    int         c;
+    bool        verbose  = false;
+    bool        periodic = false;
+
+    int         it_max = 0;
+    int         n_print = 0;
+    int         traj_freq = 0;          // Frequency for saving frames to trajectory (0=never)
+    int         exch_freq = 1000;       // Steps between swap attempts
+    int         n_replicas = 0;
+    int         n_exchange = 0;         // Number of swap rounds made
+    double      beta_min = 1.0;
+    double      beta_max = 1.0;
+    double      dl_max = 1.0;
+    double      pressure = 1.0;
+    double      skin = 0.0;             // Verlet list skin (0 = no lists)
+    int         n_threads = 0;          // Threads for the replicas
+    uint64_t    seed = rnd_clock_seed();  // Seed for the random numbers
+
+    // Handle command line
+    while( ( c = getopt (argc, argv, "vpc:f:t:o:l:n:s:k:j:x:S:") ) != -1 )
+    {
+        switch(c)
+        {
+            case 'v': verbose  = true; break;
+            case 'p': periodic = true; break;
+            case 'c': if (optarg) in_name = optarg;
+                break;
+            case 'l': if (optarg) log_name = optarg;
+                break;
+            case 'f': if (optarg) force_name = optarg;
+                break;
+            case 't': if (optarg) topo_name = optarg;
+                break;
+            case 'o': if (optarg) out_name = optarg;
+                break;
+            case 'n': if (optarg) traj_freq = std::atoi(optarg);
+                break;
+            case 's': if (optarg) traj_name = optarg;
+                break;
+            case 'k': if (optarg) skin = std::atof(optarg);
+                break;
+            case 'j': if (optarg) n_threads = std::atoi(optarg);
+                break;
+            case 'x': if (optarg) exch_freq = std::atoi(optarg);
+                break;
+            case 'S': if (optarg) seed = std::strtoull(optarg, NULL, 0);
+                break;
+            case 'h': usage(EXIT_SUCCESS);
+            case '?':                           // Something wrong.
+                if (optopt == 'c' or optopt == 'f' or optopt == 't' or
+                    optopt == 'o' or optopt == 'l' or optopt == 'n' or
+                    optopt == 's' or optopt == 'k' or optopt == 'j' or
+                    optopt == 'x' or optopt == 'S' ){
+                    std::cerr << "The -" << optopt << " option is missing a parameter!\n";
+                } else {
+                    std::cerr << "Unknown option " << optopt << "!\n";
+                }
+            default :                           // Something very wrong.
+                usage(EXIT_FAILURE);
+        }
+    }
+
+    std::ofstream log_file;
+    #define logger ((log_file.is_open())? log_file : std::cout )
+    if( log_name.length() > 0 ){
+       log_file.open( log_name, std::ofstream::out );
+    }
+
+    if( verbose ) logger << "Verbose flag set\n";
+
+    rnd_seed( seed );
+    logger << "Random seed " << seed << "\n";
+
+    if(( argc - optind ) != 6 ){            // Check enough parameters
+        std::cerr << "Not right number of parameters!\n";
+        usage(EXIT_FAILURE);
+    }
+
+    it_max     = std::atoi( argv[ optind++ ] );
+    n_print    = std::atoi( argv[ optind++ ] );
+    beta_min   = std::atof( argv[ optind++ ] );
+    beta_max   = std::atof( argv[ optind++ ] );
+    n_replicas = std::atoi( argv[ optind++ ] );
+    pressure   = std::atof( argv[ optind++ ] );
+
+    if(it_max <= 0 ){
+        std::cerr << "Nothing to do, number of steps invalid.\n";
+        usage(EXIT_FAILURE);
+    }
+    if(n_print <= 0 ){
+        std::cerr << "Negative or zero print frequency invalid.\n";
+        usage(EXIT_FAILURE);
+    }
+    if( exch_freq <= 0 ){
+        std::cerr << "Negative or zero exchange frequency invalid.\n";
+        usage(EXIT_FAILURE);
+    }
+    if(( beta_min <= 0 ) || ( beta_max < beta_min )){
+        std::cerr << "Invalid temperature range.\n";
+        usage(EXIT_FAILURE);
+    }
+    if( n_replicas < 2 ){
+        std::cerr << "At least 2 replicas are needed.\n";
+        usage(EXIT_FAILURE);
+    }
+    if( pressure < 0 ){
+        std::cerr << "Negative pressure invalid.\n";
+        usage(EXIT_FAILURE);
+    }
+
+    if( verbose ) logger << "Reading configuration.\n";
+    try{
+        if( in_name.length() > 0 ){
+            initial_state = new config(in_name);
+        } else {
+            initial_state = new config(std::cin);
+        }
+    }
+    catch(...){
+        std::cerr << "Error reading configuration aborting.\n";
+        if( initial_state ) delete initial_state;
+        exit( EXIT_FAILURE );
+    }
+
+    if( force_name.length() == 0 ){
+        std::cerr << "Error the force field file was required but was not declared. Aborting.\n";
+        delete initial_state;
+        exit( EXIT_FAILURE );
+    }
+    try{
+        the_forces = new force_field(force_name.c_str());
+    }
+    catch(...){
+        std::cerr << "Error reading force field. Aborting.\n";
+        delete initial_state;
+        if( the_forces ) delete the_forces;
+        exit( EXIT_FAILURE );
+    }
+
+    if( topo_name.length() == 0 ){
+        std::cerr << "Error the topology file is required but was not declared. Aborting.\n";
+        delete initial_state;
+        delete the_forces;
+        exit( EXIT_FAILURE );
+    }
+    try{
+        a_topology = new topology(topo_name.c_str());
+    }
+    catch(...){
+        logger << "Error reading topology. Aborting.\n";
+        delete initial_state;
+        delete the_forces;
+        if( a_topology ) delete a_topology;
+        exit( EXIT_FAILURE );
+    }
+    if( verbose ) logger << "Read configuration, force field and topology successfully.\n";
+
+    initial_state->add_topology(a_topology);
+
+    if( initial_state->is_rectangle ){
+        initial_state->is_periodic = periodic;
+    } else if( periodic ){
+        if( initial_state->poly->is_parallelogram() ){
+            if( initial_state->poly_2_rect() ){
+                initial_state->is_periodic = periodic;
+            }
+        }
+        if( ! initial_state->is_rectangle ){
+            std::cerr << "Periodic conditions for non-rectangular configurations not supported - ignoring flag\n";
+        }
+    }
+    if( skin > 0.0 ) initial_state->use_verlet( skin );
+
+    // The replicas, the k'th is at the k'th beta of the ladder
+    std::vector<double>      beta( n_replicas );
+    std::vector<double>      U( n_replicas );
+    std::vector<config *>    states( n_replicas );
+    std::vector<integrator *> integrators( n_replicas );
+    std::vector<int>         n_tried( n_replicas, 0 );  // Swaps of pair k, k+1
+    std::vector<int>         n_swapped( n_replicas, 0 );
+    std::vector<ogzstream *> traj_streams( n_replicas, (ogzstream *)NULL );
+    std::vector<random_stream> streams( n_replicas ); // Stream 0 is for the swaps
+
+    N1 = initial_state->n_objects();
+    V1 = initial_state->area();
+    dl_max = simple_min(initial_state->width(), initial_state->height())/2.0;
+    for( k = 0; k < n_replicas; k++ ){
+        beta[k]        = beta_min * pow( beta_max / beta_min, (double)k / ( n_replicas - 1 ));
+        states[k]      = new config( initial_state );
+        integrators[k] = new integrator( the_forces );
+        integrators[k]->dl_max = dl_max;
+        streams[k].set( seed, k + 1 );
+    }
+    delete initial_state;
+
+    if( traj_freq > 0 ){
+        if( traj_name.length() == 0 ){
+            std::cerr << "You must specify a prefix for saving the trajectories (-s option)\n";
+            exit( EXIT_FAILURE );
+        }
+        logger << "Snap shots saved every " << traj_freq << " steps\n";
+        for( k = 0; k < n_replicas; k++ ){
+            traj_streams[k] = new ogzstream( ( traj_name + "." + std::to_string( k ) + ".gz" ).c_str() );
+            if( ! traj_streams[k]->good() ){
+                std::cerr << "Error while opening the trajectory files " << traj_name << ".\n";
+                exit( EXIT_FAILURE );
+            }
+        }
+    } else {
+        traj_freq = it_max + 1;             // Don't want a trajectory
+    }
+
+    if( n_threads <= 0 ) n_threads = thread_pool::hardware_threads();
+    the_pool = new thread_pool( simple_min( n_threads, n_replicas ));
+    if( verbose ) logger << "Using " << the_pool->n_threads << " threads.\n";
+
+    // Remove bad contacts from save/load in each replica
+    the_pool->run( n_replicas, [&]( int task, int thread ){
+        int     n_jiggle = 0;
+        config  **state_h = &states[task];
+
+        rnd_use( &streams[task] );
+        while( states[task]->energy( the_forces ) > the_forces->big_energy ){
+            if( n_jiggle > 2000*N1 ) break;
+            integrators[task]->run( state_h, beta[task], pressure, 2*N1 );
+            n_jiggle += 2*N1;
+        }
+        U[task] = states[task]->energy( the_forces );
+        rnd_use( NULL );
+    });
+    for( k = 0; k < n_replicas; k++ )
+        if( U[k] > the_forces->big_energy ){
+            delete the_forces;
+            fatal_error("Unable to adjust initial configuration of replica %d\n", k );
+        }
+
+    logger << "After initial adjustments:\n";
+    logger << format("N objects = %9d Pressure = %9g Area = %9g Density = %9g\n") % N1 % pressure % V1 % (N1/V1);
+    for( k = 0; k < n_replicas; k++ )
+        logger << format("Replica %d beta = %g Energy = %g\n") % k % beta[k] % U[k];
+    logger << "\n";
+
+    // Start replica exchange loop
+    for( i = 0; i < it_max; ){
+        step = simple_min( it_max - i, n_print - ( i % n_print ));
+        step = simple_min( step, traj_freq - ( i % traj_freq ));
+        step = simple_min( step, exch_freq - ( i % exch_freq ));
+
+        the_pool->run( n_replicas, [&]( int task, int thread ){
+            rnd_use( &streams[task] );
+            integrators[task]->run( &states[task], beta[task], pressure, step );
+            U[task] = states[task]->energy( the_forces );
+            rnd_use( NULL );
+        });
+        i += step;
+
+        if( i % exch_freq == 0 ){           // Swap neighbouring temperatures
+            for( k = n_exchange % 2; k + 1 < n_replicas; k += 2 ){
+                n_tried[k]++;
+                if( rnd_lin(1.0) <= exp(( beta[k] - beta[k+1] ) * ( U[k] - U[k+1] ))){
+                    std::swap( states[k], states[k+1] );
+                    std::swap( U[k], U[k+1] );
+                    n_swapped[k]++;
+                }
+            }
+            n_exchange++;
+        }
+
+        if( i % n_print == 0 ){             // Is it time to print to the log file
+            logger << format("After %d steps N = %d, P = %g, Area = %g, Density = %g\n")
+                % i % N1 % pressure % V1 % (N1/V1);
+            for( k = 0; k < n_replicas; k++ )
+                logger << format("Replica %d beta = %g Energy = %g Moves %d in %d, Dist_max = %g\n")
+                    % k % beta[k] % U[k]
+                    % (integrators[k]->n_good)
+                    % (integrators[k]->n_good + integrators[k]->n_bad)
+                    % (integrators[k]->dl_max);
+            for( k = 0; k + 1 < n_replicas; k++ )
+                logger << format("Swaps %d-%d accepted %d in %d (%g)\n")
+                    % k % (k+1) % n_swapped[k] % n_tried[k]
+                    % ( n_tried[k] ? (double)n_swapped[k] / n_tried[k] : 0.0 );
+            logger << "\n";
+        }
+        if( i % traj_freq == 0 ){           // Is it time to print to the trajectories
+            for( k = 0; k < n_replicas; k++ ){
+                *traj_streams[k] << "====" << i << "====\n";
+                states[k]->write( *traj_streams[k] );
+            }
+        }
+    }
+    delete the_pool;
+
+    for( k = 0; k < n_replicas; k++ ){
+        if( traj_streams[k] ){
+            traj_streams[k]->close();
+            delete traj_streams[k];
+        }
+        delete integrators[k];
+    }
+
+    if( verbose ) logger << "Writing final configurations.\n";
+    if( out_name.length() > 0 ){
+        for( k = 0; k < n_replicas; k++ ){
+            std::ofstream out_file( out_name + "." + std::to_string( k ));
+            states[k]->write(out_file);
+            out_file.close();
+        }
+    } else {
+        states[n_replicas-1]->write(std::cout);
+    }
+
+    for( k = 0; k < n_replicas; k++ )
+        delete states[k];
+    delete the_forces;
+
+    logger << "\n...Done...\n";
+
+    if( log_name.length() > 0 ){log_file.close();}
+
+    return 0;
+}
@@ -13,31 +13,358 @@
  * that is those with rectangular or polygonal boundaries, those with
  * periodic boundary conditions or not.
  *
- * Input can be in the form of either a series of configurations or
- * a compressed trajectory file.
+ * Input can be in the form of either a series of configurations,
+ * compressed trajectory files or binary trajectory files (which are
+ * recognised whatever the -z flag).
+ *
+ * The maps are flat arrays and each object only touches the bins it
+ * contributes to. Each thread fills its own maps with a frame, then the bins
+ * the frame touched are added to the totals in frame order, so the output for
+ * a seed is the same whatever the number of threads. With -m only the center
+ * of the map, out to max_dx in x and max_dy in y, is kept.
  *
  * TODO Stop error condition on normal end of file
  */
 
 #include "../Classes/config.h"
+#include "../Classes/frame_reader.h"
+#include <algorithm>
 #include <iostream>
+#include <map>
+#include <mutex>
 #include "../Libraries/gzstream.h"
 
+/***
+ * @brief What the analysis of each frame needs, fixed by the first frame.
+ *
+ * The bins are those of the full map, n_full wide and high, that covers
+ * every distance in the first frame. Only the central bin_xmax by bin_ymax
+ * of them, out to the largest distances asked for, are kept, starting at bin
+ * offset_x in x and offset_y in y of the full map. They reach out to reach_x
+ * from the center in x and reach_y in y, so the points further than
+ * sqrt(reach_x^2+reach_y^2) fall outside the map whatever the orientation of
+ * the central object.
+ */
+struct order_setup {
+	int		type1, type2;		// Types of the central and surrounding objects
+	int		rotation;			// Symmetry for the orientations
+	double	dist;				// Bin size
+	double	r_max;				// Largest distance in the first frame
+	int		n_full;				// Bins across the full map
+	int		offset_x, offset_y;	// First bin kept in x and y
+	int		bin_xmax, bin_ymax;	// Number of bins kept
+	double	reach_x, reach_y;	// Largest distance in x and y of the kept bins
+	uint64_t seed;				// Seed of the random numbers
+};
+
+/***
+ * @brief The maps of the frame analysed by a thread, or the totals, each is a
+ * flat array of bin_xmax by bin_ymax bins.
+ */
+struct order_sums {
+	std::vector<double>	e_array;	// Expected numbers, without periodic conditions
+	std::vector<double>	n_array;	// Numbers found
+	std::vector<double>	dx_array;	// Sums of the relative orientations
+	std::vector<double>	dy_array;
+	double				n_periodic;	// Objects expected spread as for periodic conditions
+	std::vector<int>	hits;		// Bins hit by the points sampled around an object
+	std::vector<int>	touched;	// Bins touched by the frame
+	std::vector<char>	is_touched;
+};
+
+/***
+ * @brief The bins touched by a frame and what it added to them, waiting to
+ * be added to the totals in frame order.
+ */
+struct order_frame {
+	std::vector<int>	bins;
+	std::vector<double>	values;		// e, n, dx and dy of each bin
+	double				n_periodic;
+};
+
+/***
+ * @brief The totals and the frames finished before those preceding them.
+ */
+struct order_totals {
+	order_sums					sums;
+	std::map<long, order_frame>	waiting;	// By frame number
+	long						next;		// Number of the next frame to add
+	std::mutex					lock;
+};
+
+/***
+ * @brief Clear the maps.
+ */
+void
+new_sums(order_sums *sums, const order_setup& setup)
+{
+	int		n_bins = setup.bin_xmax * setup.bin_ymax;
+
+	sums->e_array.assign( n_bins, 0.0 );
+	sums->n_array.assign( n_bins, 0.0 );
+	sums->dx_array.assign( n_bins, 0.0 );
+	sums->dy_array.assign( n_bins, 0.0 );
+	sums->n_periodic = 0.0;
+	sums->touched.clear();
+	sums->is_touched.assign( n_bins, 0 );
+}
+
+/***
+ * @brief Note that the frame adds to bin b.
+ */
+inline void
+touch(order_sums *sums, int b)
+{
+	if( !sums->is_touched[b] ){
+		sums->is_touched[b] = 1;
+		sums->touched.push_back( b );
+	}
+}
+
+/***
+ * @brief Add the frame analysed in sums to the totals once the frames before
+ * it have been added, and clear the bins it touched in sums.
+ */
+void
+end_frame(order_sums *sums, long number, order_totals *totals)
+{
+	order_frame	frame;
+
+	frame.bins.swap( sums->touched );
+	frame.values.resize( 4 * frame.bins.size() );
+	for(size_t k=0; k < frame.bins.size(); k++){
+		int b = frame.bins[k];
+		frame.values[4*k]   = sums->e_array[b];
+		frame.values[4*k+1] = sums->n_array[b];
+		frame.values[4*k+2] = sums->dx_array[b];
+		frame.values[4*k+3] = sums->dy_array[b];
+		sums->e_array[b] = sums->n_array[b] = sums->dx_array[b] = sums->dy_array[b] = 0.0;
+		sums->is_touched[b] = 0;
+	}
+	frame.n_periodic = sums->n_periodic;
+	sums->n_periodic = 0.0;
+
+	std::lock_guard<std::mutex> guard( totals->lock );
+	totals->waiting[number] = std::move( frame );
+	while( !totals->waiting.empty() && ( totals->waiting.begin()->first == totals->next )){
+		order_frame& first = totals->waiting.begin()->second;
+		for(size_t k=0; k < first.bins.size(); k++){
+			int b = first.bins[k];
+			totals->sums.e_array[b]  += first.values[4*k];
+			totals->sums.n_array[b]  += first.values[4*k+1];
+			totals->sums.dx_array[b] += first.values[4*k+2];
+			totals->sums.dy_array[b] += first.values[4*k+3];
+		}
+		totals->sums.n_periodic += first.n_periodic;
+		totals->waiting.erase( totals->waiting.begin() );
+		totals->next++;
+	}
+}
+
+/***
+ * @brief The bin, of the n_bins kept from offset, at a distance d from the
+ * center, or -1 if it is not kept.
+ */
+inline int
+map_bin(const order_setup& setup, double d, int offset, int n_bins)
+{
+	int		bin = floor( setup.n_full * (setup.r_max+d+setup.dist/2.0)/(2.0*setup.r_max));
+
+	bin -= offset;
+	return (( bin >= 0 ) && ( bin < n_bins )) ? bin : -1;
+}
+
+/***
+ * @brief The distance from the center of the lower edge of bin, of the full
+ * map, the inverse of map_bin().
+ */
+inline double
+map_edge(const order_setup& setup, int bin)
+{
+	return bin * 2.0 * setup.r_max / setup.n_full - setup.r_max - setup.dist/2.0;
+}
+
+/***
+ * @brief The largest distance from the center of the n_bins bins of the full
+ * map kept from offset.
+ */
+inline double
+map_reach(const order_setup& setup, int offset, int n_bins)
+{
+	return std::max( fabs( map_edge( setup, offset )),
+	                 fabs( map_edge( setup, offset + n_bins )));
+}
+
+/***
+ * @brief Fraction of an object expected in bin k, l of the full map with
+ * periodic conditions.
+ */
+double
+periodic_de(const order_setup& setup, int k, int l)
+{
+	double	de = (1.00/((setup.n_full-1.00)*(setup.n_full-1.00)));
+
+	if(k == 0)                 de /= 2.0;
+	if(l == 0)                 de /= 2.0;
+	if(k == (setup.n_full-1))  de /= 2.0;
+	if(l == (setup.n_full-1))  de /= 2.0;
+	return de;
+}
+
+/***
+ * @brief Add the organisation around the objects of one configuration to sums.
+ *
+ * Only the bins that are hit are touched. With periodic conditions the
+ * expected numbers are the same around every object, so only their number
+ * is counted and the map is added at the end. Otherwise the fraction of the
+ * area in each bin around an object is estimated from random points and only
+ * the bins they hit are incremented. The points are drawn in the window of
+ * half width sqrt(reach_x^2+reach_y^2) around the object, clipped to the
+ * bounding box, which holds every point that can fall in the map, at the same density as
+ * over the whole configuration. The random numbers for frame number come
+ * from stream number of the seed, so the results do not depend on which
+ * thread analyses the frame.
+ */
+void
+add_config(config *a_config, long number, const order_setup& setup, order_sums *sums)
+{
+	random_stream	generator( setup.seed, number );
+	int		bin_x, bin_y;
+	int		bin_ymax = setup.bin_ymax;
+	double	dist     = setup.dist;
+	double	theta;
+	double	window   = hypot( setup.reach_x, setup.reach_y );
+	int		n_type2  = 0;
+
+	for(int j = 0; j < a_config->n_objects(); j++ )
+		if(a_config->get_object(j)->o_type == setup.type2 ) n_type2++;
+	rnd_use( &generator );
+    	for(int i = 0; i < a_config->n_objects(); i++ ){
+    		if(a_config->get_object(i)->o_type == setup.type1 ){
+    			// Expected numbers around this object
+    			if(a_config->is_periodic){
+    				sums->n_periodic += n_type2;
+    			} else {
+					bool is_inside;
+					double x, y;
+					double x0 = 0.0, y0 = 0.0;
+					if(!a_config->is_rectangle){
+						x0 = a_config->poly->x_min();
+						y0 = a_config->poly->y_min();
+					}
+					// Window around the object clipped to the bounding box
+					double x_lo = std::max( a_config->get_object(i)->pos_x - window, x0 );
+					double y_lo = std::max( a_config->get_object(i)->pos_y - window, y0 );
+					double x_hi = std::min( a_config->get_object(i)->pos_x + window, x0 + a_config->width() );
+					double y_hi = std::min( a_config->get_object(i)->pos_y + window, y0 + a_config->height() );
+					double w_x  = std::max( x_hi - x_lo, 0.0 );
+					double w_y  = std::max( y_hi - y_lo, 0.0 );
+					sums->hits.clear();
+					{
+    					int n_tries = (w_x/dist)*(w_y/dist);		// Maximum number of bins
+    					n_tries *= 1000;							// Factor determining precision
+    					for(int k=0; k<n_tries; k++){
+    						x = x_lo + rnd_lin(w_x);
+    						y = y_lo + rnd_lin(w_y);
+    						if(a_config->is_rectangle){
+    							is_inside = true;
+    						} else {
+    							is_inside = a_config->poly->is_inside(x,y);
+    						}
+    						if(is_inside){
+	    						// Calculate bin number.    					
+    							double dx = a_config->get_object(i)->pos_x - x;
+    							double dy = a_config->get_object(i)->pos_y - y;
+	    						theta = atan2(dy, dx);
+    							theta += a_config->get_object(i)->orientation;
+    							double r = sqrt(dx*dx+dy*dy);
+    							dx = r * sin(theta);
+    							dy = r * cos(theta);
+
+    							bin_x = map_bin( setup, dx, setup.offset_x, setup.bin_xmax );
+    							bin_y = map_bin( setup, dy, setup.offset_y, bin_ymax );
+    							if(( bin_x >= 0 ) && ( bin_y >= 0 ))
+    								sums->hits.push_back( bin_x * bin_ymax + bin_y );
+    						}
+    					}
+    					// Each point stands for w_x*w_y/n_tries of the area
+    					if(( n_tries > 0 ) && ( a_config->area() > 0.0 )){
+    						double weight = n_type2 * ( w_x * w_y / n_tries ) / a_config->area();
+    						for(size_t k=0; k < sums->hits.size(); k++){
+    							touch( sums, sums->hits[k] );
+    							sums->e_array[ sums->hits[k] ] += weight;
+    						}
+    					}
+    				}
+    			}
+    			for(int j = 0; j < a_config->n_objects(); j++ ){
+    				if(a_config->get_object(j)->o_type == setup.type2 ){
+   					
+    					// Calculate bin number.    					
+    					double dx = a_config->get_object(j)->pos_x - a_config->get_object(i)->pos_x;
+    					double dy = a_config->get_object(j)->pos_y - a_config->get_object(i)->pos_y;
+    					
+    					// If necessary adjust for closest image.
+    					if(a_config->is_periodic){
+    						if( dx >  a_config->width() /2.0 ) dx -= a_config->width() /2.0; 
+    						if( dy >  a_config->height()/2.0 ) dy -= a_config->height()/2.0; 
+    						if( dx < -a_config->width() /2.0 ) dx += a_config->width() /2.0; 
+    						if( dy < -a_config->height()/2.0 ) dy += a_config->height()/2.0; 
+    					}
+    					
+    					theta = atan2(dy, dx);
+    					theta += a_config->get_object(i)->orientation;
+    					double r = sqrt(dx*dx+dy*dy);
+    					dx = r * sin(theta);
+    					dy = r * cos(theta);
+
+    					bin_x = map_bin( setup, dx, setup.offset_x, setup.bin_xmax );
+    					bin_y = map_bin( setup, dy, setup.offset_y, bin_ymax );
+    					if(( bin_x < 0 ) || ( bin_y < 0 )) continue;	// Outside the map
+    					// Increment arrays of n
+    					touch( sums, bin_x * bin_ymax + bin_y );
+    					sums->n_array[ bin_x * bin_ymax + bin_y ] += 1.0;
+    					// Calculate relative orientation dx, dy including symmetry rotation #
+    					theta = a_config->get_object(i)->orientation - a_config->get_object(j)->orientation;
+    					theta *= setup.rotation;
+    					
+    					// Increment dx, dy arrays
+    					sums->dx_array[ bin_x * bin_ymax + bin_y ] += sin(theta);
+    					sums->dy_array[ bin_x * bin_ymax + bin_y ] += cos(theta);
+    				}
+    			}
+    		}
+    	}
+	rnd_use( NULL );
+}
+
+/***
+ * @brief Open a compressed trajectory for the frame_reader.
+ */
+std::istream *
+open_compressed(const std::string& name)
+{
+	return new igzstream( name.c_str() );
+}
+
 /***
  * @brief usage() Print a brief help message on program utilisation to std::cerr.
  */
 void
 usage()
 {
-    std::cerr << "Usage: 2DOrder [-v] [-z] [-o output] [-d dist] [-r rotation][-t type1] [-u type2] file1...\n" ;
+    std::cerr << "Usage: 2DOrder [-v] [-z] [-o output] [-d dist] [-m max_dx[,max_dy]] [-r rotation][-t type1] [-u type2] [-S seed] [-j threads] file1...\n" ;
     std::cerr << "-v verbose output to stderr,\n" 
         << "-z the input files are compressed trajectory files,\n"
         << "-o output send output to file output (default stdout),\n" 
         << "-d dist set the integration bin size to dist (default 1.0),\n" 
+        << "-m max_dx[,max_dy] only map the organization out to max_dx in x and max_dy in y, max_dy is max_dx if not given (default the whole configuration),\n" 
         << "-r rotation, symmetry to apply for organization of orientation (default 1),\n "
         << "-t type1 look at distances between objects of this type and type2 (default 0),\n" 
         << "-u type2 look at distances between objects of this type and type1 (default 0),\n" 
-        << "file1... series of configuration or trajectory files to read, if none are given use stdin.\n" ;
+        << "-S seed for the random numbers used for the edge corrections (default from the clock),\n"
+        << "-j threads number of threads analysing frames (0 for one per core, the default),\n"
+        << "file1... series of configuration or trajectory files to read, binary trajectories are recognised, if none are given use stdin.\n" ;
 }
 
 /***
@@ -48,24 +375,35 @@ main( int argc, char **argv )
 {
 	// Initialize program control variables
 	double	dist 		= 1.0;
+	double	max_dx		= 0.0;
+	double	max_dy		= 0.0;
 	int		rotation 	= 1;
 	char	*out_name	= (char *)NULL;
 	int		type1		= 0;
 	int		type2		= 0;
 	bool	verbose		= false;
-	bool	trajectory	= false;
+	bool	compressed	= false;
+	uint64_t seed		= rnd_clock_seed();
+	int		n_threads	= 0;
 	char	c;
 	
     // Getopt based argument handling.
-    while( ( c = getopt (argc, argv, "vhzo:d:r:t:u:") ) != -1 )
+    while( ( c = getopt (argc, argv, "vhzo:d:m:r:t:u:S:j:") ) != -1 )
     {
         switch(c)
         {
             case 'v': verbose = true; break;
-            case 'z': trajectory = true; break;
+            case 'z': compressed = true; break;
             case 'd':				// rotational symmetry parameter
                 if (optarg) dist = atof(optarg);
                 break;            
+            case 'm':				// Extent of the map in x and y
+                if (optarg){
+                    char *end;
+                    max_dx = max_dy = strtod(optarg, &end);
+                    if( *end == ',' ) max_dy = atof(end + 1);
+                }
+                break;            
             case 'r':				// rotational symmetry parameter
                 if (optarg) rotation = atoi(optarg);
                 break;            
@@ -78,11 +416,17 @@ main( int argc, char **argv )
             case 'u':				// type 2 object (default 0)
                 if (optarg) type2 = atoi(optarg);
                 break;
+            case 'S':				// Seed for the random numbers
+                if (optarg) seed = strtoull(optarg, NULL, 0);
+                break;
+            case 'j':				// Threads (default one per core)
+                if (optarg) n_threads = atoi(optarg);
+                break;
             case 'h':
                 usage();
                 exit(EXIT_SUCCESS);
             case '?':				// Something wrong.
-                if (optopt == 'o' or optopt == 'r' or optopt == 'd' or optopt == 't' or optopt == 'u'){
+                if (optopt == 'o' or optopt == 'r' or optopt == 'd' or optopt == 'm' or optopt == 't' or optopt == 'u' or optopt == 'S' or optopt == 'j'){
                     std::cerr << "The -" << optopt << " option is missing a parameter!\n";
                 } else {
                     std::cerr << "Unknown option " << optopt << "!\n";
@@ -92,259 +436,107 @@ main( int argc, char **argv )
                 exit(EXIT_FAILURE);
         }
     }
+    if( n_threads <= 0 ) n_threads = thread_pool::hardware_threads();
     
     if( verbose ){
          std::cerr << "The verbose flag is set.\n"
-                   << "Reading " << (trajectory?"":"un") << "compressed trajectories.\n"
+                   << "Reading " << (compressed?"":"un") << "compressed trajectories.\n"
                    << "Step size is " << dist << ".\n"
+                   << "Map extent is " << max_dx << " by " << max_dy << " (0 for all).\n"
                    << "Rotational parameter is " << rotation << ".\n"
                    << "First object type is  " << type1 << ".\n"
                    << "Second object type is " << type2 << ".\n"
+                   << "Random seed is " << seed << ".\n"
+                   << "Using " << n_threads << " threads.\n"
                    << "Sending output to " << ((out_name)?out_name:"str::cout");
          std::cerr << ".\n";
     }
     
-    // TODO Should seed random number generator somewhere here.
-
-    // Read in the first configuration
+    // Read in the first configuration, the reader thread then reads ahead.
 
-    igzstream	traj_stream;					// Stream for compressed trajectory
-    											// A buffer size (current separator is 9 + number)
-    #define		LINE_LENGTH		128				
-	char		line[LINE_LENGTH];				// Buffer for frame separators.	
-	config		*a_config = (config *)NULL;		// Where to find the configuration being treated.
-	
-    try{
-        if(( argc - optind ) > 0 ){	            // Read source configuration
-        	if( trajectory ){
-        		traj_stream.open( argv[ optind ] );
-				if( ! traj_stream.good()) throw(1);
-        		traj_stream.getline(line, LINE_LENGTH);		// Separator
-        		a_config = new config( traj_stream );
-    	        if( verbose )
-        	        std::cerr << "Input read " << line 
-        	            << " from " << argv[ optind ] << "\n";        		
-        	} else {
-                a_config = new config( argv[ optind ] );
-    	        if( verbose )
-        	        std::cerr << "Input read from " << argv[ optind ] << "\n";
-        	}
-            optind++;
-        } else {					
-            a_config = new config(std::cin);
-            if( verbose )
-                std::cerr << "Input read from 'stdin'\n";
-        }
-    }
-    catch(...){
-        std::cerr << "Failed to read first configuration\n"
+    frame_reader	*reader;
+    thread_pool		*pool;
+    config		*a_config;
+    long		number;
+    reader = new frame_reader( std::vector<std::string>( argv + optind, argv + argc ),
+                               n_threads + 1, compressed ? open_compressed : NULL );
+    a_config = reader->next( &number );
+    if( !a_config ){
+        std::cerr << "Failed to read first configuration " << reader->error()
                   << "Program exiting\n";
-        if( a_config ) delete a_config;
+        delete reader;
         exit(EXIT_FAILURE);        
     }
 
 	if(verbose)
 		std::cerr << "Conditions are " << ((a_config->is_periodic)?" ":"not ") << "periodic\n";
-	// Initialize arrays for accumulating results.
-	double	**e_array;
-	double	**de_array;
-	double	**n_array;
-	double	**dx_array;
-	double	**dy_array;
-	
-	int		bin_x, bin_y, bin_xmax, bin_ymax;
-	double	theta;
-	double	r_max = sqrt(a_config->width()*a_config->width()+a_config->height()*a_config->height());
-	if(a_config->is_periodic) r_max /= 2.0;
-	bin_xmax = bin_ymax = 2*floor(r_max/dist)+1;	// 2 for left and right + 1 for middle		
+	// Work out the array sizes for accumulating results.
+	order_setup	setup;
+	setup.type1    = type1;
+	setup.type2    = type2;
+	setup.rotation = rotation;
+	setup.dist     = dist;
+	setup.seed     = seed;
+	setup.r_max = sqrt(a_config->width()*a_config->width()+a_config->height()*a_config->height());
+	if(a_config->is_periodic) setup.r_max /= 2.0;
+	setup.n_full = 2*floor(setup.r_max/dist)+1;	// 2 for left and right + 1 for middle		
+	setup.bin_xmax = setup.bin_ymax = setup.n_full;
+	if(( max_dx > 0.0 ) && ( max_dx < setup.r_max ))	// Only the center of the map
+		setup.bin_xmax = 2*floor(max_dx/dist)+1;
+	if(( max_dy > 0.0 ) && ( max_dy < setup.r_max ))
+		setup.bin_ymax = 2*floor(max_dy/dist)+1;
+	setup.offset_x = ( setup.n_full - setup.bin_xmax ) / 2;
+	setup.offset_y = ( setup.n_full - setup.bin_ymax ) / 2;
+	setup.reach_x  = map_reach( setup, setup.offset_x, setup.bin_xmax );
+	setup.reach_y  = map_reach( setup, setup.offset_y, setup.bin_ymax );
+	int		bin_xmax = setup.bin_xmax;
+	int		bin_ymax = setup.bin_ymax;
 	
 	if(verbose)
-		std::cerr << "Maximum distance is " << r_max << " maximum bin is " << bin_xmax << ".\n";
+		std::cerr << "Maximum distance is " << setup.r_max << " maximum bins are " << bin_xmax << " by " << bin_ymax << ".\n";
 
-	// Allocate arrays
-	e_array  = new double*[bin_xmax];
-	de_array = new double*[bin_xmax];
-	n_array  = new double*[bin_xmax];
-	dx_array = new double*[bin_xmax];
-	dy_array = new double*[bin_xmax];
-	for(int i=0; i< bin_xmax; i++ ){
-		e_array[i]  = new double[bin_ymax];
-		de_array[i] = new double[bin_ymax];
-		n_array[i]  = new double[bin_ymax];
-		dx_array[i] = new double[bin_ymax];
-		dy_array[i] = new double[bin_ymax];
-	}
-	for(int k=0; k < bin_xmax; k++)
-	    for(int l=0; l< bin_ymax; l++){
-	    	e_array[k][l] =
-	    	n_array[k][l] =
-	    	dx_array[k][l] =
-	    	dy_array[k][l] = 0.0;
-	}
+	// Allocate the maps, one set for each thread and the totals.
+	pool = new thread_pool( n_threads );
+	std::vector<order_sums> sums( pool->n_threads );
+	for( size_t t = 0; t < sums.size(); t++ )
+		new_sums( &sums[t], setup );
+	order_totals	totals;
+	new_sums( &totals.sums, setup );
+	totals.next = number;
 	
 	if(verbose)
-		std::cerr << "Arrays allocated.\n";
-
-    // For periodic conditions precalculate de array
-    if(a_config->is_periodic){
-    	for(int k=0; k < bin_xmax; k++)
-    	    for(int l=0; l< bin_ymax; l++){
-    	        de_array[k][l] = (1.00/((bin_xmax-1.00)*(bin_ymax-1.00)));
-    	        if(k == 0)            de_array[k][l] /= 2.0;
-    	        if(l == 0)            de_array[k][l] /= 2.0;
-    	        if(k == (bin_xmax-1)) de_array[k][l] /= 2.0;
-    	        if(l == (bin_ymax-1)) de_array[k][l] /= 2.0;
-    	    }
-		if(verbose)
-			std::cerr << "Precalculated de_array for periodic conditions.\n";
-    }
-    
-    do {
-    	for(int i = 0; i < a_config->n_objects(); i++ ){
-    		if(a_config->get_object(i)->o_type == type1 ){
-    			// Calculate de_array if necessary (non-periodic conditions)
-    			if(!a_config->is_periodic){
-					bool is_inside;
-   					int	counter = 0;
-					double x, y;
-    				for(int k=0; k < bin_xmax; k++){
-    					for(int l=0; l < bin_ymax; l++){
-    						de_array[k][l] = 0.0;
-    					}
-    				}
-					{
-    					int n_tries = (a_config->width()/dist)*(a_config->height()/dist);	// Maximum number of bins
-    					n_tries *= 1000;													// Factor determining precision
-    					for(int k=0; k<n_tries; k++){
-    						x = rnd_lin(a_config->width());
-    						y = rnd_lin(a_config->height());
-    						if(a_config->is_rectangle){
-    							is_inside = true;
-    						} else {
-    							x += a_config->poly->x_min();
-    							y += a_config->poly->y_min();
-    							is_inside = a_config->poly->is_inside(x,y);
-    						}
-    						if(is_inside){
-	    						// Calculate bin number.    					
-    							double dx = a_config->get_object(i)->pos_x - x;
-    							double dy = a_config->get_object(i)->pos_y - y;
-	    						theta = atan2(dy, dx);
-    							theta += a_config->get_object(i)->orientation;
-    							double r = sqrt(dx*dx+dy*dy);
-    							dx = r * sin(theta);
-    							dy = r * cos(theta);
+		std::cerr << "Arrays allocated for " << pool->n_threads << " threads.\n";
 
-    							bin_x = floor( bin_xmax * (r_max+dx+dist/2.0)/(2.0*r_max));
-    							bin_y = floor( bin_ymax * (r_max+dy+dist/2.0)/(2.0*r_max));
-    							de_array[bin_x][bin_y] += 1.0;
-    							counter++;
-    						}
-    					}
-    				}
-    				for(int k=0; k < bin_xmax; k++){
-    					for(int l=0; l < bin_ymax; l++){
-    						de_array[k][l] = de_array[k][l]/counter;
-    					}
-    				}
-    			}
-    			for(int j = 0; j < a_config->n_objects(); j++ ){
-    				if(a_config->get_object(j)->o_type == type2 ){
-   					
-    					// Calculate bin number.    					
-    					double dx = a_config->get_object(j)->pos_x - a_config->get_object(i)->pos_x;
-    					double dy = a_config->get_object(j)->pos_y - a_config->get_object(i)->pos_y;
-    					
-    					// If necessary adjust for closest image.
-    					if(a_config->is_periodic){
-    						if( dx >  a_config->width() /2.0 ) dx -= a_config->width() /2.0; 
-    						if( dy >  a_config->height()/2.0 ) dy -= a_config->height()/2.0; 
-    						if( dx < -a_config->width() /2.0 ) dx += a_config->width() /2.0; 
-    						if( dy < -a_config->height()/2.0 ) dy += a_config->height()/2.0; 
-    					}
-    					
-    					theta = atan2(dy, dx);
-    					theta += a_config->get_object(i)->orientation;
-    					double r = sqrt(dx*dx+dy*dy);
-    					dx = r * sin(theta);
-    					dy = r * cos(theta);
+    add_config( a_config, number, setup, &sums[0] );
+    end_frame( &sums[0], number, &totals );
+    reader->release( a_config );
+    pool->run( pool->n_threads, [&]( int task, int thread ){
+        config	*frame;
+        long	frame_number;
+        while(( frame = reader->next( &frame_number )) != NULL ){
+            add_config( frame, frame_number, setup, &sums[thread] );
+            end_frame( &sums[thread], frame_number, &totals );
+            reader->release( frame );
+        }
+    });
+    if( !reader->error().empty() )
+        std::cerr << "Error reading " << reader->error() << "Premature termination.\n";
+    if( verbose )
+        std::cerr << "Analysed " << reader->n_read() << " frames.\n";
+    delete pool;
+    delete reader;
 
-    					bin_x = floor( bin_xmax * (r_max+dx+dist/2.0)/(2.0*r_max));
-    					bin_y = floor( bin_ymax * (r_max+dy+dist/2.0)/(2.0*r_max));
-    					// Increment arrays of <n>, n
-    					n_array[bin_x][bin_y] += 1.0;
-    					for(int k=0; k < bin_xmax; k++)
-    					    for(int l=0; l < bin_ymax; l++ )
-    					        e_array[k][l] += de_array[k][l];
-    					// Calculate relative orientation dx, dy including symmetry rotation #
-    					theta = a_config->get_object(i)->orientation - a_config->get_object(j)->orientation;
-    					theta *= rotation;
-    					
-    					// Increment dx, dy arrays
-    					dx_array[bin_x][bin_y] += sin(theta);
-    					dy_array[bin_x][bin_y] += cos(theta);
-    				}
-    			}
-    		}
-    	}
-    	
-    	// Finished with this configuration move on to next if there is one.
-    	// (currently normal file termination and error conditions are not properly distinguished)
-    	
-    	delete a_config;
-    	a_config = (config *)NULL;
-    	
-    	// Try to read a new configuration from trajectory
-    	if(trajectory){
-    		if( traj_stream.good() ){
-    			try{
-    				traj_stream.getline(line, LINE_LENGTH);		// Separator
-        			a_config = new config( traj_stream );
-    	        	if( verbose )
-        	        	std::cerr << "Input read " << line 
-        	            	<< " from " << argv[ optind - 1 ] << "\n";        		
-    			}
-    			catch(...){
-    				if( !traj_stream.eof() )
-    					std::cerr << "Error reading trajectory file\n";
-    				traj_stream.close();
-    				if(a_config){
-    					delete a_config;
-    					a_config = (config *)NULL;
-    				}
-    			}
-    		} else {
-    			if(verbose)
-    				std::cerr << "End of trajectory file\n";
-    		}
-    	}
-    	// if still no config try reading another file
-    	if(( !a_config ) && (( argc - optind ) > 0)){
-    		try {
-	        	if( trajectory ){
-    	    		traj_stream.open( argv[ optind ] );
-        			if( ! traj_stream.good()) throw(1);
-        			traj_stream.getline(line, LINE_LENGTH);		// Separator
-        			a_config = new config( traj_stream );
-    	        	if( verbose )
-        	        	std::cerr << "Input read " << line 
-        	            	<< " from " << argv[ optind ] << "\n";        		
-        		} else {
-                	a_config = new config( argv[ optind ] );
-    	     	    if( verbose )
-        	    	    std::cerr << "Input read from " << argv[ optind ] << "\n";
-        		}
-    			optind++;
-    		}
-    		catch(...){
-    			std::cerr << "Error reading " << argv[optind] << ". Premature termination.\n";
-    			if (a_config){
-    				delete a_config;
-    				a_config = (config *)NULL;
-    			}
-    		}
-    	}
-    } while ( a_config != (config *)NULL );
+    // Every frame has been added to the totals, now add the expected numbers
+    // with periodic conditions.
+    std::vector<double>&	e_array  = totals.sums.e_array;
+    std::vector<double>&	n_array  = totals.sums.n_array;
+    std::vector<double>&	dx_array = totals.sums.dx_array;
+    std::vector<double>&	dy_array = totals.sums.dy_array;
+    if( totals.sums.n_periodic > 0.0 )
+        for(int k=0; k < bin_xmax; k++)
+            for(int l=0; l< bin_ymax; l++)
+                e_array[k*bin_ymax+l] += totals.sums.n_periodic *
+                    periodic_de( setup, k+setup.offset_x, l+setup.offset_y );
     
     if(verbose)
     	std::cerr << "Calculations finished... writing results.\n";
@@ -364,26 +556,13 @@ main( int argc, char **argv )
 	dest << bin_xmax << " " << bin_ymax << "\n";
     for(int k=0; k < bin_xmax; k++)
         for(int l=0; l < bin_ymax; l++){
-        	dest << k << " " << l << " " << n_array[k][l]/e_array[k][l] << " " 
-        	     << e_array[k][l] << " " << dx_array[k][l] << " " << dy_array[k][l] << "\n";
+        	int b = k*bin_ymax+l;
+        	dest << k << " " << l << " " << n_array[b]/e_array[b] << " " 
+        	     << e_array[b] << " " << dx_array[b] << " " << dy_array[b] << "\n";
         }
 
     if(out_name) of.close();
     
     if(verbose)
-    	std::cerr << "Output finished... tidying up.\n";
-    	
-    for(int i=0; i< bin_xmax; i++ ){
-		delete[] e_array[i];
-		delete[] de_array[i];
-		delete[] n_array[i];
-		delete[] dx_array[i];
-		delete[] dy_array[i];
-	}
-
-	delete[] e_array;
-	delete[] de_array;
-	delete[] n_array;
-	delete[] dx_array;
-	delete[] dy_array;
+    	std::cerr << "Output finished.\n";
 }
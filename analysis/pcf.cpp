@@ -1,88 +1,317 @@
 /**
  * @brief Calculate the pair correlation function for a collection of distributions
+ *
+ * The type2 objects of each frame are put in a cell grid with cells at least
+ * the largest distance wide, so only the objects in the surrounding cells of
+ * each type1 object are examined. With -m this distance can be made smaller
+ * than the size of the configuration, the cost is then proportional to the
+ * number of objects times the number of neighbours. The type1 objects are
+ * shared between the threads in blocks, and a thread that finds no block left
+ * in the current frame starts the next one, so both large snapshots and long
+ * trajectories of small configurations use all the threads. The sums of each
+ * block are added to the totals in the order the blocks were handed out, so
+ * the output is the same whatever the number of threads.
  */
  
 #define	MAXBIN		5000
+#define	PCF_BLOCK	64		// Reference objects handed to a thread at a time
 
 #include "../Classes/config.h"
+#include "../Classes/frame_reader.h"
 #include <iostream>
 #include <unistd.h>
 #include <vector>
-#include <random>
+#include <map>
+#include <mutex>
+#include <atomic>
 
 using namespace std;
 
-#define INTSTEPS (int)(1000*a_config->area()/(M_PI*dr*dr))
-
 /*
 **	Local routines
 */
 
-double get_random(double low, double high)		// Return a random number uniformly
-{							// distributed between [low and high]
-    static std::default_random_engine e;                // Appears to work.
-    static std::uniform_real_distribution<> dis(0.0, 1.0);
-    double r = dis(e);
-    return low + (high-low) * r;
+/*
+ * The parameters of the calculation.
+ */
+struct pcf_setup {
+    int			type1, type2;	// Types of the objects in the pairs
+    double		dr;		// Bin size
+    double		rmax;		// Largest distance (0 for the whole configuration)
+    bool		verbose;
+};
+
+/*
+ * What is summed by one block, or the totals.
+ */
+struct pcf_sums {
+    std::vector<int>	count;		// Number found at given distance
+    std::vector<double>	area;		// Number expected at the given distance
+};
+
+/*
+ * The totals and the blocks finished before those handed out earlier.
+ */
+struct pcf_totals {
+    pcf_sums			sums;
+    std::map<long, pcf_sums>	waiting;	// By the order the blocks were handed out
+    long			next;		// The next block to add
+    std::mutex			lock;
+};
+
+/*
+ * A frame being analysed, its type1 objects are handed out in blocks.
+ */
+struct pcf_frame {
+    config		*data;
+    long		number;		// Frame number
+    int			maxbin;		// Number of bins for this frame
+    int			n_type2;
+    cell_list		*cells;		// The type2 objects
+    std::vector<int>	refs;		// The type1 objects
+    std::vector<double>	d_area;		// Fraction of area at given distance (periodic)
+    int			n_blocks;
+    int			next_block;	// Next block to hand out
+    std::atomic<int>	n_done;		// Blocks finished
+};
+
+/*
+ * Prepare a frame, the grid of type2 objects and for periodic conditions the
+ * fraction of the area at each distance.
+ */
+pcf_frame *
+start_frame(config *a_config, long number, const pcf_setup& setup)
+{
+    pcf_frame	*frame = new pcf_frame;
+    double	dr = setup.dr;
+    double	rmax;
+    object	*my_obj;
+
+    frame->data   = a_config;
+    frame->number = number;
+    if(setup.verbose)
+        std::cerr << "Starting treatment of configuration " << number << "\n";
+    /// Number of bins, limited by the size of the configuration and -m
+    if( a_config->is_rectangle){
+        rmax = sqrt( a_config->x_size * a_config->x_size + a_config->y_size * a_config->y_size );
+        if( a_config->is_periodic ) rmax /= 2.0;
+    } else {
+        rmax = a_config->poly->max_dist();
+    }
+    frame->maxbin = 1 + floor( rmax/dr );
+    if( setup.rmax > 0.0 ){
+        int limit = ceil( setup.rmax/dr );
+        if( limit < frame->maxbin ) frame->maxbin = limit;
+    }
+
+    frame->d_area.assign( frame->maxbin, 0.0 );
+    if( a_config->is_periodic ){ 		// Fill in d_area array Maths is rather inaccurate
+        for( int i=0; i< frame->maxbin; i++ ){  // TODO Need to improve accuracy in corner regions
+            double theta1 = 0.0;
+            double theta2 = M_PI/2.0;
+            if( i * dr > a_config->x_size / 2.0 ) theta1 = acos( a_config->x_size / (2.0 * i * dr ));
+            if( i * dr > a_config->y_size / 2.0 ) theta2 = M_PI/2.0 - acos( a_config->y_size / (2.0 * i * dr ));
+            frame->d_area[i] = dr * dr * (2*i+1) * (theta2 - theta1) * 2.0;
+            frame->d_area[i] /= a_config->area();
+        }
+    }
+    if(setup.verbose){
+        double sum = 0.0;
+        for(int i=0; i<frame->maxbin; i++)
+            sum += frame->d_area[i];
+        std::cerr << "Sum of d_areas is " << sum << "(should be 1.0 or 0.0)\n";
+    }
+
+    if( a_config->is_rectangle )		// Cells at least as wide as the bins counted
+        frame->cells = new cell_list( 0.0, 0.0, a_config->x_size, a_config->y_size,
+                                      frame->maxbin * dr, a_config->is_periodic );
+    else
+        frame->cells = new cell_list( a_config->poly->x_min(), a_config->poly->y_min(),
+                                      a_config->poly->x_max() - a_config->poly->x_min(),
+                                      a_config->poly->y_max() - a_config->poly->y_min(),
+                                      frame->maxbin * dr, false );
+    frame->n_type2 = 0;
+    for(int i=0; i< a_config->n_objects(); i++ ){
+        my_obj = a_config->get_object(i);
+        if( my_obj->o_type == setup.type2 ){
+            frame->cells->insert( i, my_obj->pos_x, my_obj->pos_y );
+            frame->n_type2++;
+        }
+        if( my_obj->o_type == setup.type1 )
+            frame->refs.push_back( i );
+    }
+    if( frame->n_type2 == 0 ) frame->refs.clear();
+    frame->n_blocks   = ( frame->refs.size() + PCF_BLOCK - 1 ) / PCF_BLOCK;
+    frame->next_block = 0;
+    frame->n_done     = 0;
+    return frame;
+}
+
+void
+end_frame(pcf_frame *frame)
+{
+    delete frame->cells;
+    delete frame;
+}
+
+/*
+ * Add the pairs of a block of type1 objects to sums. Without periodic
+ * conditions the expected numbers use the exact area of each annulus around
+ * the object that is inside the polygon.
+ */
+void
+add_block(pcf_frame *frame, int block, const pcf_setup& setup, pcf_sums *sums)
+{
+    config		*a_config = frame->data;
+    int			maxbin = frame->maxbin;
+    double		dr = setup.dr;
+    std::vector<double>	d_area( frame->d_area );
+    int			nbr[9];
+    int			n_nbr, i, bin;
+    double		r, x, y, x2, y2;
+
+    if( maxbin > (int)sums->count.size() ){
+        sums->count.resize( maxbin, 0 );
+        sums->area.resize( maxbin, 0.0 );
+    }
+    for( int k = block * PCF_BLOCK;
+         ( k < (block + 1) * PCF_BLOCK ) && ( k < (int)frame->refs.size() ); k++ ){
+        i = frame->refs[k];
+        x = a_config->get_object(i)->pos_x;
+        y = a_config->get_object(i)->pos_y;
+        //// Add to areas array
+        if( ! a_config->is_periodic ){	// Can't use precalculated array as d_area depends on x,y
+            double inner = 0.0;			// Exact area of each annulus inside the polygon
+            double outer;
+            double total = a_config->poly->area();
+            for( int j=0; j< maxbin; j++ ){
+                outer = a_config->poly->circle_area( x, y, (j+1)*dr );
+                d_area[j] = ( outer - inner ) / total;
+                inner = outer;
+            }
+        }
+        for( int j=0; j< maxbin; j++ ){     // Add probable number at each distance...
+            sums->area[j] += d_area[j] * frame->n_type2 ;
+        }
+        //// Loop over the type2 objects in the surrounding cells and add to count array
+        n_nbr = frame->cells->neighbour_cells( frame->cells->cell_of( x, y ), nbr );
+        for( int c = 0; c < n_nbr; c++ )
+            for( int j = frame->cells->first( nbr[c] ); j >= 0; j = frame->cells->next( j )){
+                if(( setup.type1 == setup.type2 ) && ( j < i )) continue;
+                x2 = a_config->get_object(j)->pos_x;
+                y2 = a_config->get_object(j)->pos_y;
+
+                // If periodic get closest image to x,y
+                if( a_config->is_periodic ){
+                   if(  x2 < x ) x2 += a_config->x_size;
+                   if(( x2 - x ) > (x - x2 + a_config->x_size)) x2 -= a_config->x_size;
+                   if(  y2 < y ) y2 += a_config->y_size;
+                   if(( y2 - y ) > (y - y2 + a_config->y_size)) y2 -= a_config->y_size;
+                }
+
+                r = (x2 - x)*(x2 - x)+(y2 - y)*(y2 - y);
+                if( r >= ( maxbin * dr ) * ( maxbin * dr )) continue;
+                r = sqrt(r);
+                bin = floor( r/dr );
+                if( bin >= maxbin ) continue;	// Rounding at the limit
+                sums->count[bin]++;
+                if((setup.type1 == setup.type2) && (i != j)) sums->count[bin]++;
+            }
+    }
+}
+
+/*
+ * Add the sums of a block to the totals once those of every block handed out
+ * before it have been added, order is its place in the order of handing out.
+ */
+void
+end_block(pcf_sums *sums, long order, pcf_totals *totals)
+{
+    std::lock_guard<std::mutex> guard( totals->lock );
+    totals->waiting[order] = std::move( *sums );
+    while( !totals->waiting.empty() && ( totals->waiting.begin()->first == totals->next )){
+        pcf_sums&	first = totals->waiting.begin()->second;
+        if( first.count.size() > totals->sums.count.size() ){
+            totals->sums.count.resize( first.count.size(), 0 );
+            totals->sums.area.resize( first.count.size(), 0.0 );
+        }
+        for( size_t i = 0; i < first.count.size(); i++ ){
+            totals->sums.count[i] += first.count[i];
+            totals->sums.area[i]  += first.area[i];
+        }
+        totals->waiting.erase( totals->waiting.begin() );
+        totals->next++;
+    }
 }
 
 void
 usage()
 {
-    std::cerr << "Usage: pcf [-v] [-o output] [-r dist] [-t type1] [-u type2] file1...\n" ;
+    std::cerr << "Usage: pcf [-v] [-o output] [-r dist] [-m max_dist] [-t type1] [-u type2] [-j threads] file1...\n" ;
     std::cerr << "-v verbose output to stderr,\n" ;
     std::cerr << "-o output send output to file output (default stdout),\n" ;
     std::cerr << "-r dist set the integration bin size to dist (default 1.0),\n" ;
+    std::cerr << "-m max_dist only count pairs closer than max_dist (default the size of the configuration),\n" ;
     std::cerr << "-t type1 look at distances between objects of this type and type2 (default 0),\n" ;
     std::cerr << "-u type2 look at distances between objects of this type and type1 (default 0),\n" ;
-    std::cerr << "file1... series of configuration files to read, if none are given use stdin.\n" ;
+    std::cerr << "-j threads number of threads (0 for one per core, the default),\n" ;
+    std::cerr << "file1... series of configuration or trajectory files to read, if none are given use stdin.\n" ;
 }
 
 int
 main( int argc, char **argv )
 {
     config      	*a_config = (config *)NULL;
-    bool		verbose = false;
+    frame_reader	*reader;			// Reads the frames ahead of the analysis
+    thread_pool		*pool;
+    pcf_setup		setup;
+    pcf_frame		*current;			// The frame whose blocks are being handed out
+    bool		at_end = false;			// No more frames
+    long		handed_out = 0;			// Blocks handed out
+    std::mutex		lock;				// For current, at_end, handed_out and reading
+    long		number;				// Frame number
     char        	c;
     char		*out_name = (char *)NULL;
-    int			type1 = 0;
-    int         	type2 = 0;
-    double		dr = 1;
-    double		r;
+    int			n_threads = 0;
     int 		maxbin = 0;
-    int 		newmax;
-    int			bin;
-    double		rmax;
-    std::vector<int>	count;		// Number found at given distance
-    std::vector<double>	area;		// Number expected at the given distance
-    std::vector<double>	d_area;		// Fraction of area at given distance - sum = 1.0
-    int			n_type2;
-    double		x, y, x2, y2;
+    pcf_totals		totals;
+
+    setup.type1   = 0;
+    setup.type2   = 0;
+    setup.dr      = 1.0;
+    setup.rmax    = 0.0;
+    setup.verbose = false;
 
     // Getopt based argument handling.
     // Need to fix this for this programme...
-    while( ( c = getopt (argc, argv, "vho:r:t:u:") ) != -1 )
+    while( ( c = getopt (argc, argv, "vho:r:m:t:u:j:") ) != -1 )
     {
         switch(c)
         {
-            case 'v': verbose = true; break;
+            case 'v': setup.verbose = true; break;
             case 'r':				// step size
-                if (optarg) dr = atof(optarg);  //TODO should check its a number
+                if (optarg) setup.dr = atof(optarg);  //TODO should check its a number
+                break;            
+            case 'm':				// Largest distance (default all)
+                if (optarg) setup.rmax = atof(optarg);
                 break;            
             case 'o':				// Output file (default stdout)
                 if (optarg) out_name = optarg;
                 break;
             case 't':				// type 1 object (default 0)
-                if (optarg) type1 = atoi(optarg); //TODO should check its a number
+                if (optarg) setup.type1 = atoi(optarg); //TODO should check its a number
                 break;
             case 'u':				// type 2 object (default 0)
-                if (optarg) type2 = atoi(optarg);
+                if (optarg) setup.type2 = atoi(optarg);
+                break;
+            case 'j':				// Threads (default one per core)
+                if (optarg) n_threads = atoi(optarg);
                 break;
             case 'h':
                 usage();
                 exit(EXIT_SUCCESS);
             case '?':				// Something wrong.
-                if (optopt == 'o' or optopt == 'r' or optopt == 't' or optopt == 'u'){
+                if (optopt == 'o' or optopt == 'r' or optopt == 'm' or optopt == 't' or optopt == 'u' or optopt == 'j'){
                     std::cerr << "The -" << optopt << " option is missing a parameter!\n";
                 } else {
                     std::cerr << "Unknown option " << optopt << "!\n";
@@ -92,177 +321,78 @@ main( int argc, char **argv )
                 exit(EXIT_FAILURE);
         }
     }
+    if( n_threads <= 0 ) n_threads = thread_pool::hardware_threads();
+    bool verbose = setup.verbose;
     if( verbose ){
          std::cerr << "Verbose flag is set.\n";
-         std::cerr << "Step size is " << dr << ".\n";
-         std::cerr << "First object type is  " << type1 << ".\n";
-         std::cerr << "Second object type is " << type2 << ".\n";
+         std::cerr << "Step size is " << setup.dr << ".\n";
+         if( setup.rmax > 0.0 )
+             std::cerr << "Largest distance is " << setup.rmax << ".\n";
+         std::cerr << "First object type is  " << setup.type1 << ".\n";
+         std::cerr << "Second object type is " << setup.type2 << ".\n";
+         std::cerr << "Using " << n_threads << " threads.\n";
     }
 
-// TODO Should seed random number generator somewhere here.
-
 // Read in the first configuration
 
-    try{
-        if(( argc - optind ) > 0 ){	                // Read source configuration
-            a_config = new config( argv[ optind ] );
-            if( verbose )
-                std::cerr << "Input read from " << argv[ optind ] << "\n";
-            optind++;
-        } else {					
-            a_config = new config(std::cin);
-            if( verbose )
-                std::cerr << "Input read from 'stdin'\n";
-        }
-    }
-    catch(...){
-        std::cerr << "Failed to read first configuration\n";
+    reader = new frame_reader( std::vector<std::string>( argv + optind, argv + argc ), 2 );
+    a_config = reader->next( &number );
+    if( !a_config ){
+        std::cerr << "Failed to read first configuration " << reader->error();
         std::cerr << "Program exiting\n";
-        if( a_config ){
-            delete a_config;
-        }
+        delete reader;
         exit(EXIT_FAILURE);        
     }
 
-    // Set up initial vectors for count and area... 
-
-    // Start while loop over input files...
-    do {
-        if(verbose)
-            std::cerr << "Starting treatment of first configuration\n";
-        /// Adjust vector sizes if necessary.
-        if( a_config->is_rectangle){
-            rmax = sqrt( a_config->x_size * a_config->x_size + a_config->y_size * a_config->y_size );
-            if( a_config->is_periodic ) rmax /= 2.0;
-        } else {
-            rmax = a_config->poly->max_dist();
-        }
-        newmax = 1 + floor( rmax/dr );
-        if( newmax > maxbin ){
-            count.resize(newmax);
-            area.resize(newmax);
-            d_area.resize(newmax);
-            for(int i=maxbin; i<newmax; i++ ){
-                count[i]  = 0;
-                area[i]   = 0.0;
-                d_area[i] = 0.0;
-            }
-            maxbin = newmax;
-        }
-
-        if(verbose)
-            std::cerr << "Array sizes adjusted "<< a_config->area() << "\n";
-
-        if( a_config->is_periodic ){ 		// Fill in d_area array Maths is rather inaccurate
-	    for( int i=0; i< maxbin; i++ ){     // TODO Need to improve accuracy in corner regions
-                double theta1 = 0.0;
-                double theta2 = M_PI/2.0;
-                if( i * dr > a_config->x_size / 2.0 ) theta1 = acos( a_config->x_size / (2.0 * i * dr ));
-                if( i * dr > a_config->y_size / 2.0 ) theta2 = M_PI/2.0 - acos( a_config->y_size / (2.0 * i * dr ));
-                d_area[i] = dr * dr * (2*i+1) * (theta2 - theta1) * 2.0;
-                d_area[i] /= a_config->area();
-            }
-        }
-
-        if(verbose){
-            double sum = 0.0;
-            for(int i=0; i<maxbin; i++){
-                sum += d_area[i];
-        ///        fprintf(stderr,"%d\t%d\t%g\t%g\n", i, count[i] , area[i], d_area[i] );
-            }
-            std::cerr << "Sum of d_areas is " << sum << "(should be 1.0 or 0.0)\n";
-            std::cerr << "Starting loop over objects\n";
-        }
-        n_type2 = 0;
-        for(int i=0; i< a_config->n_objects(); i++ )
-            if(a_config->get_object(i)->o_type == type2) n_type2++;
-
-        /// Loop over objects in configuration
-        if( n_type2 > 0 )
-        for(int i=0; i< a_config->n_objects(); i++ )
-            if( a_config->get_object(i)->o_type == type1 ){
-            if(verbose) std::cerr << "Found object #" << i << "\n";
-            x = a_config->get_object(i)->pos_x;
-            y = a_config->get_object(i)->pos_y;
-            //// Add to areas array
-            if( ! a_config->is_periodic ){	// Can't use precalculated array as d_area depends on x,y
-                if(verbose) std::cerr << "Calculating d_area array\n";
-                for( int j=0; j< maxbin; j++ ) d_area[j] = 0.0;
-                double x2, y2;
-                double xmin = a_config->poly->x_min();
-                double xmax = a_config->poly->x_max();
-                double ymin = a_config->poly->y_min();
-                double ymax = a_config->poly->y_max();
-                if(verbose) std::cerr << "Area x=" << xmin << "," << xmax << ", y=" << ymin << "," << ymax << "\n";
-                if(verbose) std::cerr << "Finding " << INTSTEPS << " points.\n";
-       		// Fill d_area for x,y point with probablity at dist...
-                for( int j=0; j<INTSTEPS; j++ ){
-       		    // get a point in the polygon
-                    do{
-                        x2 = get_random(xmin, xmax);
-                        y2 = get_random(ymin, ymax);
-                    } while( ! a_config->poly->is_inside(x2,y2) );
-       		    // calculate r and increment appropriate d_area and sum
-                    r = (x2 - x)*(x2 - x)+(y2 - y)*(y2 - y);
-                    r = sqrt(r);
-                    bin = floor( r/dr );
-                    d_area[bin] += 1.0/INTSTEPS;
+    // Analyse the frames, each thread takes blocks of the current frame, or
+    // starts the next frame, and adds the sums of each block to the totals.
+    pool = new thread_pool( n_threads );
+    totals.next = 0;
+    current = start_frame( a_config, number, setup );
+    pool->run( pool->n_threads, [&]( int task, int thread ){
+        pcf_frame	*frame;
+        int		block;
+        long		order = 0;
+        for(;;){
+            {
+                std::unique_lock<std::mutex> guard( lock );
+                while( !current ){
+                    if( at_end ) return;
+                    a_config = reader->next( &number );
+                    if( !a_config ){
+                        at_end = true;
+                        return;
+                    }
+                    current = start_frame( a_config, number, setup );
                 }
+                frame = current;
+                block = frame->next_block++;
+                if( frame->next_block >= frame->n_blocks ) current = NULL;
+                if( block < frame->n_blocks ) order = handed_out++;
             }
-            if(verbose) std::cerr << "Incrementing areas #" << i << "\n";
-            for( int j=0; j< maxbin; j++ ){     // Add probable number at each distance...
-                area[j] += d_area[j] * n_type2 ;
-            }
-            //// Loop over other objects and add to count array
-            for(int j=((type1==type2)?i:0); j<a_config->n_objects(); j++ ){
-                if(verbose) std::cerr << "." << j ;
-                if( a_config->get_object(j)->o_type == type2 ){
-                x2 = a_config->get_object(j)->pos_x;
-                y2 = a_config->get_object(j)->pos_y;
-
-                // If periodic get closest image to x,y
-                if( a_config->is_periodic ){
-                   if(  x2 < x ) x2 += a_config->x_size;
-                   if(( x2 - x ) > (x - x2 + a_config->x_size)) x2 -= a_config->x_size;
-                   if(  y2 < y ) y2 += a_config->y_size;
-                   if(( y2 - y ) > (y - y2 + a_config->y_size)) y2 -= a_config->y_size;
-                }
-
-                r = (x2 - x)*(x2 - x)+(y2 - y)*(y2 - y);
-                r = sqrt(r);
-                bin = floor( r/dr );
-                assert( bin <= maxbin );
-                count[bin]++;
-                if((type1 == type2) && (i != j)) count[bin]++;
-            }}
-            if(verbose) std::cerr << "\nFinished with #" << i << "\n";
-        }
-        /// Read in the next configuration if any
-
-        if(verbose)
-            std::cerr << "Look for another file\n";
-
-        delete a_config;
-        a_config = (config *)NULL;
-        try{
-            if(( argc - optind ) > 0 ){	                // Read source configuration
-                a_config = new config( argv[ optind ] );
-                if( verbose )
-                    std::cerr << "Input read from " << argv[ optind ] << "\n";
+            if( block < frame->n_blocks ){
+                pcf_sums	sums;
+                add_block( frame, block, setup, &sums );
+                end_block( &sums, order, &totals );
             }
-        }
-        catch(...){
-            std::cerr << "Failed to read configuration from " << argv[ optind ] << "\n";
-            std::cerr << "Program exiting\n";
-            if( a_config ){
-                delete a_config;
-                a_config = (config *)NULL;
+            if( ++frame->n_done >= frame->n_blocks ){	// Last block of the frame
+                reader->release( frame->data );
+                end_frame( frame );
             }
         }
-        optind++;
+    });
+    if( !reader->error().empty() ){
+        std::cerr << "Failed to read configuration from " << reader->error();
+        std::cerr << "Program exiting\n";
+    }
+    if( verbose )
+        std::cerr << "Analysed " << reader->n_read() << " frames\n";
+    delete pool;
+    delete reader;
 
-    // End while loop over files when no more data to analyse
-    } while (a_config != (config *)NULL );
+    std::vector<int>&		count = totals.sums.count;	// Number found at given distance
+    std::vector<double>&	area  = totals.sums.area;	// Number expected at the given distance
+    maxbin = count.size();
 
     // Output the datafile to out_file or std::cout
 
@@ -285,7 +415,7 @@ main( int argc, char **argv )
 
     for(int i=0; i<maxbin; i++){
         if( count[i] == 0 && area[i] == 0.0 ) break;
-        fprintf(dest,"%f\t%g\t%d\t%g\n", (i+0.5)*dr, count[i]/area[i], count[i] , area[i] );
+        fprintf(dest,"%f\t%g\t%d\t%g\n", (i+0.5)*setup.dr, count[i]/area[i], count[i] , area[i] );
     }
 
     if( dest != stdout ) fclose( dest );
@@ -0,0 +1,391 @@
+/**
+ * \file    bench.cpp
+ * \author  James Sturgis
+ * \date    October 16, 2026
+ * \brief   Time the simulation kernels on configurations of increasing size
+ *          and density.
+ *
+ * Configurations of discs on a jittered square lattice are made for each
+ * number of objects and density, with the topology and force field of the
+ * test suite, and the time taken by each kernel is measured:
+ *
+ *      energy_full     config::energy() with every object to recalculate.
+ *      energy_move     a trial move and its energy change, then undone.
+ *      clash_all       config::test_clash() of the whole configuration.
+ *      clash_insert    config::test_clash() of a new object.
+ *      interaction     object::interaction() between two neighbours.
+ *      integrator_run  a step of integrator::run().
+ *      config_write    config::write() to a string.
+ *      config_parse    config::read() of the written text.
+ *      traj_read       config::read() of a frame of a binary trajectory.
+ *
+ * Once, for each version of the pair kernels the processor supports (see
+ * pair_kernel.h), on two 4 atom molecules close enough for all their atoms to
+ * be compared but not overlapping, one in a configuration and the other new:
+ *
+ *      clash_scalar    config::test_clash() of the new object with the scalar
+ *                      kernel.
+ *      clash_avx2      the same with the AVX2 kernel.
+ *      clash_avx512    the same with the AVX-512 kernel.
+ *      overlaps_scalar object::overlaps() of the two molecules with their
+ *                      hard core block (see topology::compile_hard()) and
+ *                      the scalar kernel, and so on for each version.
+ *
+ * and once overlaps_unrolled, object::overlaps() without a block, with the
+ * unrolled kernel of object_kernel.h.
+ *
+ * Each kernel is repeated until it has run for at least min_time seconds, and
+ * the best of 3 such timings is kept. The results are written, one per line,
+ * as the kernel, the number of objects, the density and the nanoseconds per
+ * call (per step for integrator_run). Given a baseline, an earlier output, the
+ * results are compared with it and the programme fails if a kernel is slower
+ * than the baseline by more than the tolerance.
+ *
+ * The command line is:
+ *
+ *      bench [-q][-t min_time][-b baseline][-r tolerance][-o results]
+ *            [-d data_dir]
+ *
+ *      -q              Quick, only the smallest configurations.
+ *      -t min_time     Shortest time for a timing, in seconds (default 0.1).
+ *      -b baseline     Results to compare with.
+ *      -r tolerance    Allowed slowdown as a fraction (default 0.25).
+ *      -o results      File for the results, default std::cout.
+ *      -d data_dir     Where test1.topo and test1.ff are (default ../test).
+ */
+
+#include "../Classes/integrator.h"
+#include "../Classes/pair_kernel.h"
+#include "../Classes/random_stream.h"
+#include "../Classes/common.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <unistd.h>
+#include <vector>
+
+#define BENCH_REPEATS   3       // Timings of each kernel, the best is kept
+#define BENCH_STEPS     1000    // Integrator steps in each call of run()
+#define BENCH_FRAMES    20      // Frames of the trajectory read
+#define BENCH_OBJECT    0       // Type of the objects (a single disc)
+#define BENCH_SQUARE    1       // Type of the objects for the pair kernels (4 atoms)
+#define BENCH_GAP       2.2     // Their distance, less than the clash range
+
+using namespace std;
+
+/*
+ * The result of timing a kernel.
+ */
+struct bench_result {
+    string      name;
+    int         n_objects;
+    double      density;
+    double      ns;             // Nanoseconds per call
+};
+
+static volatile double sink;    // Keeps results the compiler would drop
+
+void
+usage(int val){
+    std::cerr << "bench [-q][-t min_time][-b baseline][-r tolerance][-o results][-d data_dir]\n";
+    exit(val);
+}
+
+/*
+ * Seconds for one call of op, the best of BENCH_REPEATS timings of as many
+ * calls as needed to take min_time.
+ */
+template<class F>
+double
+time_op(F op, double min_time){
+    double  best = HUGE_VAL, elapsed;
+    long    n;
+
+    for( n = 1;; n *= 2 ){                  // Find the number of calls
+        auto start = std::chrono::steady_clock::now();
+        for( long k = 0; k < n; k++ ) op();
+        elapsed = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+        if( elapsed >= min_time ) break;
+    }
+    best = elapsed / n;
+    for( int r = 1; r < BENCH_REPEATS; r++ ){
+        auto start = std::chrono::steady_clock::now();
+        for( long k = 0; k < n; k++ ) op();
+        elapsed = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+        best = simple_min( best, elapsed / n );
+    }
+    return best;
+}
+
+/*
+ * n_objects objects of a type at a density (objects per unit area) in a
+ * periodic square, on a square lattice with each moved at random inside its
+ * lattice cell as far as the lattice allows without overlaps.
+ */
+config *
+make_config(int n_objects, double density, topology *a_topology, int o_type){
+    config  *a_config = new config();
+    int     side = (int)ceil( sqrt( (double)n_objects ));
+    double  size = sqrt( n_objects / density );
+    double  spacing = size / side;
+    double  jitter = simple_max( 0.0, spacing - 2.0 * a_topology->bound_radius( o_type ) - 0.01 );
+    random_stream   numbers( n_objects, (uint64_t)( density * 1000 ));
+
+    a_config->x_size      = size;
+    a_config->y_size      = size;
+    a_config->is_periodic = true;
+    for( int i = 0; i < n_objects; i++ ){
+        object  an_object( o_type,
+                           ( i % side + 0.5 ) * spacing + ( numbers.uniform() - 0.5 ) * jitter,
+                           ( i / side + 0.5 ) * spacing + ( numbers.uniform() - 0.5 ) * jitter,
+                           numbers.uniform() * 2 * M_PI );
+        a_config->add_object( &an_object );
+    }
+    a_config->add_topology( new topology( a_topology ));
+    return a_config;
+}
+
+/*
+ * Time all the kernels on a configuration.
+ */
+void
+bench_config(int n_objects, double density, topology *a_topology,
+        force_field *forces, double min_time, std::vector<bench_result>& results){
+    config      *a_config = make_config( n_objects, density, a_topology, BENCH_OBJECT );
+    integrator  *an_integrator;
+    trajectory  *traj;
+    int         k = 0;
+
+    auto add = [&]( string name, double seconds ){
+        bench_result    a_result = { name, n_objects, density, seconds * 1e9 };
+        results.push_back( a_result );
+    };
+
+    rnd_seed( 1 );
+    add( "energy_full", time_op( [&]{
+        for( int i = 0; i < a_config->n_objects(); i++ )
+            a_config->get_object( i )->recalculate = true;
+        a_config->unchanged = false;
+        sink = a_config->energy( forces );
+    }, min_time ));
+    add( "energy_move", time_op( [&]{
+        sink = a_config->trial_move( rnd_current()->below( n_objects ), 1.0, forces );
+        a_config->reject_move();
+    }, min_time ));
+    add( "clash_all", time_op( [&]{
+        sink = a_config->test_clash();
+    }, min_time ));
+    add( "clash_insert", time_op( [&]{
+        object  an_object( BENCH_OBJECT, rnd_lin( a_config->x_size ),
+                           rnd_lin( a_config->y_size ), 0.0 );
+        sink = a_config->test_clash( &an_object );
+    }, min_time ));
+    add( "interaction", time_op( [&]{        // With the next object on the lattice
+        k = ( k + 1 ) % ( n_objects - 1 );
+        sink = a_config->get_object( k )->interaction( forces, a_topology,
+                                                        a_config->get_object( k + 1 ));
+    }, min_time ));
+
+    ostringstream   text;
+    a_config->write( text );
+    add( "config_write", time_op( [&]{
+        ostringstream   dest;
+        a_config->write( dest );
+        sink = dest.tellp();
+    }, min_time ));
+    config  *other = new config();
+    add( "config_parse", time_op( [&]{
+        istringstream   source( text.str() );
+        other->read( source );
+        sink = other->n_objects();
+    }, min_time ));
+
+    traj = new trajectory( "bench.traj", a_config, "test1.topo" );
+    for( int f = 0; f < BENCH_FRAMES; f++ )
+        traj->write_frame( a_config, f );
+    delete traj;
+    traj = new trajectory( "bench.traj" );
+    add( "traj_read", time_op( [&]{
+        k = ( k + 1 ) % BENCH_FRAMES;
+        other->read( traj, k );
+        sink = other->get_object( 0 )->pos_x;
+    }, min_time ));
+    delete traj;
+    remove( "bench.traj" );
+    delete other;
+
+    an_integrator = new integrator( forces );
+    an_integrator->run( &a_config, 1.0, 1.0, BENCH_STEPS );   // Adjust dl_max
+    add( "integrator_run", time_op( [&]{
+        an_integrator->run( &a_config, 1.0, 1.0, BENCH_STEPS );
+    }, min_time ) / BENCH_STEPS );
+    delete an_integrator;
+    delete a_config;
+}
+
+/*
+ * Time the versions of the pair kernels on a pair of molecules.
+ */
+void
+bench_kernels(topology *a_topology, force_field *forces, double min_time,
+        std::vector<bench_result>& results){
+    topology *blocks = new topology( a_topology );
+    config  *a_config = new config();
+    object  an_object( BENCH_SQUARE, 5.0, 5.0, 0.0 );
+    object  new_object( BENCH_SQUARE, 5.0 + BENCH_GAP, 5.0, 0.0 );
+
+    a_config->x_size      = 10.0;
+    a_config->y_size      = 10.0;
+    a_config->is_periodic = true;
+    a_config->add_object( &an_object );
+    a_config->add_topology( new topology( a_topology ));
+    for( int level = KERNEL_SCALAR; level <= KERNEL_AVX512; level++ ){
+        if( set_pair_kernel( level ) != level ) continue;
+        bench_result    a_result = { string( "clash_" ) + pair_kernel_name(), 1, 0.01,
+                                     1e9 * time_op( [&]{
+                                         sink = a_config->test_clash( &new_object );
+                                     }, min_time ) };
+        results.push_back( a_result );
+    }
+    bench_result    a_result = { "overlaps_unrolled", 1, 0.01, 1e9 * time_op( [&]{
+                                     sink = an_object.overlaps( forces, blocks, &new_object, 0.0, 0.0 );
+                                 }, min_time ) };
+    results.push_back( a_result );
+    blocks->compile_hard( forces );
+    for( int level = KERNEL_SCALAR; level <= KERNEL_AVX512; level++ ){
+        if( set_pair_kernel( level ) != level ) continue;
+        a_result.name = string( "overlaps_" ) + pair_kernel_name();
+        a_result.ns   = 1e9 * time_op( [&]{
+                            sink = an_object.overlaps( forces, blocks, &new_object, 0.0, 0.0 );
+                        }, min_time );
+        results.push_back( a_result );
+    }
+    set_pair_kernel( KERNEL_AUTO );
+    delete blocks;
+    delete a_config;
+}
+
+/*
+ * Read results written by an earlier run, returns false if the file can not
+ * be read.
+ */
+bool
+read_results(const string& name, std::vector<bench_result>& results){
+    ifstream        source( name.c_str() );
+    string          line;
+    bench_result    a_result;
+
+    if( source.fail() ) return false;
+    while( getline( source, line )){
+        if( line.empty() || ( line[0] == '#' )) continue;
+        istringstream   fields( line );
+        if( fields >> a_result.name >> a_result.n_objects >> a_result.density >> a_result.ns )
+            results.push_back( a_result );
+    }
+    return true;
+}
+
+/*
+ * Compare the results with a baseline, each line of the report gives the
+ * baseline, the ratio of the times and whether this is a regression. Returns
+ * the number of regressions.
+ */
+int
+compare_results(const std::vector<bench_result>& results,
+        const std::vector<bench_result>& baseline, double tolerance){
+    std::map<string, double> reference;
+    int                 n_slow = 0;
+    double              ratio;
+    char                key[256];
+
+    for( size_t k = 0; k < baseline.size(); k++ ){
+        snprintf( key, sizeof(key), "%s %d %g", baseline[k].name.c_str(),
+                  baseline[k].n_objects, baseline[k].density );
+        reference[key] = baseline[k].ns;
+    }
+    std::cerr << "# kernel n_objects density ns baseline_ns ratio\n";
+    for( size_t k = 0; k < results.size(); k++ ){
+        snprintf( key, sizeof(key), "%s %d %g", results[k].name.c_str(),
+                  results[k].n_objects, results[k].density );
+        if( reference.count( key ) == 0 ){
+            fprintf( stderr, "%s %.4g - - new\n", key, results[k].ns );
+            continue;
+        }
+        ratio = results[k].ns / reference[key];
+        fprintf( stderr, "%s %.4g %.4g %.3f%s\n", key, results[k].ns,
+                 reference[key], ratio, ( ratio > 1.0 + tolerance ) ? " SLOWER" : "" );
+        if( ratio > 1.0 + tolerance ) n_slow++;
+    }
+    return n_slow;
+}
+
+int
+main(int argc, char** argv) {
+    std::vector<int>         sizes = { 1000, 4000, 16000 };
+    std::vector<double>      densities = { 0.05, 0.1, 0.2 };
+    std::vector<bench_result> results, baseline;
+    string              baseline_name, out_name, data_dir = "../test";
+    double              min_time = 0.1;
+    double              tolerance = 0.25;
+    int                 c, n_slow;
+
+    while(( c = getopt( argc, argv, "qht:b:r:o:d:" )) != -1 )
+        switch( c ){
+            case 'q': sizes.resize( 1 );
+                break;
+            case 't': min_time = std::atof( optarg );
+                break;
+            case 'b': baseline_name = optarg;
+                break;
+            case 'r': tolerance = std::atof( optarg );
+                break;
+            case 'o': out_name = optarg;
+                break;
+            case 'd': data_dir = optarg;
+                break;
+            case 'h': usage( EXIT_SUCCESS );
+            default : usage( EXIT_FAILURE );
+        }
+    if( optind != argc ) usage( EXIT_FAILURE );
+    if(( baseline_name.length() > 0 ) && !read_results( baseline_name, baseline )){
+        std::cerr << "Could not read the baseline " << baseline_name << "\n";
+        exit( EXIT_FAILURE );
+    }
+
+    topology    *a_topology;
+    force_field *forces;
+    try {
+        a_topology = new topology( ( data_dir + "/test1.topo" ).c_str() );
+        forces     = new force_field( ( data_dir + "/test1.ff" ).c_str() );
+    }
+    catch( exception &e ){
+        std::cerr << "Could not read the topology and force field in " << data_dir << "\n";
+        exit( EXIT_FAILURE );
+    }
+
+    for( size_t i = 0; i < sizes.size(); i++ )
+        for( size_t j = 0; j < densities.size(); j++ )
+            bench_config( sizes[i], densities[j], a_topology, forces, min_time, results );
+    bench_kernels( a_topology, forces, min_time, results );
+
+    ofstream    out_file;
+    if( out_name.length() > 0 ) out_file.open( out_name.c_str() );
+    ostream&    dest = out_file.is_open() ? out_file : std::cout;
+    dest << "# kernel n_objects density ns\n";
+    for( size_t k = 0; k < results.size(); k++ )
+        dest << results[k].name << " " << results[k].n_objects << " "
+             << results[k].density << " " << results[k].ns << "\n";
+    out_file.close();
+
+    delete a_topology;
+    delete forces;
+    if( baseline_name.length() == 0 ) return EXIT_SUCCESS;
+    n_slow = compare_results( results, baseline, tolerance );
+    std::cerr << n_slow << " kernels slower than the baseline by more than "
+              << 100 * tolerance << "%\n";
+    return ( n_slow > 0 ) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -32,7 +32,7 @@ string placement_failure  = ""
 void usage()
 {
     std::cerr << "Usage: makeconfig [-v][-p][-t topo_file][-o out_file][-f force_file]"
-        "[-d scale][-a attempts] \n\t x_size y_size n_obj0 ... \n";
+        "[-d scale][-a attempts][-j threads][-S seed] \n\t x_size y_size n_obj0 ... \n";
 }
 
 int 
@@ -45,6 +45,7 @@ main(int argc, char **argv)
     bool        verbose = false;
     bool        clash = true;
     int		max_try = MAX_TESTS;
+    uint64_t    seed = rnd_clock_seed();
     object      *my_object;
 
     config      *a_config = new config();
@@ -59,7 +60,7 @@ main(int argc, char **argv)
 
     // Getopt based argument handling.
 
-    while( ( c = getopt (argc, argv, "vpd:f:t:o:a:") ) != -1 )
+    while( ( c = getopt (argc, argv, "vpd:f:t:o:a:j:S:") ) != -1 )
     {
         switch(c)
         {
@@ -71,6 +72,12 @@ main(int argc, char **argv)
             case 'a':				// Handle optional arguments
                 if (optarg) max_try = std::atof(optarg);
                 break;
+            case 'j':				// Threads for clash tests
+                if (optarg) a_config->set_threads( std::atoi(optarg) );
+                break;
+            case 'S':				// Seed for the random numbers
+                if (optarg) seed = std::strtoull(optarg, NULL, 0);
+                break;
             case 'f':
                 if (optarg) force_name = optarg;
                 break;
@@ -85,7 +92,8 @@ main(int argc, char **argv)
                 return 0;
             case '?':				// Something wrong.
                 if (optopt == 'd' or optopt == 'f' or optopt =='t' or 
-                    optopt == 'o' or optopt == 'a' ){
+                    optopt == 'o' or optopt == 'a' or optopt == 'j' or
+                    optopt == 'S' ){
                     std::cerr << "The -" << optopt << " option is missing a parameter!\n";
                 } else {
                     std::cerr << "Unknown option " << optopt << "!\n";
@@ -95,8 +103,10 @@ main(int argc, char **argv)
                 exit(EXIT_FAILURE);
         }
     }
+    rnd_seed( seed );
     if( verbose ){                              // Report on situation
         std::cerr << "Verbose flag set\n";
+        std::cerr << "Random seed " << seed << "\n";
     }
 
     if(( argc - optind ) < 3 ){			// Check enough parameters
@@ -22,7 +22,7 @@ using namespace std;
 void usage()
 {
     std::cerr << "Usage: shrinkconfig [-v][-p][-t topo_file][-o out_file][-f force_file]"
-        "[-s scale_factor][-a attempts] [source] \n";
+        "[-s scale_factor][-a attempts][-j threads][-S seed] [source] \n";
 }
 
 int 
@@ -38,10 +38,12 @@ main(int argc, char **argv)
     out_name = topo_name = NULL;
     bool        verbose = false;
     int         max_try = 1.0;
+    int         n_threads = 1;
+    uint64_t    seed = rnd_clock_seed();
 
     // Getopt based argument handling.
 
-    while( ( c = getopt (argc, argv, "hvs:t:o:a:") ) != -1 )
+    while( ( c = getopt (argc, argv, "hvs:t:o:a:j:S:") ) != -1 )
     {
         switch(c)
         {
@@ -52,6 +54,12 @@ main(int argc, char **argv)
             case 'a':				// Handle optional arguments
                 if (optarg) max_try = std::atof(optarg);
                 break;
+            case 'j':				// Threads for clash tests
+                if (optarg) n_threads = std::atoi(optarg);
+                break;
+            case 'S':				// Seed of the random moves
+                if (optarg) seed = std::strtoull(optarg, NULL, 0);
+                break;
             case 't':
                 if (optarg) topo_name = optarg;
                 break;
@@ -63,7 +71,8 @@ main(int argc, char **argv)
                 return 0;
             case '?':				// Something wrong.
                 if (optopt == 's' or optopt =='t' or 
-                    optopt == 'o' or optopt == 'a' ){
+                    optopt == 'o' or optopt == 'a' or optopt == 'j' or
+                    optopt == 'S' ){
                     std::cerr << "The -" << optopt << " option is missing a parameter!\n";
                 } else {
                     std::cerr << "Unknown option " << optopt << "!\n";
@@ -73,12 +82,14 @@ main(int argc, char **argv)
                 exit(EXIT_FAILURE);
         }
     }
-
+    rnd_seed( seed );
     if( verbose ){                              // Report on situation
         std::cerr << "Verbose flag set\n";
         std::cerr << "Options parsed\n";
         std::cerr << "Scale factor is " << scale << "\n";
         std::cerr << "Attempts is " << max_try << "\n";
+        std::cerr << "Threads is " << n_threads << "\n";
+        std::cerr << "Random seed " << seed << "\n";
         if( topo_name ){
             std::cerr << "Topology file is " << topo_name << "\n";
 	} else {
@@ -145,6 +156,7 @@ main(int argc, char **argv)
     }
 
     a_config->add_topology(a_topology);         // Associate topology with the configuration.
+    a_config->set_threads( n_threads );
     a_topology = (topology *)NULL;		// Unnecessary but to be tidy and avoid double deletes.
 
     if(a_config->expand( scale , max_try )){    // Rescale configuration after placement.
@@ -0,0 +1,152 @@
+/**
+ * Tests for the cell_list class, the neighbours it gives are compared with
+ * those found by looking at every pair of objects.
+ */
+
+#include "../Classes/cell_list.h"
+#include <cassert>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+
+/*
+ * Distance between two points, with the closest periodic image if periodic.
+ */
+double
+pair_distance(double x1, double y1, double x2, double y2,
+              double width, double height, bool periodic)
+{
+    double  dx = fabs( x1 - x2 );
+    double  dy = fabs( y1 - y2 );
+
+    if( periodic ){
+        dx = fmod( dx, width );
+        dy = fmod( dy, height );
+        if( dx > width / 2.0 )  dx = width - dx;
+        if( dy > height / 2.0 ) dy = height - dy;
+    }
+    return sqrt( dx * dx + dy * dy );
+}
+
+/*
+ * Check that every object is in the cell of its position, in exactly one
+ * cell list, and that every pair closer than the cell size is found by
+ * looking in the cells around each object.
+ */
+void
+check_grid(cell_list *cells, const std::vector<double>& x, const std::vector<double>& y,
+           double width, double height, bool periodic)
+{
+    int     n = x.size();
+    int     nbr[9];
+    int     n_nbr;
+    std::vector<int>    seen( n, 0 );
+    std::vector<char>   found( n );
+
+    for( int c = 0; c < cells->nx * cells->ny; c++ )
+        for( int j = cells->first( c ); j >= 0; j = cells->next( j )){
+            assert( cells->cell( j ) == c );
+            seen[j]++;
+        }
+    for( int i = 0; i < n; i++ ){
+        assert( seen[i] == 1 );
+        assert( cells->cell( i ) == cells->cell_of( x[i], y[i] ));
+    }
+
+    for( int i = 0; i < n; i++ ){
+        n_nbr = cells->neighbour_cells( cells->cell( i ), nbr );
+        assert(( n_nbr >= 1 ) && ( n_nbr <= 9 ));
+        for( int k = 0; k < n_nbr; k++ )
+            for( int l = 0; l < k; l++ )
+                assert( nbr[k] != nbr[l] );     // Each cell only once
+        found.assign( n, 0 );
+        for( int k = 0; k < n_nbr; k++ )
+            for( int j = cells->first( nbr[k] ); j >= 0; j = cells->next( j ))
+                found[j]++;
+        for( int j = 0; j < n; j++ ){
+            assert( found[j] <= 1 );
+            if( pair_distance( x[i], y[i], x[j], y[j], width, height, periodic ) < cells->size )
+                assert( found[j] );
+        }
+    }
+}
+
+/*
+ * Fill a grid with random objects plus objects on the cell and box edges,
+ * then move some of them and reinsert them all, checking the grid each time.
+ */
+void
+test_grid(double width, double height, double size, bool periodic)
+{
+    double  x0 = -3.0, y0 = 2.0;
+    cell_list   cells( x0, y0, width, height, size, periodic );
+    std::vector<double> x, y;
+    double  cell_w = width / cells.nx;
+    double  cell_h = height / cells.ny;
+
+    for( int i = 0; i < 300; i++ ){
+        x.push_back( x0 + width * drand48() );
+        y.push_back( y0 + height * drand48() );
+    }
+    for( int i = 0; i <= cells.nx; i++ )        // On the cell and box edges
+        for( int j = 0; j <= cells.ny; j++ ){
+            x.push_back( x0 + i * cell_w );
+            y.push_back( y0 + j * cell_h );
+        }
+    x.push_back( x0 + width / 2.0 ); y.push_back( y0 + height );       // Middle of the top edge
+    x.push_back( x0 + width );       y.push_back( y0 + height / 2.0 ); // Middle of the right edge
+    for( size_t i = 0; i < x.size(); i++ )
+        cells.insert( i, x[i], y[i] );
+    check_grid( &cells, x, y, width, height, periodic );
+
+    for( size_t i = 0; i < x.size(); i += 3 ){   // Small and large moves
+        x[i] += ( i % 2 ) ? size * ( drand48() - 0.5 ) : width * drand48();
+        y[i] += ( i % 2 ) ? size * ( drand48() - 0.5 ) : height * drand48();
+        if( periodic ){                         // Back in the box
+            x[i] = x0 + fmod( x[i] - x0 + width, width );
+            y[i] = y0 + fmod( y[i] - y0 + height, height );
+        } else {
+            x[i] = fmin( fmax( x[i], x0 ), x0 + width );
+            y[i] = fmin( fmax( y[i], y0 ), y0 + height );
+        }
+        cells.update( i, x[i], y[i] );
+    }
+    x[0] = x0 + cell_w; y[0] = y0 + cell_h;     // Onto a cell corner
+    cells.update( 0, x[0], y[0] );
+    check_grid( &cells, x, y, width, height, periodic );
+
+    cells.clear();
+    for( size_t i = 0; i < x.size(); i++ )
+        cells.insert( i, x[i], y[i] );
+    check_grid( &cells, x, y, width, height, periodic );
+}
+
+int main()
+{
+    printf("Starting tests for Class cell_list\n\n");
+    srand48( 1 );
+
+    test_grid( 20.0, 15.0, 2.5, false );
+    printf( "Neighbours complete without periodic conditions.\n" );
+    test_grid( 20.0, 15.0, 2.5, true );
+    printf( "Neighbours complete with periodic conditions.\n" );
+    test_grid( 6.0, 5.0, 2.5, true );
+    printf( "Neighbours complete in a periodic grid of 2 by 2 cells.\n" );
+    test_grid( 2.0, 9.0, 2.5, true );
+    printf( "Neighbours complete in a periodic grid one cell wide.\n" );
+    test_grid( 2.0, 9.0, 2.5, false );
+    printf( "Neighbours complete in a grid one cell wide.\n" );
+
+    cell_list   edge( 0.0, 0.0, 10.0, 10.0, 2.0, false );
+    assert( edge.cell_of( -1.0, -1.0 ) == edge.cell_of( 0.0, 0.0 ));  // Outside to the border
+    assert( edge.cell_of( 10.0, 10.0 ) == edge.nx * edge.ny - 1 );
+    cell_list   wrap( 0.0, 0.0, 10.0, 10.0, 2.0, true );
+    assert( wrap.cell_of( 10.0, 10.0 ) == wrap.cell_of( 0.0, 0.0 ));  // Wraps around
+    assert( wrap.cell_of( -1.0, 5.0 ) == wrap.cell_of( 9.0, 5.0 ));
+    printf( "Points on and outside the box edges OK\n" );
+
+    printf("Finished tests for Class cell_list\n");
+    printf("-------------------------------\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,108 @@
+
+#include "../Classes/checkpoint.h"
+#include "../Classes/random_stream.h"
+#include <cassert>
+#include <cstdio>
+#include <thread>
+#include <chrono>
+
+#define N_STEPS 3000
+
+int main()
+{
+    printf("-------------------------------\n");
+    printf("Starting tests for Class checkpoint\n\n");
+
+    force_field *forces = new force_field("test1.ff");
+    topology *topo = new topology("test1.topo");
+    config *a_config = new config("test1.config");
+    a_config->add_topology( topo );
+    integrator *an_integrator = new integrator( forces );
+    rnd_seed( 42 );
+    an_integrator->run( &a_config, 1.0, 1.0, N_STEPS + 10 );  // Between adjustments
+    assert( an_integrator->tried() == N_STEPS + 10 );   // Not reset by the adjustments
+    assert( an_integrator->accepted() > an_integrator->n_good );
+
+    checkpoint *saved = new checkpoint();
+    saved->force_text    = checkpoint::file_text("test1.ff");
+    saved->topology_text = checkpoint::file_text("test1.topo");
+    saved->save( a_config, an_integrator );
+    saved->step     = N_STEPS + 10;
+    saved->n_frames = 3;
+    saved->write("test.ckpt");
+    delete saved;
+    printf("Checkpoint written\n");
+
+    an_integrator->run( &a_config, 1.0, 1.0, N_STEPS ); // The run carries on
+
+    checkpoint *read = new checkpoint("test.ckpt");
+    assert( read->step == N_STEPS + 10 );
+    assert( read->n_frames == 3 );
+    assert( read->seed == 42 );
+    assert( read->n_step == N_STEPS + 10 );
+    assert( read->n_good_total + read->n_bad_total == N_STEPS );
+    assert( read->force_text == checkpoint::file_text("test1.ff") );
+    force_field *forces2 = read->make_forces();
+    topology *topo2 = read->make_topology();
+    assert( forces2->radius.size() == forces->radius.size() );
+    assert( forces2->cut_off == forces->cut_off );
+    assert( topo2->n_molecules == topo->n_molecules );
+    config *other = new config();
+    other->read( read );
+    other->add_topology( topo2 );
+    integrator *other_integrator = new integrator( forces2 );
+    rnd_seed( 1 );                                      // Replaced by restore()
+    read->restore( other_integrator );
+    assert( other_integrator->dl_max == read->dl_max );
+    other_integrator->run( &other, 1.0, 1.0, N_STEPS ); // The same run
+    assert( other->n_objects() == a_config->n_objects() );
+    for( int i = 0; i < a_config->n_objects(); i++ ){
+        assert( other->get_object(i)->pos_x == a_config->get_object(i)->pos_x );
+        assert( other->get_object(i)->pos_y == a_config->get_object(i)->pos_y );
+        assert( other->get_object(i)->orientation == a_config->get_object(i)->orientation );
+    }
+    assert( other_integrator->n_good == an_integrator->n_good );
+    assert( other_integrator->accepted() == an_integrator->accepted() );
+    assert( other_integrator->tried() == 2 * N_STEPS + 10 );
+    assert( other_integrator->dl_max == an_integrator->dl_max );
+    printf("Run continued exactly from the checkpoint\n");
+    delete other_integrator;
+    delete other;                                       // With its topology
+    delete forces2;
+    delete read;
+
+    try {
+        read = new checkpoint("test1.config");          // Not a checkpoint
+        delete read;
+        assert( false );
+    }
+    catch(exception &e) {
+        cout << e.what();
+    }
+    remove("test.ckpt");
+
+    static volatile sig_atomic_t stop = 0;              // Set during the sweeps
+    config *poly_config = new config("test2.config");   // Sweeps made of steps
+    poly_config->add_topology( new topology("test2.topo") );
+    integrator *stopped = new integrator( forces );
+    stopped->stop_on( &stop );
+    std::thread stopper( []{
+        std::this_thread::sleep_for( std::chrono::milliseconds( 20 ));
+        stop = 1;
+    });
+    int n_sweeps = stopped->sweep( &poly_config, 1.0, 1.0, 1000000 );
+    stopper.join();
+    assert( n_sweeps < 1000000 );
+    assert( stopped->steps() == n_sweeps * poly_config->n_objects() );  // Only whole sweeps
+    printf("Stopped after %d whole sweeps\n", n_sweeps);
+    delete stopped;
+    delete poly_config;
+
+    delete an_integrator;
+    delete a_config;
+    delete forces;
+
+    printf("Finished tests for Class checkpoint\n");
+    printf("-------------------------------\n");
+    return EXIT_SUCCESS;
+}
@@ -1,10 +1,28 @@
 
 #include "../Classes/config.h"
+#include "../Classes/pair_kernel.h"
 #include <cassert>
 #include <exception>
+#include <fstream>
+#include <sstream>
 
 #define EPSILON 1e-15
 
+/*
+ * True if the objects of the two configurations are at exactly the same
+ * positions and orientations (config::rms() is not implemented yet).
+ */
+bool
+same_places(config *c1, config *c2){
+    if( c1->n_objects() != c2->n_objects() ) return false;
+    for( int i = 0; i < c1->n_objects(); i++ )
+        if(( c1->get_object(i)->pos_x != c2->get_object(i)->pos_x ) ||
+           ( c1->get_object(i)->pos_y != c2->get_object(i)->pos_y ) ||
+           ( c1->get_object(i)->orientation != c2->get_object(i)->orientation ))
+            return false;
+    return true;
+}
+
 int main()
 {
     printf("-------------------------------\n");
@@ -18,6 +36,18 @@ int main()
 
     printf("Constructors tested for Class config\n");
 
+    ifstream stream1("test1.config");                   // Read line by line
+    config* config1s = new config( stream1 );
+    assert( same_places( config1, config1s ));
+    delete config1s;
+    istringstream text("# A comment\n\n  10 +10.5 # size\r\n1\n\t0 1e0 +2.5 -0.25 \n");
+    config* config1t = new config( text );               // Spaces, comments and signs
+    assert( config1t->y_size == 10.5 );
+    assert( config1t->get_object(0)->pos_x == 1.0 );
+    assert( config1t->get_object(0)->pos_y == 2.5 );
+    assert( config1t->get_object(0)->orientation == -0.25 );
+    delete config1t;
+
     assert( config1->rms( *config2 ) <= EPSILON );
     assert(( config1->area()-1e4) < EPSILON );
     assert( ! config2->expand(2.0));			// No associated topology
@@ -34,6 +64,138 @@ int main()
     assert( ! config4->expand(2.0));			// No associated topology
     assert(( config4->area()-4*value) < EPSILON );
 
+    printf("Testing Verlet lists for Class config\n");
+
+    force_field *ff = new force_field("test1.ff");
+    config* config7 = new config( *config1 );
+    config7->add_topology( new topology("test1.topo") );
+    config7->use_verlet( 1.0 );
+    rnd_seed( 1 );
+    for( int i = 0; i < 2000; i++ ){			// Some moves updating energies
+        if( config7->trial_move( i % config7->n_objects(), 2.0, ff ) <= 0.0 )
+            config7->commit_move();
+        else
+            config7->reject_move();
+    }
+    assert(( config7->verlet_builds() == 1 ) && ( config7->verlet_updates() > 0 ));
+    config* config8 = new config( config7 );		// Same positions without lists
+    config8->use_verlet( 0.0 );
+    assert( ! config8->expand( 1.0 ));			// Force a full recalculation
+    assert( fabs( config7->energy( ff ) - config8->energy( ff )) < 1e-9 );
+    assert( config8->verlet_builds() == 0 );
+    delete config7;
+    delete config8;
+    delete ff;
+
+    printf("Testing threads for Class config\n");
+
+    ff = new force_field("test1.ff");
+    config* config9 = new config();			// Large random configuration
+    config9->x_size = config9->y_size = 150.0;
+    config9->add_topology( new topology("test1.topo") );
+    for( int i = 0; i < 3000; i++ ){
+        object *an_object = new object( i % 2, rnd_lin(150.0), rnd_lin(150.0), rnd_lin(M_2PI) );
+        config9->add_object( an_object );
+        delete an_object;
+    }
+    config* config10 = new config( config9 );
+    config10->set_threads( 4 );
+    assert( config9->energy( ff ) == config10->energy( ff )); // Same order, same sum
+    assert( config9->test_clash() == config10->test_clash() );
+    object *new_object = new object( 0, 75.0, 75.0, 0.0 );
+    assert( config9->test_clash( new_object ) == config10->test_clash( new_object ));
+    delete new_object;
+
+    printf("Testing checkerboard sweeps for Class config\n");
+
+    int n_tried1, n_tried2;
+    config9->is_periodic = config10->is_periodic = true;
+    config9->drop_cells();
+    config10->drop_cells();
+    rnd_seed( 2 );
+    int n_good1 = config9->checkerboard_sweep( 1.0, 1.0, ff, &n_tried1 );
+    rnd_seed( 2 );
+    int n_good2 = config10->checkerboard_sweep( 1.0, 1.0, ff, &n_tried2 );
+    assert(( n_good1 > 0 ) && ( n_tried1 == config9->n_objects() ));
+    assert(( n_good1 == n_good2 ) && ( n_tried1 == n_tried2 ));
+    assert( same_places( config9, config10 ));	// Independent of the threads
+    config* config11 = new config( config10 );
+    config11->expand( 1.0 );				// Force a full recalculation
+    assert( fabs( config10->energy( ff ) - config11->energy( ff )) < 1e-9 * fabs( config11->energy( ff )));
+    assert( config4->checkerboard_sweep( 1.0, 1.0, ff, &n_tried1 ) < 0 ); // Polygon
+    delete config11;
+    delete config9;
+    delete config10;
+    delete ff;
+
+    printf("Testing hard core moves for Class config\n");
+
+    ff = new force_field( 0.5 );			// Only hard cores
+    assert( ff->is_hard() );
+    config* config12 = new config();
+    config12->x_size = config12->y_size = 20.0;
+    config12->is_periodic = true;
+    config12->add_topology( new topology( 0.5 ));
+    rnd_seed( 3 );
+    while( config12->n_objects() < 250 ){		// Random without overlaps
+        object *an_object = new object( 0, rnd_lin(20.0), rnd_lin(20.0), 0.0 );
+        if( ! config12->test_clash( an_object ))
+            config12->add_object( an_object );
+        delete an_object;
+    }
+    config* config13 = new config( config12 );
+    assert( config12->energy( ff ) == 0.0 );
+    int n_hard = 0;
+    for( int i = 0; i < 5000; i++ ){			// Same decisions as the energy
+        rnd_seed( i );
+        bool kept = config12->hard_move( i % 250, 0.5, ff );
+        if( kept ) n_hard++;
+        rnd_seed( i );
+        if( config13->trial_move( i % 250, 0.5, ff ) <= 0.0 ){
+            assert( kept );
+            config13->commit_move();
+        } else {
+            assert( ! kept );
+            config13->reject_move();
+        }
+    }
+    assert(( n_hard > 0 ) && ( n_hard < 5000 ));
+    assert( same_places( config12, config13 ));
+    assert( config12->energy( ff ) == 0.0 );
+    assert( ! config12->test_clash() );
+
+    printf("Testing event chains for Class config\n");
+    assert( config12->can_chain( ff ));
+    int n_collisions = 0;
+    for( int i = 0; i < 200; i++ )
+        n_collisions += config12->event_chain( i % 250, i % 2, 10.0, ff );
+    assert( n_collisions > 0 );
+    assert( ! same_places( config12, config13 ));
+    assert( ! config12->test_clash() );
+    assert( config12->energy( ff ) == 0.0 );
+    config13->is_periodic = false;
+    assert( ! config13->can_chain( ff ));		// Only periodic
+    config13->is_periodic = true;
+    config13->use_verlet( 0.1 );				// Cells wide enough with Verlet lists
+    for( int i = 0; i < 200; i++ )
+        config13->event_chain( i % 250, i % 2, 10.0, ff );
+    assert( ! config13->test_clash() );
+    assert( config13->energy( ff ) == 0.0 );
+    config* config14 = new config();			// Narrower than two diameters
+    config14->x_size = 1.5;
+    config14->y_size = 20.0;
+    config14->is_periodic = true;
+    config14->add_topology( new topology( 0.5 ));
+    object *a_disc = new object( 0, 0.5, 10.0, 0.0 );
+    config14->add_object( a_disc );
+    delete a_disc;
+    assert( config14->energy( ff ) == 0.0 );
+    assert( ! config14->can_chain( ff ));
+    delete config14;
+    delete config12;
+    delete config13;
+    delete ff;
+
     printf("Testing errors on badly formed files for Class config\n");
 
     try {
@@ -52,6 +214,32 @@ int main()
         cout << e.what() << "\n";
     }
 
+    force_field *forces2 = new force_field("test2.ff"); // Kernels for each pair of molecules
+    topology *topo2 = new topology("test2.topo");
+    double r2[MAX_ATOMS];
+    for( int k = 0; k < 200; k++ ){
+        object obj1( k % 2, 0.0, 0.0, 0.1 * k );
+        object obj2( ( k / 2 ) % 2, 1.0 + 0.05 * k, 0.5, 0.2 * k );
+        double energy = 0.0;                            // With the batch path
+        bool overlap = false;
+        obj1.update_atoms( topo2 );
+        obj2.update_atoms( topo2 );
+        for( int i = 0; i < obj1.n_atoms; i++ ){
+            pair_distances( obj1.atom_x[i] - 0.5, obj1.atom_y[i], obj2.n_atoms,
+                            obj2.atom_x, obj2.atom_y, r2 );
+            energy += forces2->interactions( obj1.atom_t[i], obj2.n_atoms, obj2.atom_t, r2 );
+            overlap = overlap || forces2->overlaps( obj1.atom_t[i], obj2.n_atoms, obj2.atom_t, r2 );
+        }
+        assert( obj1.interaction( forces2, topo2, &obj2, 0.5, 0.0 ) == energy );
+        assert( obj1.overlaps( forces2, topo2, &obj2, 0.5, 0.0 ) == overlap );
+        topo2->compile_hard( forces2 );                 // Vector kernel for the squares
+        assert( obj1.overlaps( forces2, topo2, &obj2, 0.5, 0.0 ) == overlap );
+        topo2->find_bounds();
+    }
+    delete topo2;
+    delete forces2;
+    printf("Interaction kernels give the same energies\n");
+
     printf("Running destructors\n");
 
     delete config0;
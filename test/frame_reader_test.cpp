@@ -0,0 +1,95 @@
+
+#include "../Classes/frame_reader.h"
+#include "../Classes/config.h"
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <thread>
+#include <atomic>
+
+#define N_FRAMES 5
+
+int main()
+{
+    printf("-------------------------------\n");
+    printf("Starting tests for Class frame_reader\n\n");
+
+    config *a_config = new config("test1.config");
+    std::ofstream text("test_reader.traj");             // A text trajectory
+    trajectory *binary = new trajectory("test_reader.bin", a_config, "test1.topo");
+    std::vector<double> first_x;                        // Where object 0 is in each frame
+    for( int k = 0; k < N_FRAMES; k++ ){
+        first_x.push_back( a_config->get_object(0)->pos_x );
+        text << "====" << 100 * k << "====\n";
+        a_config->write( text );
+        binary->write_frame( a_config, 10 * k );
+        a_config->move( 0, 0.5 );
+    }
+    text.close();
+    delete binary;
+
+    std::vector<std::string> names;
+    names.push_back("test_reader.traj");
+    names.push_back("test1.config");
+    names.push_back("test_reader.bin");
+    frame_reader *reader = new frame_reader( names, 1 );   // One buffer, read in turn
+    config *frame;
+    long number, step, n = 0;
+    while(( frame = reader->next( &number, &step )) != NULL ){
+        assert( number == n );
+        if( n < N_FRAMES ) assert( step == 100 * n );
+        else if( n == N_FRAMES ) assert( step == 0 );
+        else assert( step == 10 * ( n - N_FRAMES - 1 ));
+        assert( frame->n_objects() == a_config->n_objects() );
+        if( n != N_FRAMES )
+            assert( fabs( frame->get_object(0)->pos_x - first_x[ n % ( N_FRAMES + 1 )] ) < 1e-4 );
+        reader->release( frame );
+        n++;
+    }
+    assert( n == 2 * N_FRAMES + 1 );
+    assert( reader->error().empty() );
+    delete reader;
+    printf("Frames read in order from text, single and binary files\n");
+
+    std::atomic<long> total( 0 );                       // Several threads sharing the frames
+    reader = new frame_reader( names, 3 );
+    std::vector<std::thread> workers;
+    for( int t = 0; t < 3; t++ )
+        workers.push_back( std::thread( [&]{
+            config *a_frame;
+            long    a_number;
+            while(( a_frame = reader->next( &a_number )) != NULL ){
+                total += a_number;
+                reader->release( a_frame );
+            }
+        }));
+    for( int t = 0; t < 3; t++ )
+        workers[t].join();
+    assert( total == ( 2 * N_FRAMES ) * ( 2 * N_FRAMES + 1 ) / 2 );
+    delete reader;
+    printf("Frames shared between threads\n");
+
+    names.push_back("no_name");                         // Stops at a missing file
+    names.push_back("test1.config");
+    reader = new frame_reader( names, 2 );
+    n = 0;
+    while(( frame = reader->next() ) != NULL ){
+        reader->release( frame );
+        n++;
+    }
+    assert( n == 2 * N_FRAMES + 1 );
+    cout << reader->error();
+    delete reader;
+
+    reader = new frame_reader( names, 1 );              // Stopped before the end
+    frame = reader->next();
+    delete reader;
+
+    remove("test_reader.traj");
+    remove("test_reader.bin");
+    delete a_config;
+
+    printf("Finished tests for Class frame_reader\n");
+    printf("-------------------------------\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,96 @@
+
+#include "../Classes/frame_writer.h"
+#include "../Classes/config.h"
+#include <cassert>
+#include <cstdio>
+#include <sstream>
+
+#define N_FRAMES 20
+
+int main()
+{
+    printf("-------------------------------\n");
+    printf("Starting tests for Class frame_writer\n\n");
+
+    config *a_config = new config("test1.config");
+    std::ostringstream direct, queued, log;
+
+    frame_writer *writer = new frame_writer( a_config, &queued, NULL, 1 );
+    rnd_seed( 1 );
+    for( int k = 0; k < N_FRAMES; k++ ){                // Same text as written directly
+        direct << "====" << k << "====\n";
+        a_config->write( direct );
+        writer->write_frame( a_config, k );
+        writer->write_log( &log, std::to_string( k ) + "\n" );
+        for( int i = 0; i < a_config->n_objects(); i++ )
+            a_config->move( i, 0.5 );                   // Changed while being written
+    }
+    writer->flush();
+    assert( queued.str() == direct.str() );
+    assert( log.str().substr( 0, 4 ) == "0\n1\n" );
+    printf("Text frames written in order, %d waits\n", writer->n_waits);
+    delete writer;
+
+    trajectory *traj = new trajectory("test_writer.traj", a_config, "test1.topo");
+    writer = new frame_writer( a_config, NULL, traj, 2 );
+    for( int k = 0; k < N_FRAMES; k++ ){
+        writer->write_frame( a_config, 10 * k );
+        a_config->move( 0, 0.5 );
+    }
+    delete writer;                                      // Writes the remaining frames
+    delete traj;
+    traj = new trajectory("test_writer.traj");
+    assert( traj->n_frames() == N_FRAMES );
+    assert( traj->step( N_FRAMES - 1 ) == 10 * ( N_FRAMES - 1 ));
+    delete traj;
+    printf("Binary frames written\n");
+
+    traj = new trajectory("test_writer.traj", a_config, "test1.topo");
+    writer = new frame_writer( a_config, NULL, traj, 3 );
+    long n_queued = 0;
+    for( int k = 0; k < 4; k++ ){
+        if( k == 1 ){
+            writer->flush();
+            traj->close();                              // Frame 1 then fails
+        }
+        try {
+            writer->write_frame( a_config, k );
+            n_queued++;
+        }
+        catch(exception &e) {                           // The error of frame 1
+            assert( k > 1 );
+        }
+    }
+    try {
+        writer->flush();
+        assert( false );
+    }
+    catch(exception &e) {
+        cout << e.what();
+    }
+    assert( n_queued - writer->n_lost == 1 );           // Nothing after the bad frame
+    delete writer;
+    delete traj;
+    traj = new trajectory("test_writer.traj");
+    assert( traj->n_frames() == 1 );
+    delete traj;
+    remove("test_writer.traj");
+    printf("Frames after an error dropped and counted\n");
+
+    config *other = new config("test2.config");          // Different objects
+    writer = new frame_writer( a_config, &queued, NULL );
+    try {
+        writer->write_frame( other, 0 );
+        assert( false );
+    }
+    catch(exception &e) {
+        cout << e.what();
+    }
+    delete writer;
+    delete other;
+    delete a_config;
+
+    printf("Finished tests for Class frame_writer\n");
+    printf("-------------------------------\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,121 @@
+#include "../Classes/pair_kernel.h"
+#include "../Classes/common.h"
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+
+#define N_BLOCK 16                                      // Up to MAX_ATOMS atoms
+#define N_TRIES 20000
+#define N_MOLS  8                                       // Atoms of the molecules for block_overlap()
+
+/*
+ * Random atoms in a 10 x 10 box, with sizes chosen so that many atoms just
+ * touch. Some atoms are placed exactly at contact distance to test the edge
+ * of the hard core.
+ */
+void
+random_block(int n, double *xs, double *ys, double *rs){
+    for( int j = 0; j < n; j++ ){
+        xs[j] = rnd_lin(10.0);
+        ys[j] = rnd_lin(10.0);
+        rs[j] = 0.25 * ( 1 + rnd_current()->below( 4 ));
+    }
+}
+
+/*
+ * Two molecules of n1 and n2 atoms, with hard core distances from 0.5 to 2
+ * and one pair at exactly that distance in a third of the tests.
+ */
+void
+random_pair(int t, int n1, double *x1, double *y1, int n2, double *x2,
+        double *y2, double *hard2){
+    for( int i = 0; i < n1; i++ ){
+        x1[i] = rnd_lin(4.0);
+        y1[i] = rnd_lin(4.0);
+    }
+    for( int j = 0; j < n2; j++ ){
+        x2[j] = rnd_lin(4.0) + 3.0;
+        y2[j] = rnd_lin(4.0);
+    }
+    for( int k = 0; k < n1 * n2; k++ )
+        hard2[k] = 0.25 * ( 1 + rnd_current()->below( 4 )) * ( 1 + rnd_current()->below( 4 ));
+    if( t % 3 == 0 ){
+        double dx = x2[n2-1] - ( x1[n1-1] - 1.0 );
+        double dy = y2[n2-1] - y1[n1-1];
+        hard2[ n1 * n2 - 1 ] = dx*dx + dy*dy;
+    }
+}
+
+int main()
+{
+    double  xs[N_BLOCK], ys[N_BLOCK], rs[N_BLOCK];
+    double  r2_ref[N_BLOCK], r2[N_BLOCK];
+    double  x, y, r, period;
+    double  x1[N_MOLS], y1[N_MOLS], x2[N_MOLS], y2[N_MOLS], hard2[N_MOLS*N_MOLS];
+    bool    clash_ref[N_TRIES], block_ref[N_TRIES];
+    int     n, n1, n2, level;
+    int     n_block = 0;
+    int     n_clash = 0;
+
+    printf("Starting tests for the pair kernels\n\n");
+    printf("Best kernel available: %s\n", pair_kernel_name());
+
+    assert( set_pair_kernel( KERNEL_SCALAR ) == KERNEL_SCALAR );
+    rnd_seed( 1 );
+    for( int t = 0; t < N_TRIES; t++ ){                 // Reference decisions
+        n = 1 + t % N_BLOCK;
+        random_block( n, xs, ys, rs );
+        x = rnd_lin(10.0); y = rnd_lin(10.0); r = 0.5;
+        if( t % 3 == 0 ){ x = xs[n-1] + rs[n-1] + r; y = ys[n-1]; }  // Exact contact
+        period = ( t % 2 ) ? 10.0 : 0.0;
+        clash_ref[t] = pair_overlap( x, y, r, n, xs, ys, rs, period, period );
+        if( clash_ref[t] ) n_clash++;
+    }
+    printf("Scalar kernel found %d clashes in %d tests\n", n_clash, N_TRIES);
+    assert(( n_clash > 0 ) && ( n_clash < N_TRIES ));
+    for( int t = 0; t < N_TRIES; t++ ){
+        n1 = 1 + t % N_MOLS;
+        n2 = 1 + ( t / N_MOLS ) % N_MOLS;
+        random_pair( t, n1, x1, y1, n2, x2, y2, hard2 );
+        block_ref[t] = block_overlap( n1, x1, y1, 1.0, 0.0, n2, x2, y2, hard2 );
+        if( block_ref[t] ) n_block++;
+    }
+    printf("Scalar kernel found %d hard core overlaps in %d tests\n", n_block, N_TRIES);
+    assert(( n_block > 0 ) && ( n_block < N_TRIES ));
+
+    for( level = KERNEL_AVX2; level <= KERNEL_AVX512; level++ ){
+        if( set_pair_kernel( level ) != level ){
+            printf("Kernel level %d not supported, skipped\n", level);
+            continue;
+        }
+        rnd_seed( 1 );
+        for( int t = 0; t < N_TRIES; t++ ){             // Same tests again
+            n = 1 + t % N_BLOCK;
+            random_block( n, xs, ys, rs );
+            x = rnd_lin(10.0); y = rnd_lin(10.0); r = 0.5;
+            if( t % 3 == 0 ){ x = xs[n-1] + rs[n-1] + r; y = ys[n-1]; }
+            period = ( t % 2 ) ? 10.0 : 0.0;
+            assert( pair_overlap( x, y, r, n, xs, ys, rs, period, period ) == clash_ref[t] );
+
+            set_pair_kernel( KERNEL_SCALAR );           // Distances are bit identical
+            pair_distances( x, y, n, xs, ys, r2_ref );
+            set_pair_kernel( level );
+            if( n < N_BLOCK ) r2[n] = -1.0;             // Nothing written past n
+            pair_distances( x, y, n, xs, ys, r2 );
+            assert( memcmp( r2, r2_ref, n * sizeof(double)) == 0 );
+            if( n < N_BLOCK ) assert( r2[n] == -1.0 );
+        }
+        for( int t = 0; t < N_TRIES; t++ ){
+            n1 = 1 + t % N_MOLS;
+            n2 = 1 + ( t / N_MOLS ) % N_MOLS;
+            random_pair( t, n1, x1, y1, n2, x2, y2, hard2 );
+            assert( block_overlap( n1, x1, y1, 1.0, 0.0, n2, x2, y2, hard2 ) == block_ref[t] );
+        }
+        printf("Kernel %s gives identical results\n", pair_kernel_name());
+    }
+    set_pair_kernel( KERNEL_AUTO );
+
+    printf("Finished tests for the pair kernels\n");
+    printf("-------------------------------\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,54 @@
+
+#include "../Classes/metrics.h"
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <unistd.h>
+
+int main()
+{
+    printf("-------------------------------\n");
+    printf("Starting tests for Class metrics\n\n");
+
+    metrics *values = new metrics("test.prom", "a \"test\"");
+    values->counter("test_steps_total", "Steps made.", 1000);
+    values->gauge("test_energy", "Energy.", -2.5);
+    values->gauge("test_energy", "Energy.", 1.5);       // Replaces the value
+    values->write();
+    assert( access("test.prom.tmp", F_OK) != 0 );       // Renamed
+
+    std::ifstream source("test.prom");
+    std::ostringstream text;
+    text << source.rdbuf();
+    assert( text.str() ==
+        "# HELP test_steps_total Steps made.\n"
+        "# TYPE test_steps_total counter\n"
+        "test_steps_total{run=\"a \\\"test\\\"\"} 1000\n"
+        "# HELP test_energy Energy.\n"
+        "# TYPE test_energy gauge\n"
+        "test_energy{run=\"a \\\"test\\\"\"} 1.5\n" );
+    printf("Metrics written\n");
+
+    assert( metrics::file_bytes("test.prom") == text.str().length() );
+    assert( metrics::file_bytes("no_such_file") == 0.0 );
+    assert( metrics::resident_bytes() > 0.0 );
+    remove("test.prom");
+    delete values;
+
+    values = new metrics("no_such_dir/test.prom", "test");
+    try {
+        values->write();
+        assert( false );
+    }
+    catch(std::exception &e) {
+        printf("%s", e.what());
+    }
+    delete values;
+
+    printf("Finished tests for Class metrics\n");
+    printf("-------------------------------\n");
+    return EXIT_SUCCESS;
+}
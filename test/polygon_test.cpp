@@ -1,6 +1,7 @@
 
 #include "../Classes/polygon.h"
 #include <cassert>
+#include <math.h>
 
 int main()
 {
@@ -45,6 +46,16 @@ int main()
     assert( ! poly2->is_inside( 1.1, 1.1, 0.41 ));
     printf( "Points inside test OK\n" );
 
+    assert( fabs( poly2->circle_area( 1.0, 1.0, 0.3 ) - M_PI * 0.09 ) < 1e-12 );     // Disc inside
+    assert( fabs( poly2->circle_area( 1.0, 1.0, 1.0 ) - 1.0 ) < 1e-12 );             // Square inside
+    assert( fabs( poly2->circle_area( 0.5, 0.5, 0.5 ) - M_PI * 0.25 / 4.0 ) < 1e-12 ); // Corner
+    assert( fabs( poly2->circle_area( 1.0, 0.5, 0.5 ) - M_PI * 0.25 / 2.0 ) < 1e-12 ); // Edge
+    assert( poly2->circle_area( 5.0, 5.0, 1.0 ) == 0.0 );                            // Outside
+    double r = 0.7;                                     // Disc cut by all four edges
+    double segment = r * r * acos( 0.5 / r ) - 0.5 * sqrt( r * r - 0.25 );
+    assert( fabs( poly2->circle_area( 1.0, 1.0, r ) - ( M_PI * r * r - 4.0 * segment )) < 1e-12 );
+    printf( "Disc intersection areas OK\n" );
+
     assert( poly3->is_inside( poly2 ));
     assert( poly3->is_inside( poly1 ));
     assert( ! poly2->is_inside( poly1 ));
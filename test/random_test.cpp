@@ -0,0 +1,87 @@
+#include "../Classes/random_stream.h"
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <thread>
+
+#define N_VALUES 10001
+
+int main()
+{
+    double  values[N_VALUES];
+    double  sum = 0.0;
+
+    printf("Starting tests for Class random_stream\n\n");
+
+    random_stream stream1( 0, 0 );                      // Known answer for Philox 4x32-10
+    assert( stream1.next() == 0x6627e8d5u );
+    assert( stream1.next() == 0xe169c58du );
+    assert( stream1.next() == 0xbc57ac4cu );
+    assert( stream1.next() == 0x9b00dbd8u );
+    printf("Known answer is correct\n");
+
+    random_stream stream2( 12345, 0 );
+    random_stream stream3( 12345, 0 );
+    random_stream stream4( 12345, 1 );
+    for( int i = 0; i < N_VALUES; i++ ){
+        values[i] = stream2.uniform();
+        assert(( values[i] >= 0.0 ) && ( values[i] < 1.0 ));
+        assert( values[i] == stream3.uniform() );       // Same seed and stream
+        sum += values[i];
+    }
+    assert( fabs( sum / N_VALUES - 0.5 ) < 0.01 );
+    assert( stream4.uniform() != values[0] );           // Another stream
+
+    stream3.set( 12345, 0 );                            // Batches are the same numbers
+    stream3.next();
+    stream3.next();
+    stream3.uniforms( N_VALUES - 1, values );
+    stream2.set( 12345, 0 );
+    stream2.uniform();
+    for( int i = 0; i < N_VALUES - 1; i++ )
+        assert( values[i] == stream2.uniform() );
+    stream3.next();                                     // Also when not aligned
+    stream2.next();
+    stream3.uniforms( 7, values );
+    for( int i = 0; i < 7; i++ )
+        assert( values[i] == stream2.uniform() );
+    printf("Batches are correct\n");
+
+    uint64_t where = stream2.position();                // Save and restore
+    uint32_t word  = stream2.next();
+    stream4.seek( where );
+    assert( stream4.next() != word );                   // Not the same stream
+    stream2.uniform();
+    stream2.seek( where );
+    assert( stream2.next() == word );
+    for( int i = 0; i < 9; i++ ){
+        stream4.set( 12345, 0 );
+        for( int j = 0; j < i; j++ ) stream4.next();
+        assert( stream4.position() == (uint64_t)i );
+    }
+    printf("Positions are correct\n");
+
+    for( int i = 0; i < N_VALUES; i++ ){
+        int k = stream2.below( 6 );
+        assert(( k >= 0 ) && ( k < 6 ));
+    }
+
+    rnd_seed( 7 );                                      // Each thread its own stream
+    double first = rnd_uniform();
+    rnd_seed( 7 );
+    std::thread other( [](){
+        random_stream mine( 7, 1 );
+        rnd_use( &mine );
+        rnd_uniform();
+        assert( rnd_current() == &mine );
+        rnd_use( NULL );
+    });
+    other.join();
+    assert( rnd_uniform() == first );
+    printf("Thread streams are correct\n");
+
+    printf("Finished tests for Class random_stream\n");
+    printf("-------------------------------\n");
+    return EXIT_SUCCESS;
+}
@@ -2,7 +2,15 @@
 
 ./config_test
 ./polygon_test
+./cell_list_test
 ./topology_test test2.topo
+./kernel_test
+./random_test
+./trajectory_test
+./frame_writer_test
+./frame_reader_test
+./checkpoint_test
+./metrics_test
 
 ../makeconfig/makeconfig -v 100 100 5
 ../makeconfig/makeconfig -v 100 100 5 5
@@ -10,12 +18,72 @@
 ../shrinkconfig/shrinkconfig -v test1.config
 ../shrinkconfig/shrinkconfig -v -s 2.0 test1.config
 ../shrinkconfig/shrinkconfig -v -s 0.5 test2.config
+../shrinkconfig/shrinkconfig -v -j 2 -s 0.5 test2.config
 
 ../NVT/NVT -v -t test1.topo -f test1.ff -c test1.config 100 10 1 1
+../NVT/NVT -v -k 1.0 -j 2 -t test1.topo -f test1.ff -c test1.config 100 10 1 1
+../NVT/NVT -v -d -j 2 -t test1.topo -f test1.ff -c test1.config 10 1 1 1
+../NVT/NVT -v -p -e 20 -t test1.topo -f test1.ff -c test1.config 10 5 1 1
+../RENVT/RENVT -v -j 2 -x 20 -t test1.topo -f test1.ff -c test1.config 100 50 0.5 1.0 3 1
+
+../NVT/NVT -v -b -n 10 -s test_traj.bin -t test1.topo -f test1.ff -c test1.config 50 10 1 1
+../trajconv/trajconv -v test_traj.bin test_traj.gz
+../trajconv/trajconv -v -t test1.topo test_traj.gz test_traj2.bin
+../analysis/pcf test_traj.bin > /dev/null
+../analysis/2DOrder test_traj2.bin > /dev/null
+../analysis/2DOrder -S 1 -m 2,3 test_traj2.bin | awk 'NR == 1 && ( $1 != 5 || $2 != 7 ) {
+    print "Assertion failed: 2DOrder -m 2,3 made a " $1 " by " $2 " map" }'
+../analysis/pcf -j 1 test_traj.bin > test_pcf1.txt
+../analysis/pcf -j 3 test_traj.bin | cmp -s - test_pcf1.txt ||
+    echo "Assertion failed: pcf depends on the number of threads"
+../analysis/2DOrder -S 1 -j 1 test_traj2.bin > test_order1.txt
+../analysis/2DOrder -S 1 -j 3 test_traj2.bin | cmp -s - test_order1.txt ||
+    echo "Assertion failed: 2DOrder depends on the number of threads"
+( zcat test_traj.gz; printf "====60====\n100.0 100.0\n1\n0 50.0 50.0 0.0\n" ) > test_bad.txt
+../trajconv/trajconv -t test1.topo test_bad.txt test_bad.bin 2> /dev/null &&
+    echo "Assertion failed: trajconv converted a frame with fewer objects"
+cmp -s test_bad.bin test_traj2.bin &&             # Same frames and index
+    echo "trajconv kept the frames before the bad one" ||
+    echo "Assertion failed: trajconv lost the frames before the bad one"
+rm -f test_traj.bin test_traj.gz test_traj2.bin test_bad.txt test_bad.bin test_pcf1.txt test_order1.txt
+
+../NVT/NVT -v -b -n 10 -s test_traj.bin -C test.ckpt -w 20 -S 1 -t test1.topo -f test1.ff -c test1.config 30 10 1 1 > /dev/null
+../NVT/NVT -v -b -n 10 -s test_traj.bin -C test.ckpt -w 20 -r test.ckpt 50 10 1 1
+rm -f test_traj.bin test.ckpt
+
+../NVT/NVT -S 5 -k 1.0 -C test_a.ckpt -w 1000 -t test1.topo -f test1.ff -c hex.config -o test_a.config 4000 100 1 1 > /dev/null
+../NVT/NVT -S 5 -k 1.0 -C test_b.ckpt -w 1000 -t test1.topo -f test1.ff -c hex.config -o /dev/null 2000 100 1 1 > /dev/null
+../NVT/NVT -k 1.0 -C test_b.ckpt -w 1000 -r test_b.ckpt -o test_b.config 4000 100 1 1 > /dev/null
+cmp -s test_a.config test_b.config && cmp -s test_a.ckpt test_b.ckpt &&
+    echo "NVT continued from a checkpoint is the same as without stopping" ||
+    echo "Assertion failed: NVT continued from a checkpoint differs from the run without stopping"
+rm -f test_a.ckpt test_b.ckpt test_a.config test_b.config
+
+../NVT/NVT -p -S 5 -C test.ckpt -w 1000 -t test1.topo -f test1.ff -c hex.config -o test_end.config 4000 1000 1 1 > test_run.log
+../NVT/NVT -p -S 5 -t test1.topo -f test1.ff -c test_end.config -o /dev/null 1 1 1 1 > test_check.log
+awk -v run=$(awk '/Energy/ { e = $NF } END { print e }' test_run.log) \
+    -v check=$(awk '/Energy/ { print $NF; exit }' test_check.log) \
+    'BEGIN { d = run - check; if( d < 0 ) d = -d;
+             if( d > 1e-4 * ( 1 + ( check < 0 ? -check : check ))){
+                 print "Assertion failed: NVT -C reports energy " run " but the configuration has " check; exit 1 }
+             print "NVT -C energy " run " is that of the configuration" }'
+rm -f test.ckpt test_end.config test_run.log test_check.log
+
+../NVT/NVT -v -b -n 10 -s test_traj.bin -M test_nvt.prom -i 0 -t test1.topo -f test1.ff -c test1.config 50 10 1 1 > /dev/null
+cat test_nvt.prom
+rm -f test_traj.bin test_nvt.prom
 
 valgrind ./config_test
 valgrind ./polygon_test
+valgrind ./cell_list_test
 valgrind ./topology_test test2.topo
+valgrind ./kernel_test
+valgrind ./random_test
+valgrind ./trajectory_test
+valgrind ./frame_writer_test
+valgrind ./frame_reader_test
+valgrind ./checkpoint_test
+valgrind ./metrics_test
 
 valgrind ../makeconfig/makeconfig -v 100 100 5 5
 valgrind ../shrinkconfig/shrinkconfig -v -s 0.5 test2.config
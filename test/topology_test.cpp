@@ -1,8 +1,10 @@
 
 #include "../Classes/topology.h"
+#include "../Classes/force_field.h"
 #include <cassert>
 #include <exception>
 #include <iostream>
+#include <cmath>
 
 #define EPSILON 1e-15
 
@@ -40,6 +42,40 @@ int main(int argc, char **argv )
     std::cerr << "================4==============\n";
     topo4->write( std::cerr );
     std::cerr << "==============================\n";
+
+    printf("Testing bounding circles for Class topology\n");
+    assert( topo1->extent(0) == 0.0 );			// Single atom at the center
+    assert( topo1->bound_radius(0) == 1.0 );
+    assert( fabs( topo1->extent(1) - sqrt(0.5)) < EPSILON );
+    assert( fabs( topo1->bound_radius(1) - sqrt(0.5) - 0.5 ) < EPSILON );
+    assert( topo2->bound_radius(1) == topo1->bound_radius(1) ); // Copied
+    assert( topo1->clash_range(0, 1) == topo1->bound_radius(0) + topo1->bound_radius(1) );
+    assert( fabs( topo1->pair_range(1, 1, 2.0) - 2.0 - 2*sqrt(0.5)) < EPSILON );
+    assert( topo3->bound_radius(1) == 1.0 );		// Added molecule
+
+    printf("Testing hard core blocks for Class topology\n");
+    force_field *forces = new force_field("test2.ff");
+    assert( topo1->hard_block( 0, 1, forces->stamp ) == NULL );	// Not made yet
+    topo1->compile_hard( forces );
+    assert( topo1->hard_block( 0, 0, forces->stamp ) == NULL );	// Disk too small
+    assert( topo1->hard_block( 1, 0, forces->stamp ) == NULL );
+    const double *block = topo1->hard_block( 1, 1, forces->stamp );
+    assert( block != NULL );
+    for( int i = 0; i < 4; i++ )
+        for( int j = 0; j < 4; j++ )
+            assert( block[ i * 4 + j ] == forces->hard2( topo1->molecules(1).the_atoms(i).type,
+                                                      topo1->molecules(1).the_atoms(j).type ));
+    block = topo1->hard_block( 0, 1, forces->stamp );
+    for( int j = 0; j < 4; j++ )
+        assert( block[j] == forces->hard2( 0, topo1->molecules(1).the_atoms(j).type ));
+    forces->update( "test2.ff" );                       // Blocks are out of date
+    assert( topo1->hard_block( 0, 1, forces->stamp ) == NULL );
+    topo1->compile_hard( forces );
+    assert( topo1->hard_block( 0, 1, forces->stamp ) != NULL );
+    topo1->find_bounds();                               // Atoms may have changed
+    assert( topo1->hard_block( 0, 1, forces->stamp ) == NULL );
+    delete forces;
+
     printf("Running destructors\n");
 
     delete topo0;
@@ -0,0 +1,140 @@
+
+#include "../Classes/config.h"
+#include <cassert>
+#include <cstdio>
+
+#define N_FRAMES 5
+
+/*
+ * True if the objects of a frame are those of the configuration, to the
+ * precision of a float.
+ */
+bool
+same_frame(config *c1, config *c2){
+    if( c1->n_objects() != c2->n_objects() ) return false;
+    for( int i = 0; i < c1->n_objects(); i++ )
+        if(( c1->get_object(i)->o_type != c2->get_object(i)->o_type ) ||
+           ( c2->get_object(i)->pos_x != (float)c1->get_object(i)->pos_x ) ||
+           ( c2->get_object(i)->pos_y != (float)c1->get_object(i)->pos_y ) ||
+           ( c2->get_object(i)->orientation != (float)c1->get_object(i)->orientation ))
+            return false;
+    return true;
+}
+
+int main()
+{
+    printf("-------------------------------\n");
+    printf("Starting tests for Class trajectory\n\n");
+
+    config *frames[N_FRAMES];
+    frames[0] = new config("test1.config");
+    for( int k = 1; k < N_FRAMES; k++ ){                // Some different frames
+        frames[k] = new config( frames[k-1] );
+        for( int i = 0; i < frames[k]->n_objects(); i++ )
+            frames[k]->move( i, 0.5 );
+    }
+
+    assert( ! trajectory::is_trajectory("test1.config") );
+    trajectory *traj1 = new trajectory("test.traj", frames[0], "test1.topo");
+    for( int k = 0; k < N_FRAMES; k++ )
+        traj1->write_frame( frames[k], 100 * k );
+    delete traj1;                                       // Closing adds the index
+    assert( trajectory::is_trajectory("test.traj") );
+    printf("Trajectory written\n");
+
+    trajectory *traj2 = new trajectory("test.traj");
+    assert( traj2->n_frames() == N_FRAMES );
+    assert( traj2->n_objects == frames[0]->n_objects() );
+    assert( traj2->topology_name == "test1.topo" );
+    for( int k = N_FRAMES - 1; k >= 0; k-- ){           // In any order
+        config *a_config = new config( traj2, k );
+        assert( traj2->step( k ) == 100 * k );
+        assert( same_frame( frames[k], a_config ));
+        assert( a_config->x_size == frames[0]->x_size );
+        assert( a_config->is_periodic == frames[0]->is_periodic );
+        delete a_config;
+    }
+    delete traj2;
+    printf("Frames read back correctly\n");
+
+    FILE *src = fopen("test.traj", "rb");               // As if the writer had stopped
+    FILE *dest = fopen("test_cut.traj", "wb");
+    fseek( src, 0, SEEK_END );
+    long n_bytes = ftell( src ) - 16 * N_FRAMES - 24 - 10;
+    fseek( src, 0, SEEK_SET );
+    for( long b = 0; b < n_bytes; b++ )
+        fputc( fgetc( src ), dest );
+    fclose( src );
+    fclose( dest );
+    trajectory *traj3 = new trajectory("test_cut.traj");
+    assert( traj3->n_frames() == N_FRAMES - 1 );        // The cut frame is lost
+    config *last = new config( traj3, N_FRAMES - 2 );
+    assert( same_frame( frames[N_FRAMES - 2], last ));
+    delete last;
+    delete traj3;
+    printf("Frames found without the index\n");
+
+    trajectory *traj6 = new trajectory("test_cut.traj", 2);  // Continued after 2 frames
+    traj6->write_frame( frames[N_FRAMES - 1], 1000 );
+    delete traj6;
+    traj6 = new trajectory("test_cut.traj");
+    assert( traj6->n_frames() == 3 );
+    assert( traj6->step( 1 ) == 100 );
+    assert( traj6->step( 2 ) == 1000 );
+    last = new config( traj6, 2 );
+    assert( same_frame( frames[N_FRAMES - 1], last ));
+    delete last;
+    delete traj6;
+    try {
+        traj6 = new trajectory("test_cut.traj", 4);      // Too few frames
+        delete traj6;
+        assert( false );
+    }
+    catch(exception &e) {
+        cout << e.what();
+    }
+    printf("Trajectory continued\n");
+
+    try {
+        trajectory *traj4 = new trajectory("test1.config"); // Not a trajectory
+        delete traj4;
+        assert( false );
+    }
+    catch(exception &e) {
+        cout << e.what();
+    }
+
+    config *poly_config = new config("test2.config");   // A polygon boundary
+    trajectory *traj5 = new trajectory("test_poly.traj", poly_config, "test2.topo");
+    traj5->write_frame( poly_config, 0 );
+    poly_config->get_object( 0 )->o_type++;             // Not the type in the header
+    try {
+        traj5->write_frame( poly_config, 10 );
+        assert( false );
+    }
+    catch(exception &e) {
+        cout << e.what();
+    }
+    poly_config->get_object( 0 )->o_type--;
+    assert( traj5->n_frames() == 1 );                   // Nothing indexed
+    delete traj5;
+    traj5 = new trajectory("test_poly.traj");
+    config *poly_frame = new config( traj5, 0 );
+    assert( ! poly_frame->is_rectangle );
+    assert( poly_frame->n_vertex == poly_config->n_vertex );
+    assert( fabs( poly_frame->area() - poly_config->area() ) < 1e-12 );
+    assert( same_frame( poly_config, poly_frame ));
+    delete poly_frame;
+    delete traj5;
+    delete poly_config;
+
+    for( int k = 0; k < N_FRAMES; k++ )
+        delete frames[k];
+    remove("test.traj");
+    remove("test_cut.traj");
+    remove("test_poly.traj");
+
+    printf("Finished tests for Class trajectory\n");
+    printf("-------------------------------\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,165 @@
+/**
+ * \file    trajconv.cpp
+ * \author  James Sturgis
+ * \date    October 16, 2026
+ * \version 1.0
+ * \brief   Convert trajectories between the text and binary formats.
+ *
+ * This file contains the main routine for the trajconv program that is part
+ * of the Very Coarse Grained disc simulation programmes.
+ *
+ * The programme reads a trajectory in one format and writes it in the other.
+ * A binary trajectory, as written by NVT -b, is converted to a gzipped text
+ * trajectory of configurations separated by "====step====" lines, and a text
+ * trajectory, gzipped or not, to a binary one.
+ *
+ * To use the program the command line is:
+ *
+ *      trajconv [-v][-t topology] input output
+ *
+ * Where the various parameters are:
+ *      input           The trajectory to convert, the format is recognised.
+ *      output          The converted trajectory, replaced if it exists.
+ *      -t topology     The topology file name to store in a binary trajectory
+ *                      made from a text one.
+ *      -v              Report progress on stderr.
+ */
+
+#include <cstdlib>
+#include <cstdio>
+#include <iostream>
+#include <unistd.h>
+#include "../Classes/config.h"
+
+#include "../Libraries/gzstream.h"
+
+using namespace std;
+
+#define LINE_LENGTH     128             // Frame separators are short
+
+void
+usage(int val){
+    std::cerr << "trajconv [-v][-t topology] input output\n";
+    exit(val);
+}
+
+/*
+ * Write each frame of a binary trajectory as text.
+ */
+long
+binary_to_text(const char *in_name, const char *out_name, bool verbose){
+    trajectory  *source = new trajectory( in_name );
+    ogzstream   dest( out_name );
+    config      *a_config;
+
+    if( ! dest.good() ){
+        delete source;
+        throw runtime_error("Could not create the output file\n");
+    }
+    if( verbose )
+        std::cerr << source->n_frames() << " frames of " << source->n_objects
+                  << " objects, topology " << source->topology_name << "\n";
+    for( long k = 0; k < source->n_frames(); k++ ){
+        a_config = new config( source, k );
+        dest << "====" << source->step( k ) << "====\n";
+        a_config->write( dest );
+        delete a_config;
+    }
+    dest.close();
+    long n = source->n_frames();
+    delete source;
+    return n;
+}
+
+/*
+ * Read a text trajectory frame by frame and write it as binary. If a frame
+ * can not be read or written the frames before it are kept, with their
+ * index, before the error is passed on.
+ */
+long
+text_to_binary(const char *in_name, const char *out_name, string topo_name,
+        bool verbose){
+    igzstream   source( in_name );
+    trajectory  *dest = NULL;
+    config      *a_config;
+    char        line[LINE_LENGTH];
+    long        step, n = 0;
+
+    if( ! source.good() )
+        throw runtime_error("Could not open the input file\n");
+    while( source.getline( line, LINE_LENGTH )){
+        if( sscanf( line, "====%ld", &step ) != 1 ) step = n;
+        try{
+            a_config = new config( source );
+        }
+        catch(...){
+            if( source.eof() ) break;       // Separator without a frame
+            if( dest ) delete dest;
+            throw;
+        }
+        if( !dest )
+            dest = new trajectory( out_name, a_config, topo_name );
+        try{
+            dest->write_frame( a_config, step );
+        }
+        catch(...){                         // Keep the frames already converted
+            delete a_config;
+            delete dest;
+            throw;
+        }
+        delete a_config;
+        n++;
+    }
+    if( !dest )
+        throw runtime_error("No frames in the input file\n");
+    if( verbose )
+        std::cerr << n << " frames of " << dest->n_objects << " objects\n";
+    delete dest;                            // Adds the index
+    return n;
+}
+
+int main(int argc, char** argv) {
+    string      topo_name;
+    bool        verbose = false;
+    int         c;
+    long        n;
+
+    while( ( c = getopt (argc, argv, "vht:") ) != -1 )
+    {
+        switch(c)
+        {
+            case 'v': verbose = true; break;
+            case 't': if (optarg) topo_name = optarg;
+                break;
+            case 'h': usage(EXIT_SUCCESS);
+            case '?':                           // Something wrong.
+                if( optopt == 't' ){
+                    std::cerr << "The -" << optopt << " option is missing a parameter!\n";
+                } else {
+                    std::cerr << "Unknown option " << optopt << "!\n";
+                }
+            default :                           // Something very wrong.
+                usage(EXIT_FAILURE);
+        }
+    }
+    if(( argc - optind ) != 2 ){
+        std::cerr << "Not right number of parameters!\n";
+        usage(EXIT_FAILURE);
+    }
+
+    try{
+        if( trajectory::is_trajectory( argv[ optind ] )){
+            if( verbose ) std::cerr << "Converting binary to text.\n";
+            n = binary_to_text( argv[ optind ], argv[ optind+1 ], verbose );
+        } else {
+            if( verbose ) std::cerr << "Converting text to binary.\n";
+            n = text_to_binary( argv[ optind ], argv[ optind+1 ], topo_name, verbose );
+        }
+    }
+    catch( exception &e ){
+        std::cerr << "Conversion failed: " << e.what();
+        exit( EXIT_FAILURE );
+    }
+    if( verbose ) std::cerr << "Converted " << n << " frames.\n";
+    return EXIT_SUCCESS;
+}